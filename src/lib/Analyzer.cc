@@ -20,10 +20,13 @@
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/Format.h"
 
 #include <memory>
 #include <vector>
 #include <sstream>
+#include <chrono>
+#include <cmath>
 #include <sys/resource.h>
 
 #include "Analyzer.h"
@@ -52,8 +55,83 @@ cl::opt<bool> CriticalVar(
     cl::desc("Identify compiler-introduced TOCTTOU bugs"), 
     cl::NotHidden, cl::init(false));
 
+cl::opt<unsigned> NumThreads(
+    "threads",
+    cl::desc("Number of OpenMP worker threads (0: runtime default)"),
+    cl::init(0));
+
+cl::opt<std::string> ConfigDir(
+    "config-dir",
+    cl::desc("Also read the function lists of this directory (laid out like src/lib/configs)"),
+    cl::init(""));
+
+cl::opt<std::string> ErrFuncsProfile(
+    "err-funcs-profile",
+    cl::desc("Error handling functions to use: linux, freebsd or php"),
+    cl::init("linux"));
+
+cl::opt<unsigned> AnalysisCacheMB(
+    "analysis-cache-mb",
+    cl::desc("Memory budget in MB of the shared per-function analyses (0: unlimited)"),
+    cl::init(4096));
+
+cl::opt<bool> FusePasses(
+    "fuse-passes",
+    cl::desc("Run the per-function passes back to back on each function"),
+    cl::init(true));
+
+cl::opt<bool> AliasQueries(
+    "alias-queries",
+    cl::desc("Compute the alias pointers of each function (printed at -verbose-level=2)"),
+    cl::init(false));
+
+cl::opt<std::string> StatsFile(
+    "stats-file",
+    cl::desc("Append per-pass timing and memory rows to this file"),
+    cl::init(""));
+
+cl::opt<std::string> ReportJSONL(
+    "report-jsonl",
+    cl::desc("Write one JSON record per detected bug to this file"),
+    cl::init(""));
+
+cl::opt<std::string> ReportSARIF(
+    "report-sarif",
+    cl::desc("Write detected bugs as a SARIF log to this file"),
+    cl::init(""));
+
 GlobalContext GlobalCtx;
 
+//Peak resident set size of the process in KB
+static long getPeakRSS() {
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+	return usage.ru_maxrss;
+}
+
+//Time a pass and record its statistic in GCtx->PassStats
+template <typename PassFn>
+static double RunTimedPass(GlobalContext *GCtx, const char *Name, PassFn Fn) {
+
+	auto wall_start = std::chrono::steady_clock::now();
+	clock_t cpu_start = clock();
+
+	Fn();
+
+	clock_t cpu_finish = clock();
+	auto wall_finish = std::chrono::steady_clock::now();
+
+	PassStatistic PS;
+	PS.Name = Name;
+	PS.WallTime = std::chrono::duration<double>(wall_finish - wall_start).count();
+	PS.CPUTime = (double)(cpu_finish - cpu_start) / CLOCKS_PER_SEC;
+	PS.PeakRSS = getPeakRSS();
+	GCtx->PassStats.push_back(PS);
+
+	return PS.CPUTime;
+}
+
 
 void IterativeModulePass::run(ModuleList &modules) {
 
@@ -111,6 +189,72 @@ void IterativeModulePass::run(ModuleList &modules) {
 	OP << "[" << ID << "] Done!\n\n";
 }
 
+//Drop the per-function results once the fused pipeline is done with F
+static void ReleaseFunctionResults(GlobalContext *GCtx, Function *F) {
+
+	auto It = GCtx->SecurityOperationSets.find(F);
+	if (It != GCtx->SecurityOperationSets.end()) {
+		GCtx->NumDroppedSecurityOperations += It->second.size();
+		GCtx->SecurityOperationSets.erase(It);
+	}
+	GCtx->FuncPAResults.erase(F);
+	GCtx->FuncAAResults.erase(F);
+	GCtx->FuncAnalyses.invalidate(F);
+}
+
+//Run security checks, struct relations, security operations and path
+//pair analysis on one function after the other. None of them reads the
+//results of another function, so each function's state is dropped
+//before moving on. Security checks only read shared state: they are
+//collected for all functions of a module in parallel first, then merged
+//in function order as the other passes reach each function.
+static void RunFusedPasses(GlobalContext *GCtx, SecurityChecksPass &SCPass,
+	PointerAnalysisPass &PTAPass, SecurityOperationsPass &SOPass,
+	PairAnalysisPass &PAPass) {
+
+	ModuleList &Modules = GCtx->Modules;
+	for (auto &MP : Modules) {
+		SCPass.doInitialization(MP.first);
+		PTAPass.doInitialization(MP.first);
+		SOPass.doInitialization(MP.first);
+		PAPass.doInitialization(MP.first);
+	}
+
+	unsigned Counter = 0;
+	for (auto &MP : Modules) {
+		OP << "[Pipeline] [" << ++Counter << " / " << Modules.size() << "] ";
+		OP << "[" << MP.second << "]\n";
+
+		vector<Function *> Funcs;
+		for (Function &F : *MP.first)
+			Funcs.push_back(&F);
+		vector<SecurityOperationTable> Checks(Funcs.size());
+
+		#pragma omp parallel for schedule(dynamic)
+		for (int i = 0; i < (int)Funcs.size(); ++i)
+			SCPass.collectSecurityChecks(Funcs[i], Checks[i]);
+
+		PTAPass.prepareModule(MP.first);
+		for (unsigned i = 0; i < Funcs.size(); ++i) {
+			Function *F = Funcs[i];
+			SCPass.mergeSecurityChecks(F, Checks[i]);
+			SecurityOperationTable().swap(Checks[i]);
+			PTAPass.analyzeFunction(F);
+			SOPass.analyzeFunction(F);
+			PAPass.analyzeFunction(F);
+			ReleaseFunctionResults(GCtx, F);
+		}
+	}
+
+	for (auto &MP : Modules) {
+		SCPass.doFinalization(MP.first);
+		PTAPass.doFinalization(MP.first);
+		SOPass.doFinalization(MP.first);
+		PAPass.doFinalization(MP.first);
+	}
+	OP << "[Pipeline] Done!\n\n";
+}
+
 void LoadStaticData(GlobalContext *GCtx) {
 
 	// Load skip functions
@@ -126,7 +270,10 @@ void LoadStaticData(GlobalContext *GCtx) {
 	SetMemberGetFuncs(GCtx->MemberGetFuncs);
 
 	// Load error-handling functions
-	SetErrorHandleFuncs(GCtx->ErrorHandleFuncs);
+	if (!SetErrorHandleFuncs(GCtx->ErrorHandleFuncs, ErrFuncsProfile)) {
+		OP << "Unknown error function profile " << ErrFuncsProfile << ", using linux\n";
+		SetErrorHandleFuncs(GCtx->ErrorHandleFuncs, "linux");
+	}
 
 	SetRefcountRelatedFuncs(GCtx->RefcountRelatedFuncs);
 
@@ -157,6 +304,17 @@ void LoadStaticData(GlobalContext *GCtx) {
 	// Load test functions
 	SetTestFuncs(GCtx->TestFuncs);
 
+	// Config categories of the callee classifier
+	CalleeClassifier &CC = GCtx->CalleeClasses;
+	CC.addNameTable(CC_Debug, GCtx->DebugFuncs);
+	CC.addNameTable(CC_AutoFreed, GCtx->AutoFreedFuncs);
+	CC.addNameTable(CC_Escape, GCtx->EscapeFuncs);
+	CC.addNameTable(CC_MemberGet, GCtx->MemberGetFuncs);
+	CC.addNameMap(CC_Refcount, GCtx->RefcountFuncs);
+	CC.addNameTable(CC_RefcountRelated, GCtx->RefcountRelatedFuncs);
+	CC.addNameMap(CC_PairFree, GCtx->PairFuncs);
+	CC.addNameTable(CC_ReleaseFunc, GCtx->ReleaseFuncSet, true);
+
 }
 
 void PrintResults(GlobalContext *GCtx) {
@@ -167,6 +325,8 @@ void PrintResults(GlobalContext *GCtx) {
 	OP<<"# Number of all functions: \t\t\t"<<GCtx->NumFunctions<<"\n";
 	OP<<"# Number of loop functions: \t\t\t"<<GCtx->Loopfuncs.size()<<"\n";
 	OP<<"# Number of long functions: \t\t\t"<<GCtx->Longfuncs.size()<<"\n";
+	OP<<"# Number of duplicate functions: \t\t"<<GCtx->DuplicateFuncs.size()<<"\n";
+	OP<<"# Number of analysis cache evictions: \t\t"<<GCtx->FuncAnalyses.getNumEvictions()<<"\n";
 	OP<<"# Number of bugs:           \t\t\t"<<GCtx->NumBugs<<"\n";
 	OP<<"# Number of all Path Pairs: \t\t\t"<<GCtx->NumPath<<"\n";
 
@@ -176,7 +336,7 @@ void PrintResults(GlobalContext *GCtx) {
 	OP<<"# Number of ReleaseFuncs: \t\t\t"<<GCtx->NumReleaseFucs<<"\n";
 	OP<<"# Number of UnlockFuncs:  \t\t\t"<<GCtx->NumLockRelatedFucs<<"\n";
 
-	int totalnum = 0;
+	int totalnum = GCtx->NumDroppedSecurityOperations;
 	for(auto i = GCtx->SecurityOperationSets.begin(); i!=GCtx->SecurityOperationSets.end();i++){
 		int num = i->second.size();
 		totalnum +=num;
@@ -187,6 +347,83 @@ void PrintResults(GlobalContext *GCtx) {
 }
 
 
+//Print per-pass time and memory, and append them to the stats file
+//so that runs over growing corpora can be compared
+void PrintPassStatistics(GlobalContext *GCtx) {
+
+	unsigned long NumDefinedFuncs = 0;
+	for (auto &MP : GCtx->Modules) {
+		for (Function &F : *MP.first)
+			if (!F.isDeclaration())
+				++NumDefinedFuncs;
+	}
+	unsigned Threads = omp_get_max_threads();
+
+	//Previous rows with the same thread count: pass -> (functions, wall time)
+	map<string, pair<unsigned long, double>> PrevRuns;
+	if (!StatsFile.empty()) {
+		ifstream In(StatsFile);
+		string Line;
+		while (getline(In, Line)) {
+			if (Line.empty() || Line[0] == '#')
+				continue;
+			istringstream Row(Line);
+			string Name;
+			unsigned long Modules, Funcs;
+			unsigned RowThreads;
+			double Wall;
+			if (!(Row >> Name >> Modules >> Funcs >> RowThreads >> Wall))
+				continue;
+			if (RowThreads != Threads || Funcs >= NumDefinedFuncs)
+				continue;
+			//Keep the largest corpus below the current one
+			auto Prev = PrevRuns.find(Name);
+			if (Prev == PrevRuns.end() || Funcs >= Prev->second.first)
+				PrevRuns[Name] = make_pair(Funcs, Wall);
+		}
+	}
+
+	OP<<"\n############## Pass Statistics ##############\n";
+	OP<<"# Modules: "<<GCtx->Modules.size()<<", functions: "<<NumDefinedFuncs
+		<<", threads: "<<Threads<<"\n";
+	OP<<"# Pass                    Wall(s)     CPU(s)  PeakRSS(MB)      Funcs/s\n";
+
+	for (auto &PS : GCtx->PassStats) {
+		double Throughput = PS.WallTime > 0 ? NumDefinedFuncs / PS.WallTime : 0;
+		OP<<format("# %-20s %10.3f %10.3f %12.1f %12.1f",
+			PS.Name.c_str(), PS.WallTime, PS.CPUTime,
+			PS.PeakRSS / 1024.0, Throughput);
+
+		//Growth exponent against the largest smaller corpus on record
+		auto Prev = PrevRuns.find(PS.Name);
+		if (Prev != PrevRuns.end() && Prev->second.first > 0
+			&& Prev->second.second > 0 && PS.WallTime > 0) {
+			double Exp = log(PS.WallTime / Prev->second.second)
+				/ log((double)NumDefinedFuncs / Prev->second.first);
+			if (Exp > 1.5)
+				OP<<KRED<<"  super-linear (n^"<<format("%.2f", Exp)<<")"<<KNRM;
+		}
+		OP<<"\n";
+	}
+
+	for (auto &PS : GCtx->PassStats) {
+		if ((PS.Name == "PairAnalysis" || PS.Name == "Pipeline") && PS.WallTime > 0)
+			OP<<"# Paths/s ("<<PS.Name<<"): \t\t\t"
+				<<format("%.1f", GCtx->NumPath / PS.WallTime)<<"\n";
+	}
+
+	if (StatsFile.empty())
+		return;
+
+	ofstream Out(StatsFile, ios::app);
+	for (auto &PS : GCtx->PassStats) {
+		Out<<PS.Name<<"\t"<<GCtx->Modules.size()<<"\t"<<NumDefinedFuncs
+			<<"\t"<<Threads<<"\t"<<PS.WallTime<<"\t"<<PS.CPUTime
+			<<"\t"<<PS.PeakRSS<<"\t"<<GCtx->NumPath<<"\n";
+	}
+}
+
+
 int main(int argc, char **argv) {
 	// Print a stack trace if we signal out.
 	sys::PrintStackTraceOnErrorSignal(argv[0]);
@@ -197,6 +434,11 @@ int main(int argc, char **argv) {
 	cl::ParseCommandLineOptions(argc, argv, "global analysis\n");
 	SMDiagnostic Err;
 
+	if (NumThreads)
+		omp_set_num_threads(NumThreads);
+
+	GlobalCtx.FuncAnalyses.setMemoryBudget((size_t)AnalysisCacheMB << 20);
+
 	// Loading modules
 	OP << "Total " << InputFilenames.size() << " file(s)\n";
 
@@ -227,42 +469,64 @@ int main(int argc, char **argv) {
 
 	finish_time = clock();
 	GlobalCtx.Load_time = (double)(finish_time - start_time) / CLOCKS_PER_SEC;
+	GlobalCtx.PassStats.push_back({"Load", GlobalCtx.Load_time,
+		GlobalCtx.Load_time, getPeakRSS()});
 
 
-	start_time = clock();
 	// Build global callgraph.
 	CallGraphPass CGPass(&GlobalCtx);
-	CGPass.run(GlobalCtx.Modules);
-	finish_time = clock();
-	GlobalCtx.unroll_time = (double)(finish_time - start_time) / CLOCKS_PER_SEC;
+	GlobalCtx.unroll_time = RunTimedPass(&GlobalCtx, "CallGraph",
+		[&]() {
+			CGPass.run(GlobalCtx.Modules);
+			GlobalCtx.CallerCSR.build(GlobalCtx.Modules, GlobalCtx.Callers);
+			GlobalCtx.CalleeClasses.build(GlobalCtx.Modules);
+			setToolsCalleeClassifier(&GlobalCtx.CalleeClasses);
+		});
 
-	start_time = clock();
 	WrapperAnalysisPass WAPass(&GlobalCtx);
-	WAPass.run(GlobalCtx.Modules);
-	finish_time = clock();
-	GlobalCtx.wrapper_detect_time = (double)(finish_time - start_time) / CLOCKS_PER_SEC;
+	GlobalCtx.wrapper_detect_time = RunTimedPass(&GlobalCtx, "WrapperAnalysis",
+		[&]() { WAPass.run(GlobalCtx.Modules); });
 
 	if(CriticalVar){
 		//Consider write one pass for every security operation
 
-		//Find security checks
-		SecurityChecksPass SCPass(&GlobalCtx);
-		SCPass.run(GlobalCtx.Modules);
-
-		// Pointer analysis
-    	PointerAnalysisPass PTAPass(&GlobalCtx);
-    	PTAPass.run(GlobalCtx.Modules);
+		//Bug reports go to stdout (and report files), progress stays on stderr
+		GlobalCtx.BugReports.open(ReportJSONL, ReportSARIF);
 
-		//Find security operations
+		SecurityChecksPass SCPass(&GlobalCtx);
+		PointerAnalysisPass PTAPass(&GlobalCtx);
+		GlobalCtx.PointerAnalysis = &PTAPass;
 		SecurityOperationsPass SOPass(&GlobalCtx);
-		SOPass.run(GlobalCtx.Modules);
-
-		//Excute path pair collection and comparition
 		PairAnalysisPass PAPass(&GlobalCtx);
-		PAPass.run(GlobalCtx.Modules);
+
+		if (FusePasses) {
+			RunTimedPass(&GlobalCtx, "Pipeline",
+				[&]() { RunFusedPasses(&GlobalCtx, SCPass, PTAPass, SOPass, PAPass); });
+		}
+		else {
+			//Find security checks
+			RunTimedPass(&GlobalCtx, "SecurityChecks",
+				[&]() { SCPass.run(GlobalCtx.Modules); });
+
+			// Pointer analysis
+			RunTimedPass(&GlobalCtx, "PointerAnalysis",
+				[&]() { PTAPass.run(GlobalCtx.Modules); });
+
+			//Find security operations
+			RunTimedPass(&GlobalCtx, "SecurityOperations",
+				[&]() { SOPass.run(GlobalCtx.Modules); });
+
+			//Excute path pair collection and comparition
+			RunTimedPass(&GlobalCtx, "PairAnalysis",
+				[&]() { PAPass.run(GlobalCtx.Modules); });
+		}
+
+		GlobalCtx.BugReports.close();
+		GlobalCtx.PointerAnalysis = NULL;
 	}
 
 	PrintResults(&GlobalCtx);
+	PrintPassStatistics(&GlobalCtx);
 	return 0;
 }
 
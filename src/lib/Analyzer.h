@@ -21,6 +21,11 @@
 #include <string>
 
 #include "Common.h"
+#include "BugReport.h"
+#include "CallerGraph.h"
+#include "NameSet.h"
+#include "CalleeClassifier.h"
+#include "FunctionAnalysisCache.h"
 
 
 // 
@@ -40,7 +45,35 @@ typedef llvm::DenseMap<llvm::CallInst *, FuncSet> CalleeMap;
 typedef std::map<llvm::Value *, std::set<llvm::Value *>> PointerAnalysisMap;
 typedef std::map<llvm::Function *, PointerAnalysisMap> FuncPointerAnalysisMap;
 typedef std::map<llvm::Function *, AAResults *> FuncAAResultsMap;
-typedef std::map<llvm::Function *, PointerAnalysisMap> FuncStructAnalysisMap;
+
+class PointerAnalysisPass;
+
+// Effects of a function, bit i of a mask is set if the function (or a
+// function it calls) applies the effect to argument i.
+struct FuncEffectSummary {
+	uint64_t Releases = 0;
+	uint64_t Locks = 0;
+	uint64_t Unlocks = 0;
+	// May return an error as SecurityChecksPass and PairAnalysisPass
+	// tell errnos apart
+	bool MayReturnErr = false;
+	bool MayReturnPairErr = false;
+
+	bool operator==(const FuncEffectSummary &S) const {
+		return Releases == S.Releases && Locks == S.Locks
+			&& Unlocks == S.Unlocks && MayReturnErr == S.MayReturnErr
+			&& MayReturnPairErr == S.MayReturnPairErr;
+	}
+	bool operator!=(const FuncEffectSummary &S) const { return !(*this == S); }
+};
+
+// Per-pass resource usage, recorded by the driver.
+struct PassStatistic {
+	std::string Name;
+	double WallTime;	// seconds
+	double CPUTime;		// seconds, summed over all threads
+	long PeakRSS;		// KB, process high-water mark after the pass
+};
 
 struct GlobalContext {
 
@@ -62,11 +95,11 @@ struct GlobalContext {
 	unsigned NumFunctions;
 	unsigned NumSecurityChecks;
 
-	set<string> SkipFuncs;
-	set<string> TestFuncs;
-	set<string> AutoFreedFuncs;
-	set<string> EscapeFuncs;
-	set<string> MemberGetFuncs;
+	NameSet SkipFuncs;
+	NameSet TestFuncs;
+	NameSet AutoFreedFuncs;
+	NameSet EscapeFuncs;
+	NameSet MemberGetFuncs;
 
 	// Map global function name to function defination.
 	NameFuncMap Funcs;
@@ -80,6 +113,15 @@ struct GlobalContext {
 	// Map a function to all potential caller instructions.
 	CallerMap Callers;
 
+	// Callers in CSR form, built once the call graph is complete.
+	CallerGraph CallerCSR;
+
+	// Per-function analyses shared by the passes.
+	FunctionAnalysisCache FuncAnalyses;
+
+	// Category mask of every callee, built with the call graph.
+	CalleeClassifier CalleeClasses;
+
 	// Indirect call instructions.
 	std::vector<CallInst *>IndirectCallInsts;
 
@@ -91,10 +133,12 @@ struct GlobalContext {
 	std::map<std::string, uint8_t> MemWriteFuncs;
 	std::set<std::string> CriticalFuncs;
 
-	// Pinter analysis results.
+	// Pinter analysis results, filled only when alias queries are enabled.
 	FuncPointerAnalysisMap FuncPAResults;
 	FuncAAResultsMap FuncAAResults;
-	FuncStructAnalysisMap FuncStructResults;
+
+	// Answers struct relation queries of the checkers.
+	PointerAnalysisPass *PointerAnalysis = NULL;
 
 	/******SecurityCheck methods******/
 
@@ -102,13 +146,22 @@ struct GlobalContext {
 	DenseMap<size_t, Function *>UnifiedFuncMap;
 	set<Function *>UnifiedFuncSet;
 
-	// Map function signature to functions
+	// Functions with identical bodies across modules: a body hash match
+	// (funcBodyHash) is confirmed by funcBodyEqual and, once the call
+	// graph is built, by calls resolving to the same callees. Each copy
+	// maps to the first one seen, which is the only one analyzed by the
+	// downstream passes
+	DenseMap<size_t, Function *>BodyHashFuncMap;
+	DenseMap<Function *, Function *>DuplicateFuncs;
+	DenseMap<Function *, std::vector<Function *>>FuncCopies;
+
+	// Map argument signature (funcArgSigHash) to address-taken functions
 	DenseMap<size_t, FuncSet>sigFuncsMap;
 
 	// SecurityChecksPass
 	// Functions handling errors
-	set<string> ErrorHandleFuncs;
-	set<string> RefcountRelatedFuncs;
+	NameSet ErrorHandleFuncs;
+	NameSet RefcountRelatedFuncs;
 	map<string, tuple<int8_t, int8_t, int8_t>> CopyFuncs;
 
 	// Identified sanity checks
@@ -124,14 +177,29 @@ struct GlobalContext {
 	unsigned NumLockRelatedFucs = 0;
 
 	map<string, pair<uint8_t, int8_t>> InitFuncs;
-	set<string> HeapAllocFuncs;
+	NameSet HeapAllocFuncs;
 	map<string, set<string>> PairFuncs;
-	set<string> PairFuncs_Lead;
+	NameSet PairFuncs_Lead;
 	map<string, set<string>> RefcountFuncs;
 
 	//Identify security operations
-	DenseMap<Function *, set<SecurityOperation>> SecurityOperationSets;
-	set<string> ReleaseFuncSet;
+	DenseMap<Function *, SecurityOperationTable> SecurityOperationSets;
+	// Operations of functions whose results were already dropped by
+	// the fused pipeline
+	unsigned long NumDroppedSecurityOperations = 0;
+	NameSet ReleaseFuncSet;
+
+	// Effect summary per function (CallerCSR ID), computed bottom-up
+	// by WrapperAnalysis
+	std::vector<FuncEffectSummary> FuncSummaries;
+
+	const FuncEffectSummary &getFuncSummary(llvm::Function *F) const {
+		static const FuncEffectSummary Empty;
+		unsigned ID = CallerCSR.getID(F);
+		if (ID == CallerGraph::InvalidID || ID >= FuncSummaries.size())
+			return Empty;
+		return FuncSummaries[ID];
+	}
 
 	/******Path pair analysis methods******/
 	unsigned NumPathPairs = 0;
@@ -139,11 +207,12 @@ struct GlobalContext {
 	unsigned long long NumBlock = 0;
 	unsigned long long NumInst = 0;
 	unsigned NumBugs = 0;
+	BugReportSink BugReports;
 	set<Function *> Loopfuncs;
 	set<Function *> Longfuncs;
-	set<string> DebugFuncs;
-	set<string> BinaryOperandInsts;
-	set<string> SingleOperandInsts;
+	NameSet DebugFuncs;
+	NameSet BinaryOperandInsts;
+	NameSet SingleOperandInsts;
 
 	/******Time analysis methods******/
 	double Load_time = 0;
@@ -157,6 +226,7 @@ struct GlobalContext {
 	double cross_check_time = 0;
 	double security_check_time = 0;
 	double security_check_analysis = 0;
+	std::vector<PassStatistic> PassStats;
 
 };
 
@@ -0,0 +1,356 @@
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/JSON.h>
+
+#include <algorithm>
+
+#include "BugReport.h"
+#include "Common.h"
+#include "Tools.h"
+
+using namespace llvm;
+
+//JSON strings must be valid UTF-8
+static json::Value toJSONString(const std::string &S) {
+	if (json::isUTF8(S))
+		return S;
+	return json::fixUTF8(S);
+}
+
+static json::Array toJSONArray(const std::vector<std::string> &V) {
+	json::Array A;
+	for (auto &S : V)
+		A.push_back(toJSONString(S));
+	return A;
+}
+
+ModuleSlotTracker &ReportSymbolizer::getSlotTracker(Function *F) {
+
+	Module *M = F->getParent();
+	if (M != TrackedModule) {
+		MST.reset(new ModuleSlotTracker(M, false));
+		TrackedModule = M;
+		TrackedFunc = nullptr;
+	}
+	if (F != TrackedFunc) {
+		MST->incorporateFunction(*F);
+		TrackedFunc = F;
+	}
+	return *MST;
+}
+
+//Unnamed blocks are numbered per function, so name all blocks of the
+//function at once
+const std::string &ReportSymbolizer::getBlockName(BasicBlock *BB) {
+
+	static const std::string NullBlock = "NULL block";
+	if (!BB)
+		return NullBlock;
+
+	auto It = BlockNames.find(BB);
+	if (It != BlockNames.end())
+		return It->second;
+
+	Function *F = BB->getParent();
+	ModuleSlotTracker &Tracker = getSlotTracker(F);
+	for (BasicBlock &B : *F) {
+		std::string Str;
+		raw_string_ostream OS(Str);
+		B.printAsOperand(OS, false, Tracker);
+		BlockNames[&B] = OS.str();
+	}
+	return BlockNames[BB];
+}
+
+const std::string &ReportSymbolizer::getValueContent(Value *V) {
+
+	auto It = ValueContents.find(V);
+	if (It != ValueContents.end())
+		return It->second;
+
+	Function *F = NULL;
+	if (Instruction *I = dyn_cast<Instruction>(V))
+		F = I->getFunction();
+	else if (Argument *A = dyn_cast<Argument>(V))
+		F = A->getParent();
+
+	std::string Str;
+	raw_string_ostream OS(Str);
+	if (F)
+		V->print(OS, getSlotTracker(F), false);
+	else
+		V->print(OS, false);
+	return ValueContents[V] = OS.str();
+}
+
+int ReportSymbolizer::getLineNo(Instruction *I) {
+
+	if (!I)
+		return -1;
+
+	auto It = LineNos.find(I);
+	if (It != LineNos.end())
+		return It->second;
+	return LineNos[I] = getInstLineNo(I);
+}
+
+const std::string &ReportSymbolizer::getFilename(Instruction *I) {
+
+	auto It = Filenames.find(I);
+	if (It != Filenames.end())
+		return It->second;
+	return Filenames[I] = getInstFilename(I);
+}
+
+void ReportSymbolizer::symbolize(BugReport &R) {
+
+	if (R.Func)
+		R.Function = R.Func->getName().str();
+	for (Function *F : R.FuncCopies)
+		R.CopyModules.push_back(F->getParent()->getModuleIdentifier());
+	if (R.FileInst)
+		R.File = getFilename(R.FileInst);
+	if (R.StartBB)
+		R.StartBlock = getBlockName(R.StartBB);
+	for (BasicBlock *BB : R.PathWithBBs)
+		R.PathWithBlocks.push_back(getBlockName(BB));
+	for (BasicBlock *BB : R.PathWithoutBBs)
+		R.PathWithoutBlocks.push_back(getBlockName(BB));
+	R.BranchLine = getLineNo(R.BranchInst);
+	R.OperationLine = getLineNo(R.OperationInst);
+	if (R.Operation.empty() && R.OperationValue)
+		R.Operation = getValueContent(R.OperationValue);
+	if (R.Target)
+		R.TargetValue = getValueContent(R.Target);
+
+	for (auto &D : R.RawDetails) {
+		std::string Label = D.Label;
+		if (D.LineInst)
+			Label += "(" + std::to_string(getLineNo(D.LineInst)) + ")";
+
+		std::string Text = D.Text;
+		if (D.V) {
+			Text = getValueContent(D.V);
+			if (D.From)
+				Text += " <- " + getValueContent(D.From);
+		}
+		R.Details.push_back(std::make_pair(Label, Text));
+	}
+}
+
+bool BugReportSink::open(const std::string &JSONLPath,
+	const std::string &SARIFPath_) {
+
+	if (Running)
+		return true;
+
+	if (!JSONLPath.empty()) {
+		std::error_code EC;
+		JSONLOut.reset(new raw_fd_ostream(JSONLPath, EC, sys::fs::OF_None));
+		if (EC) {
+			OP << "Cannot open bug report file " << JSONLPath << ": " << EC.message() << "\n";
+			JSONLOut.reset();
+			return false;
+		}
+	}
+	SARIFPath = SARIFPath_;
+
+	Stopping = false;
+	Running = true;
+	Writer = std::thread(&BugReportSink::writerLoop, this);
+	return true;
+}
+
+unsigned BugReportSink::submit(BugReport &&R) {
+
+	std::unique_lock<std::mutex> Lock(QueueLock);
+	R.ID = NextID++;
+	unsigned ID = R.ID;
+
+	//No writer: print in place
+	if (!Running) {
+		Symbolizer.symbolize(R);
+		writeText(R);
+		return ID;
+	}
+
+	Queue.push_back(std::move(R));
+	Lock.unlock();
+	QueueCond.notify_one();
+	return ID;
+}
+
+void BugReportSink::close() {
+
+	if (!Running)
+		return;
+
+	{
+		std::lock_guard<std::mutex> Lock(QueueLock);
+		Stopping = true;
+	}
+	QueueCond.notify_one();
+	Writer.join();
+	Running = false;
+
+	if (JSONLOut) {
+		JSONLOut->close();
+		JSONLOut.reset();
+	}
+	writeSARIF();
+	outs().flush();
+}
+
+void BugReportSink::writerLoop() {
+
+	std::deque<BugReport> Batch;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> Lock(QueueLock);
+			QueueCond.wait(Lock, [this]{ return Stopping || !Queue.empty(); });
+			if (Queue.empty() && Stopping)
+				return;
+			Batch.swap(Queue);
+		}
+
+		//Write the batch without holding the queue lock
+		for (auto &R : Batch) {
+			Symbolizer.symbolize(R);
+			writeText(R);
+			writeJSONL(R);
+			if (!SARIFPath.empty())
+				SARIFResults.push_back(std::move(R));
+		}
+		Batch.clear();
+		outs().flush();
+	}
+}
+
+static void writeTextPath(raw_ostream &OS, int Idx,
+	const std::vector<std::string> &Blocks) {
+
+	OS << "--Path " << Idx << ":  ";
+	for (auto &B : Blocks)
+		OS << "Block-" << B << " ";
+	OS << "\n";
+}
+
+void BugReportSink::writeText(const BugReport &R) {
+
+	raw_ostream &OS = outs();
+	OS << "\n=============================\n";
+	OS.changeColor(raw_ostream::RED);
+	OS << "Warning: find a potential bug:\n";
+	OS.resetColor();
+	OS << "Global Bug num:" << R.ID << "\n";
+	OS << "File name: " << R.File << "\n";
+	OS << "Function: " << R.Function << "\n";
+	if (!R.CopyModules.empty())
+		OS << "Identical copies: " << R.CopyModules.size() << "\n";
+	OS << "Bug Type: " << R.BugType << "\n";
+	OS << "-----------------------------\n";
+	OS << "Current path pair start at block-" << R.StartBlock << "\n";
+	OS << R.Description << "\n";
+	writeTextPath(OS, R.PathWith, R.PathWithBlocks);
+	writeTextPath(OS, R.PathWithout, R.PathWithoutBlocks);
+	OS << "--Branch from line " << R.BranchLine << "\n";
+	OS << "-----------------------------\n";
+	if (!R.TargetValue.empty())
+		OS << "Target value: " << R.TargetValue << "\n";
+	OS << R.OperationKind << "(" << R.OperationLine << "): " << R.Operation << "\n";
+	for (auto &D : R.Details)
+		OS << D.first << ": " << D.second << "\n";
+	OS << "=============================\n";
+}
+
+void BugReportSink::writeJSONL(const BugReport &R) {
+
+	if (!JSONLOut)
+		return;
+
+	json::Array Details;
+	for (auto &D : R.Details) {
+		Details.push_back(json::Object{
+			{"label", toJSONString(D.first)},
+			{"value", toJSONString(D.second)}});
+	}
+
+	json::Object Record{
+		{"id", R.ID},
+		{"function", toJSONString(R.Function)},
+		{"copies", toJSONArray(R.CopyModules)},
+		{"file", toJSONString(R.File)},
+		{"bug_type", R.BugType},
+		{"start_block", toJSONString(R.StartBlock)},
+		{"path_with", json::Object{
+			{"index", R.PathWith},
+			{"blocks", toJSONArray(R.PathWithBlocks)}}},
+		{"path_without", json::Object{
+			{"index", R.PathWithout},
+			{"blocks", toJSONArray(R.PathWithoutBlocks)}}},
+		{"branch_line", R.BranchLine},
+		{"operation_kind", R.OperationKind},
+		{"operation", toJSONString(R.Operation)},
+		{"operation_line", R.OperationLine},
+		{"target_value", toJSONString(R.TargetValue)},
+		{"details", std::move(Details)},
+	};
+
+	*JSONLOut << json::Value(std::move(Record)) << "\n";
+}
+
+void BugReportSink::writeSARIF() {
+
+	if (SARIFPath.empty())
+		return;
+
+	std::error_code EC;
+	raw_fd_ostream OS(SARIFPath, EC, sys::fs::OF_None);
+	if (EC) {
+		OP << "Cannot open SARIF file " << SARIFPath << ": " << EC.message() << "\n";
+		return;
+	}
+
+	//One rule per bug type, in order of first appearance
+	std::vector<std::string> RuleIDs;
+	json::Array Rules;
+	json::Array Results;
+	for (auto &R : SARIFResults) {
+
+		if (std::find(RuleIDs.begin(), RuleIDs.end(), R.BugType) == RuleIDs.end()) {
+			RuleIDs.push_back(R.BugType);
+			Rules.push_back(json::Object{
+				{"id", R.BugType},
+				{"shortDescription", json::Object{{"text", R.BugType}}}});
+		}
+
+		json::Object Region;
+		if (R.BranchLine > 0)
+			Region["startLine"] = R.BranchLine;
+
+		Results.push_back(json::Object{
+			{"ruleId", R.BugType},
+			{"level", "warning"},
+			{"message", json::Object{{"text",
+				toJSONString(R.Description + " (" + R.OperationKind + ": " + R.Operation + ")")}}},
+			{"locations", json::Array{json::Object{
+				{"physicalLocation", json::Object{
+					{"artifactLocation", json::Object{{"uri", toJSONString(R.File)}}},
+					{"region", std::move(Region)}}},
+				{"logicalLocations", json::Array{json::Object{
+					{"name", toJSONString(R.Function)},
+					{"kind", "function"}}}}}}},
+		});
+	}
+
+	json::Object Log{
+		{"version", "2.1.0"},
+		{"$schema", "https://json.schemastore.org/sarif-2.1.0.json"},
+		{"runs", json::Array{json::Object{
+			{"tool", json::Object{{"driver", json::Object{
+				{"name", "IPPO"},
+				{"rules", std::move(Rules)}}}}},
+			{"results", std::move(Results)}}}},
+	};
+
+	OS << json::Value(std::move(Log)) << "\n";
+}
@@ -0,0 +1,133 @@
+#ifndef _BUG_REPORT_H
+#define _BUG_REPORT_H
+
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/ModuleSlotTracker.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+//A checker specific line of a report. Raw values are resolved by the writer.
+struct BugReportDetail {
+	std::string Label;
+	llvm::Instruction *LineInst = nullptr;  //Label gets "(line)" appended
+	llvm::Value *V = nullptr;
+	llvm::Value *From = nullptr;            //Printed as "V <- From"
+	std::string Text;                       //Used when V is null
+};
+
+//One detected bug. Path j carries the security operation, path i misses it.
+//Checkers only record IR handles; names, lines and IR text are filled in
+//by the writer thread (see ReportSymbolizer).
+struct BugReport {
+	unsigned ID = 0;            //Assigned by the sink
+
+	//Recorded by the checkers
+	llvm::Function *Func = nullptr;
+	std::vector<llvm::Function *> FuncCopies;   //Identical bodies in other modules
+	llvm::Instruction *FileInst = nullptr;
+	llvm::BasicBlock *StartBB = nullptr;
+	std::vector<llvm::BasicBlock *> PathWithBBs;
+	std::vector<llvm::BasicBlock *> PathWithoutBBs;
+	llvm::Instruction *BranchInst = nullptr;
+	llvm::Instruction *OperationInst = nullptr;
+	llvm::Value *OperationValue = nullptr;  //Printed when Operation is empty
+	llvm::Value *Target = nullptr;
+	std::vector<BugReportDetail> RawDetails;
+
+	std::string BugType;
+	std::string Description;
+	int PathWith = -1;          //j
+	int PathWithout = -1;       //i
+
+	//The operation found only in PathWith (release/unlock/refcount func, checked var)
+	std::string OperationKind;
+	std::string Operation;
+
+	//Resolved by the symbolizer
+	std::string Function;
+	std::vector<std::string> CopyModules;
+	std::string File;
+	std::string StartBlock;
+	std::vector<std::string> PathWithBlocks;
+	std::vector<std::string> PathWithoutBlocks;
+	int BranchLine = -1;
+	int OperationLine = -1;
+	std::string TargetValue;
+	std::vector<std::pair<std::string, std::string>> Details;
+};
+
+//Resolves the IR handles of a report into text. Block names and debug
+//locations are computed once per function/instruction and cached, and one
+//slot tracker is shared by all prints within a function.
+class ReportSymbolizer {
+
+	public:
+		void symbolize(BugReport &R);
+
+	private:
+		const std::string &getBlockName(llvm::BasicBlock *BB);
+		const std::string &getValueContent(llvm::Value *V);
+		int getLineNo(llvm::Instruction *I);
+		const std::string &getFilename(llvm::Instruction *I);
+		llvm::ModuleSlotTracker &getSlotTracker(llvm::Function *F);
+
+		llvm::DenseMap<llvm::BasicBlock *, std::string> BlockNames;
+		llvm::DenseMap<llvm::Value *, std::string> ValueContents;
+		llvm::DenseMap<llvm::Instruction *, int> LineNos;
+		llvm::DenseMap<llvm::Instruction *, std::string> Filenames;
+
+		llvm::Module *TrackedModule = nullptr;
+		llvm::Function *TrackedFunc = nullptr;
+		std::unique_ptr<llvm::ModuleSlotTracker> MST;
+};
+
+//Collects bug reports from the checkers, symbolizes and writes them from a
+//background thread, so checkers never wait on output. Reports are printed
+//as text to stdout, and optionally as JSONL records and a SARIF log.
+class BugReportSink {
+
+	public:
+		BugReportSink() {}
+		~BugReportSink() { close(); }
+
+		//Start the writer. Empty paths disable the corresponding format.
+		bool open(const std::string &JSONLPath, const std::string &SARIFPath);
+
+		//Queue a report; returns its ID
+		unsigned submit(BugReport &&R);
+
+		//Drain the queue, write the SARIF log and stop the writer
+		void close();
+
+	private:
+		void writerLoop();
+		void writeText(const BugReport &R);
+		void writeJSONL(const BugReport &R);
+		void writeSARIF();
+
+		std::deque<BugReport> Queue;
+		std::mutex QueueLock;
+		std::condition_variable QueueCond;
+		bool Stopping = false;
+		bool Running = false;
+		unsigned NextID = 0;
+
+		std::thread Writer;
+		ReportSymbolizer Symbolizer;
+		std::unique_ptr<llvm::raw_fd_ostream> JSONLOut;
+		std::string SARIFPath;
+
+		//Reports kept for the SARIF log, which is one document
+		std::vector<BugReport> SARIFResults;
+};
+
+#endif
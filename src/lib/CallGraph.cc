@@ -24,6 +24,7 @@
 #include "llvm/Analysis/LoopPass.h"
 #include <llvm/IR/LegacyPassManager.h>
 #include <map> 
+#include <deque>
 #include <vector> 
 #include "llvm/IR/CFG.h" 
 #include "llvm/Transforms/Utils/BasicBlockUtils.h" 
@@ -35,234 +36,95 @@
 
 using namespace llvm;
 
+//Kahn's algorithm with a ready queue, self-loops are ignored.
 //return true if sort successed, or return false (there is a loop inside function)
-bool CallGraphPass::topSort(Function *F){
+bool CallGraphPass::topSort(Function *F, vector<BasicBlock *> &Order){
+
+	Order.clear();
 	if(!F){
 		return true;
 	}
 
-	map<BasicBlock*,int> indegreeMap;
-	BasicBlock* currentblock;
-	indegreeMap.clear();
-
-	//init
-	for (Function::iterator b = F->begin(), e = F->end();
-		b != e; ++b) {
-        BasicBlock * B = &*b;
-		pair<BasicBlock*,int> value(B,0);
-        indegreeMap.insert(value);
-    }
-
-	//init indegreeMap
-	for (Function::iterator b = F->begin(), e = F->end();
-		b != e; ++b) {
-        BasicBlock * B = &*b;
-
-		for (BasicBlock *Succ : successors(B)) {
-			if(Succ == B)
+	DenseMap<BasicBlock *, unsigned> indegreeMap;
+	for (BasicBlock &B : *F)
+		indegreeMap[&B] = 0;
+
+	for (BasicBlock &B : *F) {
+		for (BasicBlock *Succ : successors(&B)) {
+			if(Succ == &B)
 				continue;
 			indegreeMap[Succ]++;
 		}
-    }
-
-	bool found = false;
-	while(!indegreeMap.empty()){
-
-		found = false;
-		//find a block with 0 indegree
-		for(auto it = indegreeMap.begin(); it != indegreeMap.end(); it++){
-			if(it->second==0){
-				currentblock = it->first;
-				found=true;
-				break;
-			}
-		}
+	}
 
-		if(!found){
-			return false;
-		}
+	std::deque<BasicBlock *> readyQueue;
+	for (BasicBlock &B : *F) {
+		if(indegreeMap[&B] == 0)
+			readyQueue.push_back(&B);
+	}
+
+	Order.reserve(F->size());
+	while(!readyQueue.empty()){
+		BasicBlock *currentblock = readyQueue.front();
+		readyQueue.pop_front();
+		Order.push_back(currentblock);
 
 		for (BasicBlock *Succ : successors(currentblock)) {
 			if(Succ == currentblock)
 				continue;
-			indegreeMap[Succ]--;
+			if(--indegreeMap[Succ] == 0)
+				readyQueue.push_back(Succ);
 		}
-
-		indegreeMap.erase(currentblock);
-
 	}
-	return true;
 
+	//Blocks left over are on a cycle
+	return Order.size() == F->size();
 }
 
 // Find targets of indirect calls based on type analysis: as long as
 // the number and type of parameters of a function matches with the
 // ones of the callsite, we say the function is a possible target of
-// this call.
+// this call. Address-taken functions are indexed in sigFuncsMap by
+// their argument signature (see argTypeSigHash), so a call site is
+// answered by one lookup; only var-arg functions are scanned.
 void CallGraphPass::findCalleesByType(CallInst *CI, FuncSet &S) {
 
 	if (CI->isInlineAsm())
 		return;
 
-	CallSite CS(CI);
-	for (Function *F : Ctx->AddressTakenFuncs) {
-
-		// VarArg
-		if (F->getFunctionType()->isVarArg()) {
-			// Compare only known args in VarArg.
-		}
-		// otherwise, the numbers of args should be equal.
-		else if (F->arg_size() != CS.arg_size()) {
-			continue;
-		}
+	vector<size_t> ArgHashes;
+	callArgSigHashes(CI, ArgHashes);
 
-		if (F->isIntrinsic()) {
-			continue;
-		}
-
-		// Type matching on args.
-		bool Matched = true;
-		CallSite::arg_iterator AI = CS.arg_begin();
-		for (Function::arg_iterator FI = F->arg_begin(), 
-				FE = F->arg_end();
-				FI != FE; ++FI, ++AI) {
-			// Check type mis-matches.
-			// Get defined type on callee side.
-			Type *DefinedTy = FI->getType();
-			// Get actual type on caller side.
-			Type *ActualTy = (*AI)->getType();
-
-			if (DefinedTy == ActualTy)
-				continue;
-
-			// FIXME: this is a tricky solution for disjoint
-			// types in different modules. A more reliable
-			// solution is required to evaluate the equality
-			// of two types from two different modules.
-			// Since each module has its own type table, same
-			// types are duplicated in different modules. This
-			// makes the equality evaluation of two types from
-			// two modules very hard, which is actually done
-			// at link time by the linker.
-			while (DefinedTy->isPointerTy() && ActualTy->isPointerTy()) {
-				DefinedTy = DefinedTy->getPointerElementType();
-				ActualTy = ActualTy->getPointerElementType();
-			}
-			if (DefinedTy->isStructTy() && ActualTy->isStructTy() &&
-				(DefinedTy->getStructName().equals(ActualTy->getStructName())))
-				continue;
-			if (DefinedTy->isIntegerTy() && ActualTy->isIntegerTy() &&
-				DefinedTy->getIntegerBitWidth() == ActualTy->getIntegerBitWidth())
-				continue;
-			// TODO: more types to be supported.
-
-			// Make the type analysis conservative: assume universal
-			// pointers, i.e., "void *" and "char *", are equivalent to 
-			// any pointer type and integer type.
-			if (
-				(DefinedTy == Int8PtrTy &&
-					(ActualTy->isPointerTy() || ActualTy == IntPtrTy)) 
-				||
-				(ActualTy == Int8PtrTy &&
-					(DefinedTy->isPointerTy() || DefinedTy == IntPtrTy))
-				)
-				continue;
-			else {
-				#if 0 // for debugging
-				if (F->getName().compare("nfs_fs_mount") == 0) {
-				OP << "DefinedTy @ " << DefinedTy << ": " << *DefinedTy << "\n";
-				OP << "ActualTy @ " << ActualTy << ": " << *ActualTy << "\n";
-				}
-				#endif
-						Matched = false;
-						break;
-			}
-		}
-
-		if (Matched)
+	size_t Sig = hash_combine_range(ArgHashes.begin(), ArgHashes.end());
+	auto It = Ctx->sigFuncsMap.find(Sig);
+	if (It != Ctx->sigFuncsMap.end()) {
+		for (Function *F : It->second)
 			S.insert(F);
 	}
-}
-
-bool CallGraphPass::checkLoop(Function *F){
-	if (F->isDeclaration())
-		return false;
 
-	DominatorTree DT = DominatorTree();
-	DT.recalculate(*F);
-	LoopInfo *LI = new LoopInfo();
-	LI->releaseMemory();
-	LI->analyze(DT);
-
-	// Collect all loops in the function
-	set<Loop *> LPSet;
-	for (LoopInfo::iterator i = LI->begin(), e = LI->end(); i!=e; ++i) {
-
-		Loop *LP = *i;
-		LPSet.insert(LP);
-
-		list<Loop *> LPL;
-
-		LPL.push_back(LP);
-		while (!LPL.empty()) {
-			LP = LPL.front();
-			LPL.pop_front();
-			vector<Loop *> SubLPs = LP->getSubLoops();
-			for (auto SubLP : SubLPs) {
-				LPSet.insert(SubLP);
-				LPL.push_back(SubLP);
-			}
-		}
-	}
-
-	if(LPSet.empty())
-		return false;
-	else{
-		//OP << "Warning: loop failed once\n";
-		int Loopnum = LPSet.size();
-		for(Function::iterator b = F->begin(); 
-            b != F->end(); b++){
-			
-			BasicBlock* bb = &*b;
-			auto TI = bb->getTerminator();
-			int NumSucc = TI->getNumSuccessors();
-			
-			if(NumSucc == 0)
-				continue;
-
-			for(BasicBlock *succblock : successors(bb)){
-				
-				if(succblock==bb){
-					Loopnum--;
-					continue;
-				}
-			}
-		}
-
-		if(Loopnum<1){
-			return false;
-		}
-			
-		else 
-			return true;
+	// VarArg: compare only known args
+	for (auto &VF : VarArgFuncs) {
+		Function *F = VF.first;
+		if (F->arg_size() > ArgHashes.size())
+			continue;
+		size_t PrefixSig = hash_combine_range(ArgHashes.begin(),
+			ArgHashes.begin() + F->arg_size());
+		if (PrefixSig == VF.second)
+			S.insert(F);
 	}
-
 }
 
-void CallGraphPass::unrollLoops(Function *F) {
+// DT and LI are computed before unrolling and are not updated.
+// Runs on worker threads, so failures are counted, not printed.
+unsigned CallGraphPass::unrollLoops(Function *F, DominatorTree &DT, LoopInfo &LI) {
 
+	unsigned NumErrors = 0;
 	if (F->isDeclaration())
-		return;
-
-	DominatorTree DT = DominatorTree();
-	DT.recalculate(*F);
-	LoopInfo *LI = new LoopInfo();
-	LI->releaseMemory();
-	LI->analyze(DT);
+		return NumErrors;
 
 	// Collect all loops in the function
 	set<Loop *> LPSet;
-	for (LoopInfo::iterator i = LI->begin(), e = LI->end(); i!=e; ++i) {
+	for (LoopInfo::iterator i = LI.begin(), e = LI.end(); i!=e; ++i) {
 
 		Loop *LP = *i;
 		LPSet.insert(LP);
@@ -293,7 +155,7 @@ void CallGraphPass::unrollLoops(Function *F) {
 
 		for (BasicBlock *LatchB : LatchBS) {
 			if (!HeaderB || !LatchB) {
-				OP<<"ERROR: Cannot find Header Block or Latch Block\n";
+				++NumErrors;
 				continue;
 			}
 
@@ -400,7 +262,7 @@ void CallGraphPass::unrollLoops(Function *F) {
 
 		for (BasicBlock *LatchB : LatchBS) {
 			if (!HeaderB || !LatchB) {
-				OP<<"ERROR: Cannot find Header Block or Latch Block\n";
+				++NumErrors;
 				continue;
 			}
 			
@@ -413,20 +275,25 @@ void CallGraphPass::unrollLoops(Function *F) {
 			}
 		}
 	}
+
+	return NumErrors;
 }
 
 bool CallGraphPass::doInitialization(Module *M) {
 
-	DL = &(M->getDataLayout());
-	Int8PtrTy = Type::getInt8PtrTy(M->getContext());
-	IntPtrTy = DL->getIntPtrType(M->getContext());
-
 	for (Function &F : *M) { 
 
 		// Collect address-taken functions.
 		if (F.hasAddressTaken()){
 			Ctx->AddressTakenFuncs.insert(&F);
-			Ctx->sigFuncsMap[funcHash(&F, false)].insert(&F);
+
+			// Index possible indirect-call targets by signature
+			if (!F.isIntrinsic()) {
+				if (F.getFunctionType()->isVarArg())
+					VarArgFuncs[&F] = funcArgSigHash(&F);
+				else
+					Ctx->sigFuncsMap[funcArgSigHash(&F)].insert(&F);
+			}
 		}	
 
 		// Collect global function definitions.
@@ -446,78 +313,191 @@ bool CallGraphPass::doInitialization(Module *M) {
 		if (Ctx->UnifiedFuncMap.find(fh) == Ctx->UnifiedFuncMap.end()) {
 			Ctx->UnifiedFuncMap[fh] = &F;
 			Ctx->UnifiedFuncSet.insert(&F);
+		}
 
-			if (F.hasAddressTaken()) {
-				Ctx->sigFuncsMap[funcHash(&F, false)].insert(&F);
-			}
+		// Functions with the same body are analyzed once. The copy is
+		// confirmed in doFinalization, once the callees are known.
+		if (!F.empty()) {
+			size_t bh = funcBodyHash(&F);
+			auto It = Ctx->BodyHashFuncMap.find(bh);
+			if (It == Ctx->BodyHashFuncMap.end())
+				Ctx->BodyHashFuncMap[bh] = &F;
+			else if (funcBodyEqual(&F, It->second))
+				CopyCandidates[&F] = It->second;
 		}
 	}
 
 	return false;
 }
 
-bool CallGraphPass::doFinalization(Module *M) {
-	return false;
+// The function a callee stands for in every module: declarations
+// resolve to the definition of that name (NULL if there is none, as in
+// Ctx->Callees), copies to the analyzed copy
+Function *CallGraphPass::resolveCopy(Function *F) {
+
+	if (F && F->isDeclaration()) {
+		auto It = Ctx->Funcs.find(F->getName().str());
+		F = It == Ctx->Funcs.end() ? NULL : It->second;
+	}
+	if (!F)
+		return NULL;
+	auto It = Ctx->DuplicateFuncs.find(F);
+	return It == Ctx->DuplicateFuncs.end() ? F : It->second;
 }
 
-bool CallGraphPass::doModulePass(Module *M) {
+// F and its copy G have the same body. Check that their function
+// operands and the possible callees of their calls are the same
+// functions, so their effects are the same.
+bool CallGraphPass::sameCallees(Function *F, Function *G) {
 
-	// Use type-analysis to concervatively find possible targets of 
-	// indirect calls.
-	for (Module::iterator f = M->begin(), fe = M->end(); 
-			f != fe; ++f) {
+	for (inst_iterator i = inst_begin(F), j = inst_begin(G), e = inst_end(F);
+			i != e; ++i, ++j) {
 
-		Function *F = &*f;
+		for (unsigned k = 0; k < i->getNumOperands(); ++k) {
+			Function *FF = dyn_cast<Function>(i->getOperand(k)->stripPointerCasts());
+			Function *GF = dyn_cast<Function>(j->getOperand(k)->stripPointerCasts());
+			if (FF && GF && resolveCopy(FF) != resolveCopy(GF))
+				return false;
+		}
 
-		//Unroll loops
-		unrollLoops(F);
+		CallInst *CI = dyn_cast<CallInst>(&*i);
+		if (!CI)
+			continue;
+		auto FIt = Ctx->Callees.find(CI);
+		auto GIt = Ctx->Callees.find(cast<CallInst>(&*j));
+		if ((FIt == Ctx->Callees.end()) != (GIt == Ctx->Callees.end()))
+			return false;
+		if (FIt == Ctx->Callees.end())
+			continue;
 
-		//Check the loop unroll result
-		if(checkLoop(F)){
-			OP << "Loop unroll failed!!!\n";
-			Ctx->Loopfuncs.insert(F);
+		set<Function *> FCallees, GCallees;
+		for (Function *Callee : FIt->second)
+			FCallees.insert(resolveCopy(Callee));
+		for (Function *Callee : GIt->second)
+			GCallees.insert(resolveCopy(Callee));
+		if (FCallees != GCallees)
+			return false;
+	}
+	return true;
+}
+
+// Callees that are copies themselves resolve to the analyzed copy, so
+// confirming a copy may confirm its callers: repeat until nothing changes
+bool CallGraphPass::doFinalization(Module *M) {
+
+	bool Changed = false;
+	for (Function &F : *M) {
+		auto It = CopyCandidates.find(&F);
+		if (It == CopyCandidates.end() || !sameCallees(&F, It->second))
 			continue;
+
+		Ctx->DuplicateFuncs[&F] = It->second;
+		Ctx->FuncCopies[It->second].push_back(&F);
+		CopyCandidates.erase(It);
+		Changed = true;
+	}
+	return Changed;
+}
+
+void CallGraphPass::collectCallees(Function *F,
+	vector<pair<CallInst *, FuncSet>> &Calls) {
+
+	for (inst_iterator i = inst_begin(F), e = inst_end(F); 
+			i != e; ++i) {
+		// Map callsite to possible callees.
+		if (CallInst *CI = dyn_cast<CallInst>(&*i)) {
+			FuncSet FS;
+			Function *CF = CI->getCalledFunction();
+			if (!CF) {
+#ifdef SOUND_MODE
+				findCalleesByType(CI, FS);
+#endif
+			}
+			// Direct call
+			else {
+				// Call external functions
+				if (CF->empty()) {
+					std::string FName = CF->getName().str();
+					if (StringRef(FName).startswith("SyS_"))
+						FName = "sys_" + FName.substr(4);
+					auto It = Ctx->Funcs.find(FName);
+					CF = It == Ctx->Funcs.end() ? NULL : It->second;
+				}
+				FS.insert(CF);
+			}
+			Calls.push_back(make_pair(CI, FS));
 		}
-		else if(!topSort(F)){
-			OP << "topSort not pass!!!\n";
-			Ctx->Loopfuncs.insert(F);
+	}
+}
+
+// Per-function results, merged into the global context in function order
+struct FuncCallResult {
+	unsigned NumUnrollErrors = 0;
+	bool HasLoop = false;
+	vector<BasicBlock *> TopOrder;
+	vector<pair<CallInst *, FuncSet>> Calls;
+};
+
+bool CallGraphPass::doModulePass(Module *M) {
+
+	vector<Function *> Funcs;
+	for (Function &F : *M)
+		Funcs.push_back(&F);
+	vector<FuncCallResult> Results(Funcs.size());
+
+	// Functions are independent: unrolling only rewrites the terminators
+	// of the function itself, and the callee lookups read shared state
+	// that is complete after doInitialization.
+	#pragma omp parallel for schedule(dynamic)
+	for (int i = 0; i < (int)Funcs.size(); ++i) {
+		Function *F = Funcs[i];
+		FuncCallResult &R = Results[i];
+
+		//Unroll loops, one dominator tree and loop info per function
+		if (!F->isDeclaration()) {
+			DominatorTree DT(*F);
+			LoopInfo LI(DT);
+			R.NumUnrollErrors = unrollLoops(F, DT, LI);
+		}
+
+		//Check the loop unroll result
+		if (!topSort(F, R.TopOrder)) {
+			R.HasLoop = true;
 			continue;
 		}
 
-		for (inst_iterator i = inst_begin(F), e = inst_end(F); 
-				i != e; ++i) {
-			// Map callsite to possible callees.
-			if (CallInst *CI = dyn_cast<CallInst>(&*i)) {
-				FuncSet FS;
-				Function *CF = CI->getCalledFunction();
-				if (!CF) {
-#ifdef SOUND_MODE
-					//findCalleesByType(CI, FS);
-#endif
-					Ctx->Callees[CI] = FS;
+		// Use type-analysis to concervatively find possible targets of 
+		// indirect calls.
+		collectCallees(F, R.Calls);
+	}
 
-					for (Function *Callee : FS)
-						Ctx->Callers[Callee].insert(CI);
+	for (unsigned i = 0; i < Funcs.size(); ++i) {
+		Function *F = Funcs[i];
+		FuncCallResult &R = Results[i];
 
-					// Save called values for future uses.
-					Ctx->IndirectCallInsts.push_back(CI);
-				}
-				// Direct call
-				else {
-					// Call external functions
-          			if (CF->empty()) {
-            			StringRef FName = CF->getName();
-            			if (FName.startswith("SyS_"))
-              				FName = StringRef("sys_" + FName.str().substr(4));
-            			CF = Ctx->Funcs[FName];
-          			}
-					FS.insert(CF);
-					Ctx->Callees[CI] = FS;
-					Ctx->Callers[CF].insert(CI);
-				}
-			}
+		for (unsigned e = 0; e < R.NumUnrollErrors; ++e)
+			OP<<"ERROR: Cannot find Header Block or Latch Block\n";
+
+		if (R.HasLoop) {
+			OP << "Loop unroll failed!!!\n";
+			Ctx->Loopfuncs.insert(F);
+			continue;
+		}
+		// Seed the shared analyses with the order of the unrolled CFG
+		if (!F->empty())
+			Ctx->FuncAnalyses.get(F)->setTopOrder(std::move(R.TopOrder));
+
+		for (auto &Call : R.Calls) {
+			CallInst *CI = Call.first;
+			Ctx->Callees[CI] = Call.second;
+			for (Function *Callee : Call.second)
+				Ctx->Callers[Callee].insert(CI);
+
+			// Save called values for future uses.
+			if (!CI->getCalledFunction())
+				Ctx->IndirectCallInsts.push_back(CI);
 		}
 	}
 
   return false;
-}
\ No newline at end of file
+}
@@ -1,26 +1,36 @@
 #ifndef _CALL_GRAPH_H
 #define _CALL_GRAPH_H
 
+#include <llvm/IR/Dominators.h>
+#include <llvm/Analysis/LoopInfo.h>
+
 #include "Analyzer.h"
 #include "Tools.h"
 
 class CallGraphPass : public IterativeModulePass {
 
 	private:
-		const DataLayout *DL;
-		// char * or void *
-		Type *Int8PtrTy;
-		// long interger type
-		Type *IntPtrTy;
+		// Address-taken var-arg functions, matched on their fixed args,
+		// with the signature hash of those args
+		map<Function *, size_t> VarArgFuncs;
+
+		// Functions with the body of an earlier function, not yet
+		// confirmed as its copy
+		DenseMap<Function *, Function *> CopyCandidates;
+		Function *resolveCopy(Function *F);
+		bool sameCallees(Function *F, Function *G);
 
 		// Use type-based analysis to find targets of indirect calls
 		void findCalleesByType(llvm::CallInst*, FuncSet&);
 
-		void unrollLoops(Function *F);
+		// Returns the number of latches that could not be unrolled
+		unsigned unrollLoops(Function *F, DominatorTree &DT, LoopInfo &LI);
 
-		bool checkLoop(Function *F);
+		bool topSort(Function *F, vector<BasicBlock *> &Order);
 
-		bool topSort(Function *F);
+		// Resolve the possible callees of every call in F
+		void collectCallees(Function *F,
+			vector<pair<CallInst *, FuncSet>> &Calls);
 
 	public:
 		CallGraphPass(GlobalContext *Ctx_)
@@ -0,0 +1,160 @@
+//===-- CalleeClassifier.cc - Category masks of callee names -------===//
+//
+// Classifies every callee once: the substring categories through an
+// Aho-Corasick automaton, the config categories through the name tables.
+//
+//===-----------------------------------------------------------===//
+
+#include <deque>
+
+#include "CalleeClassifier.h"
+#include "Common.h"
+
+using namespace llvm;
+
+static const struct {
+	const char *Pattern;
+	uint32_t Category;
+} SubstringPatterns[] = {
+	{"free", CC_Free},
+	{"release", CC_Release},
+	{"err", CC_Err},
+	{"ERR", CC_ErrUpper},
+	{"lock", CC_LockName},
+	{"_lock", CC_Lock},
+	{"_trylock", CC_TryLock},
+	{"_spinlock", CC_SpinLock},
+	{"_unlock", CC_Unlock},
+	{"_unlocked", CC_Unlocked},
+	{"kmalloc", CC_Kmalloc},
+	{"_get_drvdata", CC_GetDrvdata},
+	{"_set_drvdata", CC_SetDrvdata},
+	{"copy_from_user", CC_CopyFromUser},
+	{"copy_to_user", CC_CopyToUser},
+};
+
+SubstringMatcher::SubstringMatcher() {
+
+	// Trie of the patterns, 0 marks a missing edge (the root has no
+	// incoming edges)
+	std::array<uint16_t, 256> Empty;
+	Empty.fill(0);
+	Next.push_back(Empty);
+	Output.push_back(0);
+
+	for (auto &P : SubstringPatterns) {
+		uint16_t State = 0;
+		for (const char *C = P.Pattern; *C; ++C) {
+			unsigned char Ch = *C;
+			if (!Next[State][Ch]) {
+				Next[State][Ch] = Next.size();
+				Next.push_back(Empty);
+				Output.push_back(0);
+			}
+			State = Next[State][Ch];
+		}
+		Output[State] |= P.Category;
+	}
+
+	// Breadth-first over the trie: complete the missing edges through
+	// the failure links and inherit the output of the failure state
+	std::vector<uint16_t> Fail(Next.size(), 0);
+	std::deque<uint16_t> Queue;
+	for (unsigned Ch = 0; Ch < 256; ++Ch) {
+		if (Next[0][Ch])
+			Queue.push_back(Next[0][Ch]);
+	}
+
+	while (!Queue.empty()) {
+		uint16_t State = Queue.front();
+		Queue.pop_front();
+		Output[State] |= Output[Fail[State]];
+
+		for (unsigned Ch = 0; Ch < 256; ++Ch) {
+			uint16_t Child = Next[State][Ch];
+			if (Child) {
+				Fail[Child] = Next[Fail[State]][Ch];
+				Queue.push_back(Child);
+			}
+			else
+				Next[State][Ch] = Next[Fail[State]][Ch];
+		}
+	}
+}
+
+uint32_t CalleeClassifier::classifyName(StringRef Name,
+	bool WithPassTables) const {
+
+	uint32_t Categories = Matcher.match(Name);
+	for (auto &T : Tables) {
+		if (T.FilledByPass && !WithPassTables)
+			continue;
+		if (T.Contains(Name))
+			Categories |= T.Category;
+	}
+	return Categories;
+}
+
+void CalleeClassifier::addFunction(Function *F) {
+
+	if (!FuncCategories.count(F))
+		FuncCategories[F] = classifyName(F->getName());
+}
+
+// getCalledFuncName names a direct callee after its first operand when
+// it has one (e.g. a personality function), so only operand-free
+// callees can share the entry of the function
+void CalleeClassifier::addCall(Instruction *Call) {
+
+	Function *CF = cast<CallBase>(Call)->getCalledFunction();
+	if (CF && CF->getNumOperands() == 0) {
+		addFunction(CF);
+		return;
+	}
+
+	StringRef Name = getCalledFuncName(Call);
+	if (!NameCategories.count(Name))
+		NameCategories[Name] = classifyName(Name);
+}
+
+void CalleeClassifier::refresh(uint32_t Category) {
+
+	for (auto &T : Tables) {
+		if (T.Category != Category)
+			continue;
+
+		for (auto &Entry : FuncCategories) {
+			Entry.second &= ~Category;
+			if (T.Contains(Entry.first->getName()))
+				Entry.second |= Category;
+		}
+		for (auto &Entry : NameCategories) {
+			Entry.second &= ~Category;
+			if (T.Contains(Entry.getKey()))
+				Entry.second |= Category;
+		}
+	}
+}
+
+uint32_t CalleeClassifier::get(Instruction *Call) const {
+
+	Function *CF = cast<CallBase>(Call)->getCalledFunction();
+	if (CF && CF->getNumOperands() == 0)
+		return get(CF);
+
+	StringRef Name = getCalledFuncName(Call);
+	auto It = NameCategories.find(Name);
+	if (It != NameCategories.end())
+		return It->second;
+	// Not seen by build(). A pass may be filling its tables on other
+	// threads, so leave them out.
+	return classifyName(Name, false);
+}
+
+uint32_t CalleeClassifier::get(Function *F) const {
+
+	auto It = FuncCategories.find(F);
+	if (It != FuncCategories.end())
+		return It->second;
+	return classifyName(F->getName(), false);
+}
@@ -0,0 +1,151 @@
+#ifndef _CALLEE_CLASSIFIER_H
+#define _CALLEE_CLASSIFIER_H
+
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringRef.h>
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "NameSet.h"
+
+//
+// Categories of a callee name. The first group is set when the name
+// contains the substring, the second when a config table lists it.
+//
+enum CalleeCategory : uint32_t {
+	CC_Free          = 1u << 0,     // "free"
+	CC_Release       = 1u << 1,     // "release"
+	CC_Err           = 1u << 2,     // "err"
+	CC_ErrUpper      = 1u << 3,     // "ERR"
+	CC_LockName      = 1u << 4,     // "lock"
+	CC_Lock          = 1u << 5,     // "_lock"
+	CC_TryLock       = 1u << 6,     // "_trylock"
+	CC_SpinLock      = 1u << 7,     // "_spinlock"
+	CC_Unlock        = 1u << 8,     // "_unlock"
+	CC_Unlocked      = 1u << 9,     // "_unlocked"
+	CC_Kmalloc       = 1u << 10,    // "kmalloc"
+	CC_GetDrvdata    = 1u << 11,    // "_get_drvdata"
+	CC_SetDrvdata    = 1u << 12,    // "_set_drvdata"
+	CC_CopyFromUser  = 1u << 13,    // "copy_from_user"
+	CC_CopyToUser    = 1u << 14,    // "copy_to_user"
+
+	CC_Debug         = 1u << 16,    // DebugFuncs
+	CC_AutoFreed     = 1u << 17,    // AutoFreedFuncs
+	CC_Escape        = 1u << 18,    // EscapeFuncs
+	CC_MemberGet     = 1u << 19,    // MemberGetFuncs
+	CC_Refcount      = 1u << 20,    // RefcountFuncs
+	CC_RefcountRelated = 1u << 21,  // RefcountRelatedFuncs
+	CC_PairFree      = 1u << 22,    // PairFuncs
+	CC_ReleaseFunc   = 1u << 23,    // ReleaseFuncSet, after WrapperAnalysis
+
+	CC_AnyErr        = CC_Err | CC_ErrUpper,
+	CC_AnyLock       = CC_Lock | CC_TryLock | CC_SpinLock,
+	CC_AnyFree       = CC_Free | CC_Release,
+	CC_CopyUser      = CC_CopyFromUser | CC_CopyToUser,
+};
+
+//
+// Aho-Corasick automaton over the substring categories, compiled once
+// into a dense transition table. One scan of a name yields the mask of
+// every pattern it contains.
+//
+class SubstringMatcher {
+
+	public:
+		SubstringMatcher();
+
+		uint32_t match(llvm::StringRef Name) const {
+			uint32_t Mask = 0;
+			uint16_t State = 0;
+			for (unsigned char C : Name) {
+				State = Next[State][C];
+				Mask |= Output[State];
+			}
+			return Mask;
+		}
+
+	private:
+		std::vector<std::array<uint16_t, 256>> Next;
+		std::vector<uint32_t> Output;
+};
+
+//
+// Category mask of every callee, computed once after the modules are
+// loaded. Direct callees are keyed by Function, other targets by the
+// name getCalledFuncName gives them. Lookups after build() only read,
+// so passes may query from any thread. Tables a pass fills are read
+// through the masks only, and refresh() updates those once it is done.
+//
+class CalleeClassifier {
+
+	public:
+		// Categories taken from a config table, or from a table a pass
+		// fills (FilledByPass)
+		void addNameTable(uint32_t Category, const NameSet &Names,
+			bool FilledByPass = false) {
+			Tables.push_back({Category, FilledByPass,
+				[&Names](llvm::StringRef N) { return Names.count(N) != 0; }});
+		}
+
+		template <typename MapT>
+		void addNameMap(uint32_t Category, const MapT &Map) {
+			Tables.push_back({Category, false,
+				[&Map](llvm::StringRef N) { return Map.count(N.str()) != 0; }});
+		}
+
+		template <typename ModuleListT>
+		void build(ModuleListT &Modules);
+
+		// Re-evaluate the table of Category, for tables filled by a pass
+		void refresh(uint32_t Category);
+
+		uint32_t classifyName(llvm::StringRef Name,
+			bool WithPassTables = true) const;
+
+		// Category mask of the callee of a call or invoke
+		uint32_t get(llvm::Instruction *Call) const;
+		uint32_t get(llvm::Function *F) const;
+
+	private:
+		struct NameTable {
+			uint32_t Category;
+			bool FilledByPass;
+			std::function<bool(llvm::StringRef)> Contains;
+		};
+
+		void addFunction(llvm::Function *F);
+		void addCall(llvm::Instruction *Call);
+
+		SubstringMatcher Matcher;
+		std::vector<NameTable> Tables;
+
+		llvm::DenseMap<llvm::Function *, uint32_t> FuncCategories;
+		llvm::StringMap<uint32_t> NameCategories;
+};
+
+template <typename ModuleListT>
+void CalleeClassifier::build(ModuleListT &Modules) {
+
+	FuncCategories.clear();
+	NameCategories.clear();
+
+	for (auto &MP : Modules) {
+		for (llvm::Function &F : *MP.first) {
+			addFunction(&F);
+			for (llvm::BasicBlock &BB : F) {
+				for (llvm::Instruction &I : BB) {
+					if (llvm::isa<llvm::CallInst>(&I) || llvm::isa<llvm::InvokeInst>(&I))
+						addCall(&I);
+				}
+			}
+		}
+	}
+}
+
+#endif
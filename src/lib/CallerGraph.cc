@@ -0,0 +1,78 @@
+//===-- CallerGraph.cc - Frozen caller graph ------------------------===//
+//
+// SCC decomposition of the caller graph, used to walk the call graph
+// bottom-up.
+//
+//===-----------------------------------------------------------===//
+
+#include <algorithm>
+
+#include "CallerGraph.h"
+
+using namespace llvm;
+
+const unsigned CallerGraph::InvalidID;
+
+// Iterative Tarjan over caller edges. An SCC is emitted only after all
+// SCCs of its callers, so the emission order is reversed at the end.
+void CallerGraph::computeSCCs(std::vector<std::vector<unsigned>> &SCCs,
+	std::vector<unsigned> &SCCOf) const {
+
+	unsigned N = size();
+	std::vector<int> Index(N, -1), Low(N, 0);
+	std::vector<bool> OnStack(N, false);
+	std::vector<unsigned> Stack;
+	std::vector<std::pair<unsigned, unsigned>> Frames; // node, next edge
+	int NextIndex = 0;
+
+	SCCs.clear();
+	SCCOf.assign(N, InvalidID);
+
+	for (unsigned Root = 0; Root < N; ++Root) {
+		if (Index[Root] >= 0)
+			continue;
+
+		Index[Root] = Low[Root] = NextIndex++;
+		Stack.push_back(Root);
+		OnStack[Root] = true;
+		Frames.push_back(std::make_pair(Root, edgeBegin(Root)));
+
+		while (!Frames.empty()) {
+			unsigned Node = Frames.back().first;
+			if (Frames.back().second != edgeEnd(Node)) {
+				unsigned Caller = getCallerID(Frames.back().second++);
+				if (Index[Caller] < 0) {
+					Index[Caller] = Low[Caller] = NextIndex++;
+					Stack.push_back(Caller);
+					OnStack[Caller] = true;
+					Frames.push_back(std::make_pair(Caller, edgeBegin(Caller)));
+				}
+				else if (OnStack[Caller])
+					Low[Node] = std::min(Low[Node], Index[Caller]);
+				continue;
+			}
+
+			Frames.pop_back();
+			if (Low[Node] == Index[Node]) {
+				std::vector<unsigned> Members;
+				unsigned Member;
+				do {
+					Member = Stack.back();
+					Stack.pop_back();
+					OnStack[Member] = false;
+					Members.push_back(Member);
+				} while (Member != Node);
+				SCCs.push_back(Members);
+			}
+			if (!Frames.empty()) {
+				unsigned Parent = Frames.back().first;
+				Low[Parent] = std::min(Low[Parent], Low[Node]);
+			}
+		}
+	}
+
+	std::reverse(SCCs.begin(), SCCs.end());
+	for (unsigned i = 0; i < SCCs.size(); ++i)
+		for (unsigned Member : SCCs[i])
+			SCCOf[Member] = i;
+}
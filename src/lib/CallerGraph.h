@@ -0,0 +1,106 @@
+#ifndef _CALLER_GRAPH_H
+#define _CALLER_GRAPH_H
+
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallPtrSet.h>
+
+#include <vector>
+
+//
+// Read-only caller graph in compressed sparse row form, frozen once the
+// call graph is built. Functions get dense IDs; the callers of function
+// ID are the edges [CallerOffsets[ID], CallerOffsets[ID + 1]).
+//
+class CallerGraph {
+
+	public:
+		static const unsigned InvalidID = ~0U;
+
+		template <typename ModuleListT, typename CallerMapT>
+		void build(ModuleListT &Modules, CallerMapT &Callers);
+
+		unsigned size() const { return Funcs.size(); }
+
+		unsigned getID(llvm::Function *F) const {
+			auto It = FuncIDs.find(F);
+			return It == FuncIDs.end() ? InvalidID : It->second;
+		}
+
+		llvm::Function *getFunc(unsigned ID) const { return Funcs[ID]; }
+
+		unsigned edgeBegin(unsigned ID) const { return CallerOffsets[ID]; }
+		unsigned edgeEnd(unsigned ID) const { return CallerOffsets[ID + 1]; }
+
+		// Caller function and call instruction of an edge
+		unsigned getCallerID(unsigned Edge) const { return CallerIDs[Edge]; }
+		llvm::CallInst *getCallInst(unsigned Edge) const { return CallInsts[Edge]; }
+
+		unsigned numEdges() const { return CallerIDs.size(); }
+
+		// Strongly connected components, callees before callers.
+		// SCCOf maps a function ID to its index in SCCs.
+		void computeSCCs(std::vector<std::vector<unsigned>> &SCCs,
+			std::vector<unsigned> &SCCOf) const;
+
+	private:
+		std::vector<llvm::Function *> Funcs;
+		llvm::DenseMap<llvm::Function *, unsigned> FuncIDs;
+
+		std::vector<unsigned> CallerOffsets;
+		std::vector<unsigned> CallerIDs;
+		std::vector<llvm::CallInst *> CallInsts;
+};
+
+template <typename ModuleListT, typename CallerMapT>
+void CallerGraph::build(ModuleListT &Modules, CallerMapT &Callers) {
+
+	Funcs.clear();
+	FuncIDs.clear();
+
+	// Number functions in module order so IDs are stable between runs
+	for (auto &MP : Modules) {
+		for (llvm::Function &F : *MP.first) {
+			FuncIDs[&F] = Funcs.size();
+			Funcs.push_back(&F);
+		}
+	}
+
+	// Count callers per callee, then fill the rows. Callees and callers
+	// outside the modules have no ID and are skipped.
+	std::vector<unsigned> Count(Funcs.size(), 0);
+	for (auto &Entry : Callers) {
+		unsigned ID = getID(Entry.first);
+		if (ID == InvalidID)
+			continue;
+		for (llvm::CallInst *CI : Entry.second) {
+			if (getID(CI->getFunction()) != InvalidID)
+				++Count[ID];
+		}
+	}
+
+	CallerOffsets.assign(Funcs.size() + 1, 0);
+	for (unsigned i = 0; i < Funcs.size(); ++i)
+		CallerOffsets[i + 1] = CallerOffsets[i] + Count[i];
+
+	CallerIDs.assign(CallerOffsets.back(), 0);
+	CallInsts.assign(CallerOffsets.back(), nullptr);
+
+	std::vector<unsigned> Fill(CallerOffsets.begin(), CallerOffsets.end() - 1);
+	for (auto &Entry : Callers) {
+		unsigned ID = getID(Entry.first);
+		if (ID == InvalidID)
+			continue;
+		for (llvm::CallInst *CI : Entry.second) {
+			unsigned CallerID = getID(CI->getFunction());
+			if (CallerID == InvalidID)
+				continue;
+			unsigned Edge = Fill[ID]++;
+			CallerIDs[Edge] = CallerID;
+			CallInsts[Edge] = CI;
+		}
+	}
+}
+
+#endif
@@ -1,5 +1,7 @@
 #include <llvm/IR/InlineAsm.h>
 #include <llvm/IR/InstIterator.h>
+#include <llvm/ADT/Hashing.h>
+#include <llvm/ADT/DenseMap.h>
 #include <fstream>
 #include <regex>
 #include <sstream>
@@ -188,6 +190,18 @@ StringRef getCalledFuncName(Instruction *I) {
 	return V->getName();
 }
 
+/// Get the peer functions of a pair or refcount function, without
+/// adding an empty entry for unknown names.
+const set<string> &getPeerFuncNames(const map<string, set<string>> &Funcs,
+		StringRef FName) {
+
+	static const set<string> NoPeers;
+	auto It = Funcs.find(FName.str());
+	if (It == Funcs.end())
+		return NoPeers;
+	return It->second;
+}
+
 DILocation *getSourceLocation(Instruction *I) {
   if (!I)
     return NULL;
@@ -323,37 +337,102 @@ Argument *getArgByNo(Function *F, int8_t ArgNo) {
   return ai;
 }
 
+// Strip the ".123" suffixes the linker/IR reader appends to struct
+// names that clash within a context, e.g. "struct.file.42" -> "struct.file"
+StringRef normalizeStructName(StringRef Name) {
+
+	while (true) {
+		size_t Dot = Name.rfind('.');
+		if (Dot == StringRef::npos || Dot + 1 == Name.size())
+			return Name;
+		StringRef Suffix = Name.substr(Dot + 1);
+		if (Suffix.find_first_not_of("0123456789") != StringRef::npos)
+			return Name;
+		Name = Name.substr(0, Dot);
+	}
+}
+
+// Hash a type by walking its structure. Named structs are identified by
+// their normalized name (not recursed into), so the result is the same
+// for equivalent types living in different LLVMContexts. Results are
+// memoized per Type*.
+static size_t structuralTypeHash(Type *Ty) {
+
+	static thread_local DenseMap<Type *, size_t> TypeHashCache;
+
+	auto It = TypeHashCache.find(Ty);
+	if (It != TypeHashCache.end())
+		return It->second;
+
+	size_t H = 0;
+	switch (Ty->getTypeID()) {
+		case Type::IntegerTyID:
+			H = hash_combine(Ty->getTypeID(), Ty->getIntegerBitWidth());
+			break;
+		case Type::PointerTyID:
+			H = hash_combine(Ty->getTypeID(), Ty->getPointerAddressSpace(),
+				structuralTypeHash(Ty->getPointerElementType()));
+			break;
+		case Type::ArrayTyID:
+			H = hash_combine(Ty->getTypeID(), Ty->getArrayNumElements(),
+				structuralTypeHash(Ty->getArrayElementType()));
+			break;
+		case Type::VectorTyID:
+			H = hash_combine(Ty->getTypeID(), Ty->getVectorNumElements(),
+				structuralTypeHash(Ty->getVectorElementType()));
+			break;
+		case Type::StructTyID: {
+			StructType *STy = cast<StructType>(Ty);
+			if (STy->hasName()) {
+				H = hash_combine(Ty->getTypeID(),
+					hash_value(normalizeStructName(STy->getName())));
+				break;
+			}
+			H = hash_combine(Ty->getTypeID(), STy->isPacked());
+			//Identified structs may refer to themselves, so only the
+			//kinds of their elements are hashed
+			for (Type *ETy : STy->elements())
+				H = hash_combine(H, STy->isLiteral() ?
+					structuralTypeHash(ETy) : (size_t)hash_value(ETy->getTypeID()));
+			break;
+		}
+		case Type::FunctionTyID: {
+			FunctionType *FTy = cast<FunctionType>(Ty);
+			H = hash_combine(Ty->getTypeID(), FTy->isVarArg(),
+				structuralTypeHash(FTy->getReturnType()));
+			for (Type *PTy : FTy->params())
+				H = hash_combine(H, structuralTypeHash(PTy));
+			break;
+		}
+		default:
+			H = hash_value(Ty->getTypeID());
+			break;
+	}
+
+	return TypeHashCache[Ty] = H;
+}
+
 //#define HASH_SOURCE_INFO
 size_t funcHash(Function *F, bool withName) {
 
-	hash<string> str_hash;
-	string output;
-
 #ifdef HASH_SOURCE_INFO
 	DISubprogram *SP = F->getSubprogram();
 
 	if (SP) {
-		output = SP->getFilename();
+		hash<string> str_hash;
+		string output = SP->getFilename();
 		output = output + to_string(uint_hash(SP->getLine()));
-	}
-	else {
-#endif
-		string sig;
-		raw_string_ostream rso(sig);
-		Type *FTy = F->getFunctionType();
-		FTy->print(rso);
-		output = rso.str();
-
-		if (withName)
-			output += F->getName();
-#ifdef HASH_SOURCE_INFO
+		string::iterator end_pos = remove(output.begin(), 
+				output.end(), ' ');
+		output.erase(end_pos, output.end());
+		return str_hash(output);
 	}
 #endif
-	string::iterator end_pos = remove(output.begin(), 
-			output.end(), ' ');
-	output.erase(end_pos, output.end());
+	size_t H = structuralTypeHash(F->getFunctionType());
+	if (withName)
+		H = hash_combine(H, hash_value(F->getName()));
 
-	return str_hash(output);
+	return H;
 }
 
 size_t callHash(CallInst *CI) {
@@ -363,32 +442,290 @@ size_t callHash(CallInst *CI) {
 
 	if (CF)
 		return funcHash(CF);
-	else {
-		hash<string> str_hash;
-		string sig;
-		raw_string_ostream rso(sig);
-		Type *FTy = CS.getFunctionType();
-		FTy->print(rso);
-
-		string strip_str = rso.str();
-		string::iterator end_pos = remove(strip_str.begin(), 
-				strip_str.end(), ' ');
-		strip_str.erase(end_pos, strip_str.end());
-		return str_hash(strip_str);
-	}
+	else
+		return structuralTypeHash(CS.getFunctionType());
 }
 
 size_t typeHash(Type *Ty) {
-	hash<string> str_hash;
-	string sig;
+	return structuralTypeHash(Ty);
+}
+
+// Hash an operand of an instruction of funcBodyHash. Constants are
+// hashed by their contents, recursing into constant expressions and
+// aggregates down to the globals.
+static size_t operandHash(Value *Op,
+	const DenseMap<Value *, unsigned> &LocalIdx) {
+
+	auto It = LocalIdx.find(Op);
+	if (It != LocalIdx.end())
+		return hash_combine('l', It->second);
+	if (GlobalValue *GV = dyn_cast<GlobalValue>(Op))
+		return hash_combine('g', hash_value(GV->getName()));
+	if (ConstantInt *CI = dyn_cast<ConstantInt>(Op))
+		return hash_combine('c', hash_value(CI->getValue()));
+	if (ConstantFP *CFP = dyn_cast<ConstantFP>(Op))
+		return hash_combine('f', structuralTypeHash(CFP->getType()),
+			hash_value(CFP->getValueAPF().bitcastToAPInt()));
+	if (ConstantDataSequential *CDS = dyn_cast<ConstantDataSequential>(Op))
+		return hash_combine('d', structuralTypeHash(CDS->getType()),
+			hash_value(CDS->getRawDataValues()));
+	if (InlineAsm *IA = dyn_cast<InlineAsm>(Op))
+		return hash_combine('a', hash_value(IA->getAsmString()),
+			hash_value(IA->getConstraintString()), IA->hasSideEffects());
+
+	size_t H = hash_combine(Op->getValueID(), structuralTypeHash(Op->getType()));
+	if (ConstantExpr *CE = dyn_cast<ConstantExpr>(Op)) {
+		H = hash_combine(H, CE->getOpcode());
+		if (CE->isCompare())
+			H = hash_combine(H, CE->getPredicate());
+	}
+	if (Constant *C = dyn_cast<Constant>(Op)) {
+		for (Value *COp : C->operands())
+			H = hash_combine(H, operandHash(COp, LocalIdx));
+	}
+	return H;
+}
+
+// Fingerprint the body of a function: name, instructions (opcode, type,
+// operands, predicates, debug lines), CFG shape and callees. Copies of
+// the same inline function in different modules get the same value.
+// Operands are hashed by their position in the function, globals and
+// callees by name, so the result does not depend on the module. PHIs
+// also hash the positions of their incoming blocks.
+size_t funcBodyHash(Function *F) {
+
+	DenseMap<Value *, unsigned> LocalIdx;
+	unsigned Idx = 0;
+	for (Argument &A : F->args())
+		LocalIdx[&A] = Idx++;
+	for (BasicBlock &BB : *F) {
+		LocalIdx[&BB] = Idx++;
+		for (Instruction &I : BB)
+			LocalIdx[&I] = Idx++;
+	}
+
+	size_t H = hash_combine(hash_value(F->getName()),
+		structuralTypeHash(F->getFunctionType()));
+	if (DISubprogram *SP = F->getSubprogram())
+		H = hash_combine(H, hash_value(SP->getFilename()), SP->getLine());
+
+	for (BasicBlock &BB : *F) {
+		H = hash_combine(H, BB.size());
+		for (Instruction &I : BB) {
+			H = hash_combine(H, I.getOpcode(), structuralTypeHash(I.getType()),
+				I.getNumOperands());
+
+			if (CmpInst *CI = dyn_cast<CmpInst>(&I))
+				H = hash_combine(H, CI->getPredicate());
+			if (const DebugLoc &Loc = I.getDebugLoc())
+				H = hash_combine(H, Loc.getLine(), Loc.getCol());
+
+			for (Value *Op : I.operands())
+				H = hash_combine(H, operandHash(Op, LocalIdx));
+
+			if (PHINode *PN = dyn_cast<PHINode>(&I)) {
+				for (BasicBlock *InBB : PN->blocks())
+					H = hash_combine(H, LocalIdx.lookup(InBB));
+			}
+		}
+	}
+
+	return H;
+}
+
+// Type equality under the rules of structuralTypeHash
+static bool structuralTypeEqual(Type *A, Type *B) {
+
+	if (A == B)
+		return true;
+	if (A->getTypeID() != B->getTypeID())
+		return false;
+
+	switch (A->getTypeID()) {
+		case Type::IntegerTyID:
+			return A->getIntegerBitWidth() == B->getIntegerBitWidth();
+		case Type::PointerTyID:
+			return A->getPointerAddressSpace() == B->getPointerAddressSpace()
+				&& structuralTypeEqual(A->getPointerElementType(),
+					B->getPointerElementType());
+		case Type::ArrayTyID:
+			return A->getArrayNumElements() == B->getArrayNumElements()
+				&& structuralTypeEqual(A->getArrayElementType(),
+					B->getArrayElementType());
+		case Type::VectorTyID:
+			return A->getVectorNumElements() == B->getVectorNumElements()
+				&& structuralTypeEqual(A->getVectorElementType(),
+					B->getVectorElementType());
+		case Type::StructTyID: {
+			StructType *SA = cast<StructType>(A), *SB = cast<StructType>(B);
+			if (SA->hasName() || SB->hasName())
+				return SA->hasName() && SB->hasName()
+					&& normalizeStructName(SA->getName())
+						== normalizeStructName(SB->getName());
+			if (SA->isPacked() != SB->isPacked() || SA->isLiteral() != SB->isLiteral()
+				|| SA->getNumElements() != SB->getNumElements())
+				return false;
+			for (unsigned i = 0; i < SA->getNumElements(); ++i) {
+				Type *EA = SA->getElementType(i), *EB = SB->getElementType(i);
+				if (SA->isLiteral() ? !structuralTypeEqual(EA, EB)
+					: EA->getTypeID() != EB->getTypeID())
+					return false;
+			}
+			return true;
+		}
+		case Type::FunctionTyID: {
+			FunctionType *FA = cast<FunctionType>(A), *FB = cast<FunctionType>(B);
+			if (FA->isVarArg() != FB->isVarArg()
+				|| FA->getNumParams() != FB->getNumParams()
+				|| !structuralTypeEqual(FA->getReturnType(), FB->getReturnType()))
+				return false;
+			for (unsigned i = 0; i < FA->getNumParams(); ++i) {
+				if (!structuralTypeEqual(FA->getParamType(i), FB->getParamType(i)))
+					return false;
+			}
+			return true;
+		}
+		default:
+			return true;
+	}
+}
+
+// Operand equality under the rules of operandHash
+static bool operandEqual(Value *A, Value *B,
+	const DenseMap<Value *, unsigned> &IdxA,
+	const DenseMap<Value *, unsigned> &IdxB) {
+
+	auto ItA = IdxA.find(A), ItB = IdxB.find(B);
+	if (ItA != IdxA.end() || ItB != IdxB.end())
+		return ItA != IdxA.end() && ItB != IdxB.end()
+			&& ItA->second == ItB->second;
+
+	if (A->getValueID() != B->getValueID()
+		|| !structuralTypeEqual(A->getType(), B->getType()))
+		return false;
+
+	if (GlobalValue *GA = dyn_cast<GlobalValue>(A))
+		return GA->getName() == cast<GlobalValue>(B)->getName();
+	if (ConstantInt *CA = dyn_cast<ConstantInt>(A))
+		return CA->getValue() == cast<ConstantInt>(B)->getValue();
+	if (ConstantFP *CA = dyn_cast<ConstantFP>(A))
+		return CA->getValueAPF().bitwiseIsEqual(cast<ConstantFP>(B)->getValueAPF());
+	if (ConstantDataSequential *CA = dyn_cast<ConstantDataSequential>(A))
+		return CA->getRawDataValues()
+			== cast<ConstantDataSequential>(B)->getRawDataValues();
+	if (InlineAsm *IA = dyn_cast<InlineAsm>(A)) {
+		InlineAsm *IB = cast<InlineAsm>(B);
+		return IA->getAsmString() == IB->getAsmString()
+			&& IA->getConstraintString() == IB->getConstraintString()
+			&& IA->hasSideEffects() == IB->hasSideEffects();
+	}
+
+	if (ConstantExpr *CA = dyn_cast<ConstantExpr>(A)) {
+		ConstantExpr *CB = cast<ConstantExpr>(B);
+		if (CA->getOpcode() != CB->getOpcode()
+			|| (CA->isCompare() && CA->getPredicate() != CB->getPredicate()))
+			return false;
+	}
+	if (Constant *CA = dyn_cast<Constant>(A)) {
+		Constant *CB = cast<Constant>(B);
+		if (CA->getNumOperands() != CB->getNumOperands())
+			return false;
+		for (unsigned i = 0; i < CA->getNumOperands(); ++i) {
+			if (!operandEqual(CA->getOperand(i), CB->getOperand(i), IdxA, IdxB))
+				return false;
+		}
+	}
+	// Other operands (metadata) are only compared by kind and type
+	return true;
+}
+
+// Check that two functions with the same funcBodyHash really have the
+// same body, so that a hash collision is never taken for a copy. Uses
+// the rules of funcBodyHash, plus the types GEPs and allocas work on.
+// Callees are compared by name; the call graph checks what they resolve to.
+bool funcBodyEqual(Function *F, Function *G) {
+
+	if (F->getName() != G->getName() || F->size() != G->size()
+		|| !structuralTypeEqual(F->getFunctionType(), G->getFunctionType()))
+		return false;
+
+	DISubprogram *SF = F->getSubprogram(), *SG = G->getSubprogram();
+	if (!SF != !SG)
+		return false;
+	if (SF && (SF->getFilename() != SG->getFilename()
+		|| SF->getLine() != SG->getLine()))
+		return false;
+
+	DenseMap<Value *, unsigned> IdxF, IdxG;
+	unsigned Idx = 0;
+	for (Argument &A : F->args())
+		IdxF[&A] = Idx++;
+	for (BasicBlock &BB : *F) {
+		IdxF[&BB] = Idx++;
+		for (Instruction &I : BB)
+			IdxF[&I] = Idx++;
+	}
+	Idx = 0;
+	for (Argument &A : G->args())
+		IdxG[&A] = Idx++;
+	for (BasicBlock &BB : *G) {
+		IdxG[&BB] = Idx++;
+		for (Instruction &I : BB)
+			IdxG[&I] = Idx++;
+	}
+	if (IdxF.size() != IdxG.size())
+		return false;
+
+	for (auto BF = F->begin(), BG = G->begin(); BF != F->end(); ++BF, ++BG) {
+		if (BF->size() != BG->size())
+			return false;
 
-	raw_string_ostream rso(sig);
-	Ty->print(rso);
-	string ty_str = rso.str();
-	string::iterator end_pos = remove(ty_str.begin(), ty_str.end(), ' ');
-	ty_str.erase(end_pos, ty_str.end());
+		for (auto IF = BF->begin(), IG = BG->begin(); IF != BF->end(); ++IF, ++IG) {
+			Instruction *I = &*IF, *J = &*IG;
+			if (I->getOpcode() != J->getOpcode()
+				|| I->getNumOperands() != J->getNumOperands()
+				|| !structuralTypeEqual(I->getType(), J->getType()))
+				return false;
 
-	return str_hash(ty_str);
+			if (CmpInst *CI = dyn_cast<CmpInst>(I)) {
+				if (CI->getPredicate() != cast<CmpInst>(J)->getPredicate())
+					return false;
+			}
+			if (GetElementPtrInst *GEP = dyn_cast<GetElementPtrInst>(I)) {
+				if (!structuralTypeEqual(GEP->getSourceElementType(),
+					cast<GetElementPtrInst>(J)->getSourceElementType()))
+					return false;
+			}
+			if (AllocaInst *AI = dyn_cast<AllocaInst>(I)) {
+				if (!structuralTypeEqual(AI->getAllocatedType(),
+					cast<AllocaInst>(J)->getAllocatedType()))
+					return false;
+			}
+
+			const DebugLoc &LocI = I->getDebugLoc(), &LocJ = J->getDebugLoc();
+			if (!LocI != !LocJ)
+				return false;
+			if (LocI && (LocI.getLine() != LocJ.getLine()
+				|| LocI.getCol() != LocJ.getCol()))
+				return false;
+
+			for (unsigned i = 0; i < I->getNumOperands(); ++i) {
+				if (!operandEqual(I->getOperand(i), J->getOperand(i), IdxF, IdxG))
+					return false;
+			}
+
+			if (PHINode *PN = dyn_cast<PHINode>(I)) {
+				PHINode *PJ = cast<PHINode>(J);
+				for (unsigned i = 0; i < PN->getNumIncomingValues(); ++i) {
+					if (IdxF.lookup(PN->getIncomingBlock(i))
+						!= IdxG.lookup(PJ->getIncomingBlock(i)))
+						return false;
+				}
+			}
+		}
+	}
+
+	return true;
 }
 
 size_t hashIdxHash(size_t Hs, int Idx) {
@@ -400,6 +737,57 @@ size_t typeIdxHash(Type *Ty, int Idx) {
 	return hashIdxHash(typeHash(Ty), Idx);
 }
 
+// Hash an argument type so that two arguments get the same hash iff
+// the type-based indirect-call analysis treats them as compatible:
+// same pointer depth and same struct name / integer width, and
+// "char *" being interchangeable with a pointer-sized integer.
+// Independent of the LLVMContext, so it works across modules.
+size_t argTypeSigHash(Type *Ty, unsigned PtrBits) {
+
+	unsigned Depth = 0;
+	while (Ty->isPointerTy()) {
+		Ty = Ty->getPointerElementType();
+		++Depth;
+	}
+
+	if (Ty->isIntegerTy()) {
+		unsigned Width = Ty->getIntegerBitWidth();
+		// Pointer-sized integers are folded into "char *"
+		if (Width == PtrBits) {
+			Width = 8;
+			++Depth;
+		}
+		return hash_combine(Depth, 'i', Width);
+	}
+
+	if (Ty->isStructTy()) {
+		StringRef Name = Ty->getStructName();
+		return hash_combine(Depth, 's', hash_value(normalizeStructName(Name)));
+	}
+
+	return hash_combine(Depth, 't', typeHash(Ty));
+}
+
+size_t funcArgSigHash(Function *F) {
+
+	unsigned PtrBits = F->getParent()->getDataLayout().getPointerSizeInBits();
+	std::vector<size_t> ArgHashes;
+	for (Argument &A : F->args())
+		ArgHashes.push_back(argTypeSigHash(A.getType(), PtrBits));
+
+	return hash_combine_range(ArgHashes.begin(), ArgHashes.end());
+}
+
+// Per-argument hashes of a call site; combine a prefix of them with
+// hash_combine_range to match var-arg targets.
+void callArgSigHashes(CallInst *CI, std::vector<size_t> &ArgHashes) {
+
+	unsigned PtrBits = CI->getModule()->getDataLayout().getPointerSizeInBits();
+	ArgHashes.clear();
+	for (unsigned i = 0; i < CI->getNumArgOperands(); ++i)
+		ArgHashes.push_back(argTypeSigHash(CI->getArgOperand(i)->getType(), PtrBits));
+}
+
 void getSourceCodeLine(Value *V, string &line) {
 
 	line = "";
@@ -8,7 +8,11 @@
 #include <llvm/IR/DebugInfo.h>
 
 #include <unistd.h>
+#include <algorithm>
 #include <bitset>
+#include <vector>
+#include <map>
+#include <set>
 #include <chrono>
 #include <time.h>
 
@@ -63,6 +67,9 @@ bool checkprintk(Instruction *I);
 
 StringRef getCalledFuncName(Instruction *I);
 
+const set<string> &getPeerFuncNames(const map<string, set<string>> &Funcs,
+		StringRef FName);
+
 string extractMacro(string, Instruction* I);
 
 DILocation *getSourceLocation(Instruction *I);
@@ -81,6 +88,14 @@ size_t callHash(CallInst *CI);
 size_t typeHash(Type *Ty);
 size_t typeIdxHash(Type *Ty, int Idx = -1);
 size_t hashIdxHash(size_t Hs, int Idx = -1);
+size_t funcBodyHash(Function *F);
+bool funcBodyEqual(Function *F, Function *G);
+
+// Argument signatures used to match indirect calls with their targets
+StringRef normalizeStructName(StringRef Name);
+size_t argTypeSigHash(Type *Ty, unsigned PtrBits);
+size_t funcArgSigHash(Function *F);
+void callArgSigHashes(CallInst *CI, std::vector<size_t> &ArgHashes);
 
 void getSourceCodeLine(Value *V, string &line);
 
@@ -297,4 +312,19 @@ typedef struct SecurityOperation{
 
 } SecurityOperation;
 
+//Security operations of a function, sorted and without duplicates
+typedef std::vector<SecurityOperation> SecurityOperationTable;
+
+//Add Ops to Table, keeping it sorted and unique
+inline void mergeSecurityOperations(SecurityOperationTable &Table,
+    const SecurityOperationTable &Ops){
+
+    Table.insert(Table.end(), Ops.begin(), Ops.end());
+    std::sort(Table.begin(), Table.end());
+    Table.erase(std::unique(Table.begin(), Table.end(),
+        [](const SecurityOperation &A, const SecurityOperation &B){
+            return !(A < B) && !(B < A);
+        }), Table.end());
+}
+
 #endif
@@ -1,19 +1,24 @@
 #ifndef _SACONFIG_H
 #define _SACONFIG_H
 
-#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/CommandLine.h"
 
 #include <map>
 #include <unordered_map>
 #include <set>
 #include <unordered_set>
 #include <fstream>
+#include <vector>
+
+#include "ConfigTables.h"
 
 //
 // Configurations for compilation.
 //
 //#define VERBOSE_SA 1
 //#define DEBUG_SA 1
+// Resolve indirect calls by argument types; without it the call graph
+// has direct calls only
 #define SOUND_MODE 1
 
 // Skip functions with more blocks to avoid scalability issues
@@ -25,214 +30,102 @@
 //#define is_errno(x) (((x) & ERRNO_MASK) == ERRNO_PREFIX)
 
 
-static void SetSkipFuncs(set<string> &SkipFuncs) {
-
-  string exepath = sys::fs::getMainExecutable(NULL, NULL);
-	string exedir = exepath.substr(0, exepath.find_last_of('/'));
-  string srcdir = exedir.substr(0, exedir.find_last_of('/'));
-  srcdir = srcdir.substr(0, srcdir.find_last_of('/'));
-  srcdir = srcdir + "/src/lib";
-	string line;
-  ifstream errfile(srcdir	+ "/configs/krace-skip-funcs");
-  if (errfile.is_open()) {
-		while (!errfile.eof()) {
-			getline (errfile, line);
-			if (line.length() > 1) {
-				SkipFuncs.insert(line);
-			}
-		}
-    errfile.close();
-  }
+// Directory of config files given with -config-dir, empty by default
+extern cl::opt<std::string> ConfigDir;
 
-}
+// Read the entries of a config file; false if there is no such file.
+// Without -config-dir no file is read and the compiled-in tables are used.
+static bool ReadConfigFile(const char *FileName, vector<string> &Lines) {
 
-//Used for debug
-static void SetTestFuncs(set<string> &TestFuncs) {
-
-  string exepath = sys::fs::getMainExecutable(NULL, NULL);
-	string exedir = exepath.substr(0, exepath.find_last_of('/'));
-  string srcdir = exedir.substr(0, exedir.find_last_of('/'));
-  srcdir = srcdir.substr(0, srcdir.find_last_of('/'));
-  srcdir = srcdir + "/src/lib";
-	string line;
-  ifstream errfile(srcdir	+ "/configs/test-funcs");
-  if (errfile.is_open()) {
-		while (!errfile.eof()) {
-			getline (errfile, line);
-			if (line.length() > 1) {
-				TestFuncs.insert(line);
-			}
-		}
-    errfile.close();
-  }
+  if (ConfigDir.empty())
+    return false;
 
-}
+  ifstream cfgfile(ConfigDir + "/" + FileName);
+  if (!cfgfile.is_open())
+    return false;
 
-static void SetAutoFreedFuncs(set<string> &AutoFreedFuncs) {
-
-  string exepath = sys::fs::getMainExecutable(NULL, NULL);
-	string exedir = exepath.substr(0, exepath.find_last_of('/'));
-  string srcdir = exedir.substr(0, exedir.find_last_of('/'));
-  srcdir = srcdir.substr(0, srcdir.find_last_of('/'));
-  srcdir = srcdir + "/src/lib";
-	string line;
-  ifstream errfile(srcdir	+ "/configs/auto-freed-alloc-funcs");
-  if (errfile.is_open()) {
-		while (!errfile.eof()) {
-			getline (errfile, line);
-			if (line.length() > 1) {
-				AutoFreedFuncs.insert(line);
-			}
-		}
-    errfile.close();
+  string line;
+  while (!cfgfile.eof()) {
+    getline (cfgfile, line);
+    if (line.length() > 1)
+      Lines.push_back(line);
   }
+  cfgfile.close();
+  return true;
+}
+
+// Compiled-in defaults, with the entries of a -config-dir file merged in
+template <size_t NumSlots>
+static void LoadNameSet(NameSet &Names, const StaticNameTable<NumSlots> &Defaults,
+    const char *FileName) {
 
+  Names.setDefaults(Defaults);
+  if (!FileName || ConfigDir.empty())
+    return;
+
+  vector<string> lines;
+  ReadConfigFile(FileName, lines);
+  Names.insert(lines.begin(), lines.end());
 }
 
-static void SetEscapeFuncs(set<string> &EscapeFuncs) {
-
-  string exepath = sys::fs::getMainExecutable(NULL, NULL);
-	string exedir = exepath.substr(0, exepath.find_last_of('/'));
-  string srcdir = exedir.substr(0, exedir.find_last_of('/'));
-  srcdir = srcdir.substr(0, srcdir.find_last_of('/'));
-  srcdir = srcdir + "/src/lib";
-	string line;
-  ifstream errfile(srcdir	+ "/configs/escape-funcs");
-  if (errfile.is_open()) {
-		while (!errfile.eof()) {
-			getline (errfile, line);
-			if (line.length() > 1) {
-				EscapeFuncs.insert(line);
-			}
-		}
-    errfile.close();
-  }
+// Ordered lists (paired by position) are replaced by a -config-dir file
+template <size_t N>
+static void LoadNameList(vector<string> &List, const char *const (&Defaults)[N],
+    const char *FileName) {
 
+  List.clear();
+  if (ReadConfigFile(FileName, List))
+    return;
+  List.assign(Defaults, Defaults + N);
 }
 
-static void SetMemberGetFuncs(set<string> &MemberGetFuncs) {
-
-  string exepath = sys::fs::getMainExecutable(NULL, NULL);
-	string exedir = exepath.substr(0, exepath.find_last_of('/'));
-  string srcdir = exedir.substr(0, exedir.find_last_of('/'));
-  srcdir = srcdir.substr(0, srcdir.find_last_of('/'));
-  srcdir = srcdir + "/src/lib";
-	string line;
-  ifstream errfile(srcdir	+ "/configs/member-get-funcs");
-  if (errfile.is_open()) {
-		while (!errfile.eof()) {
-			getline (errfile, line);
-			if (line.length() > 1) {
-				MemberGetFuncs.insert(line);
-			}
-		}
-    errfile.close();
-  }
+static void SetSkipFuncs(NameSet &SkipFuncs) {
+  LoadNameSet(SkipFuncs, KraceSkipFuncTable, "krace-skip-funcs");
+}
 
+//Used for debug
+static void SetTestFuncs(NameSet &TestFuncs) {
+  LoadNameSet(TestFuncs, TestFuncTable, "test-funcs");
 }
 
-// Setup functions that handle errors
-static void SetErrorHandleFuncs(set<string> &ErrorHandleFuncs) {
-
-	string exepath = sys::fs::getMainExecutable(NULL, NULL);
-	string exedir = exepath.substr(0, exepath.find_last_of('/'));
-  string srcdir = exedir.substr(0, exedir.find_last_of('/'));
-  srcdir = srcdir.substr(0, srcdir.find_last_of('/'));
-  srcdir = srcdir + "/src/lib";
-	string line;
-  ifstream errfile(srcdir	+ "/configs/err-funcs");
-  if (errfile.is_open()) {
-		while (!errfile.eof()) {
-			getline (errfile, line);
-			if (line.length() > 1) {
-				ErrorHandleFuncs.insert(line);
-			}
-		}
-    errfile.close();
-  }
+static void SetAutoFreedFuncs(NameSet &AutoFreedFuncs) {
+  LoadNameSet(AutoFreedFuncs, AutoFreedFuncTable, "auto-freed-alloc-funcs");
+}
 
-	string ErrorHandleFN[] = {
-		"BUG",
-		"BUG_ON",
-		"ASM_BUG",
-		"panic",
-		"ASSERT",
-		"assert",
-		"dump_stack",
-		"__warn_printk",
-		"usercopy_warn",
-		"signal_fault",
-		"pr_err",
-		"pr_warn",
-		"pr_warning",
-		"pr_alert",
-		"pr_emerg",
-		"pr_crit",
-	};
-	for (auto F : ErrorHandleFN) {
-		ErrorHandleFuncs.insert(F);
-	}
+static void SetEscapeFuncs(NameSet &EscapeFuncs) {
+  LoadNameSet(EscapeFuncs, EscapeFuncTable, "escape-funcs");
 }
 
-static void SetRefcountRelatedFuncs(set<string> &RefcountRelatedFuncs) {
-
-  string exepath = sys::fs::getMainExecutable(NULL, NULL);
-	string exedir = exepath.substr(0, exepath.find_last_of('/'));
-  string srcdir = exedir.substr(0, exedir.find_last_of('/'));
-  srcdir = srcdir.substr(0, srcdir.find_last_of('/'));
-  srcdir = srcdir + "/src/lib";
-	string line;
-  ifstream errfile(srcdir	+ "/configs/refcount-related-funcs");
-  if (errfile.is_open()) {
-		while (!errfile.eof()) {
-			getline (errfile, line);
-			if (line.length() > 1) {
-				RefcountRelatedFuncs.insert(line);
-			}
-		}
-    errfile.close();
-  }
+static void SetMemberGetFuncs(NameSet &MemberGetFuncs) {
+  LoadNameSet(MemberGetFuncs, MemberGetFuncTable, "member-get-funcs");
+}
+
+// Setup functions that handle errors. Profile selects the error
+// function list: "linux" (default), "freebsd" or "php".
+static bool SetErrorHandleFuncs(NameSet &ErrorHandleFuncs, StringRef Profile) {
+
+  if (Profile == "freebsd")
+    LoadNameSet(ErrorHandleFuncs, ErrFuncTableFreeBSD, "err-funcs-freebsd");
+  else if (Profile == "php")
+    LoadNameSet(ErrorHandleFuncs, ErrFuncTablePHP, "err-funcs-php");
+  else if (Profile == "linux")
+    LoadNameSet(ErrorHandleFuncs, ErrFuncTableLinux, "err-funcs");
+  else
+    return false;
+  return true;
+}
 
+static void SetRefcountRelatedFuncs(NameSet &RefcountRelatedFuncs) {
+  LoadNameSet(RefcountRelatedFuncs, RefcountRelatedFuncTable, "refcount-related-funcs");
 }
 
 
 static void SetRefcountFuncs(map<string, set<string>> &RefcountFuncs) {
 
-  string exepath = sys::fs::getMainExecutable(NULL, NULL);
-	string exedir = exepath.substr(0, exepath.find_last_of('/'));
-  string srcdir = exedir.substr(0, exedir.find_last_of('/'));
-  srcdir = srcdir.substr(0, srcdir.find_last_of('/'));
-  srcdir = srcdir + "/src/lib";
-  string line;
-  ifstream refcountincfuncfile(srcdir	+ "/configs/refcount-funcs-inc");
-  ifstream refcountdecfuncfile(srcdir	+ "/configs/refcount-funcs-dec");
-
   vector<string> refcountincfuncarray;
   vector<string> refcountdecfuncarray;
-  refcountincfuncarray.clear();
-  refcountdecfuncarray.clear();
-
-  if (refcountincfuncfile.is_open()) {
-		while (!refcountincfuncfile.eof()) {
-			getline (refcountincfuncfile, line);
-			if (line.length() > 1) {
-				//PairFuncs.insert(line);
-        refcountincfuncarray.push_back(line);
-			}
-		}
-    refcountincfuncfile.close();
-  }
-
-  if (refcountdecfuncfile.is_open()) {
-		while (!refcountdecfuncfile.eof()) {
-			getline (refcountdecfuncfile, line);
-			if (line.length() > 1) {
-				//PairFuncs.insert(line);
-        refcountdecfuncarray.push_back(line);
-			}
-		}
-    refcountdecfuncfile.close();
-  }
+  LoadNameList(refcountincfuncarray, RefcountIncFuncNames, "refcount-funcs-inc");
+  LoadNameList(refcountdecfuncarray, RefcountDecFuncNames, "refcount-funcs-dec");
 
   //Merge
   for(int i = 0; i<refcountincfuncarray.size(); i++){
@@ -244,60 +137,20 @@ static void SetRefcountFuncs(map<string, set<string>> &RefcountFuncs) {
 }
 
 // Setup pair functions here.
-static void SetPairFuncs(map<string, set<string>> &PairFuncs, set<string> &PairFuncs_Lead){
-
-  string exepath = sys::fs::getMainExecutable(NULL, NULL);
-	string exedir = exepath.substr(0, exepath.find_last_of('/'));
-  string srcdir = exedir.substr(0, exedir.find_last_of('/'));
-  srcdir = srcdir.substr(0, srcdir.find_last_of('/'));
-  srcdir = srcdir + "/src/lib";
-	string line;
-  ifstream leadfuncfile(srcdir	+ "/configs/pair-funcs-lead");
-  ifstream followerfuncfile(srcdir	+ "/configs/pair-funcs-follower");
-  
+static void SetPairFuncs(map<string, set<string>> &PairFuncs, NameSet &PairFuncs_Lead){
+
   vector<string> leadfuncarray;
   vector<string> followerfuncarray;
-  leadfuncarray.clear();
-  followerfuncarray.clear();
-  /* OP << "exepath: "<<exepath<<"\n";
-  OP << "exedir: "<<exedir<<"\n";
-  OP << "srcdir: "<<srcdir<<"\n"; */
-
-  if (leadfuncfile.is_open()) {
-		while (!leadfuncfile.eof()) {
-			getline (leadfuncfile, line);
-			if (line.length() > 1) {
-				//PairFuncs.insert(line);
-        leadfuncarray.push_back(line);
-			}
-		}
-    leadfuncfile.close();
-  }
-
-  if (followerfuncfile.is_open()) {
-		while (!followerfuncfile.eof()) {
-			getline (followerfuncfile, line);
-			if (line.length() > 1) {
-				//PairFuncs.insert(line);
-        followerfuncarray.push_back(line);
-			}
-		}
-    followerfuncfile.close();
-  }
+  LoadNameList(leadfuncarray, PairLeadFuncNames, "pair-funcs-lead");
+  LoadNameList(followerfuncarray, PairFollowerFuncNames, "pair-funcs-follower");
 
   //Merge
-  for(int i = 0; i<leadfuncarray.size(); i++){
+  for(int i = 0; i<leadfuncarray.size() && i<followerfuncarray.size(); i++){
 
-    //if(1 == PairFuncs.count(leadfuncarray[i])){
     PairFuncs[leadfuncarray[i]].insert(followerfuncarray[i]);
-    //}
     PairFuncs[followerfuncarray[i]].insert(leadfuncarray[i]);
 
     PairFuncs_Lead.insert(leadfuncarray[i]);
-    /* pair<string, string> value(leadfuncarray[i],followerfuncarray[i]);
-    PairFuncs.insert(value);
-    pair<string, string> value_reverse(followerfuncarray[i],leadfuncarray[i]);
-    PairFuncs.insert(value_reverse); */
   }
 
 }
@@ -318,73 +171,18 @@ static void SetSinkFuncs(
 }
 
 // Setup debug functions here.
-static void SetDebugFuncs(
-  std::set<std::string> &DebugFuncs){
-
-  std::string DebugFN[] = {
-    "llvm.dbg.declare",
-    "llvm.dbg.value",
-    "llvm.dbg.label",
-    "llvm.lifetime.start",
-		"llvm.lifetime.end",
-    "llvm.lifetime.start.p0i8",
-    "llvm.lifetime.end.p0i8",
-    "arch_static_branch",
-  };
-
-  for (auto F : DebugFN){
-    DebugFuncs.insert(F);
-  }
-
+static void SetDebugFuncs(NameSet &DebugFuncs){
+  LoadNameSet(DebugFuncs, DebugFuncTable, NULL);
 }
 
 // Setup ignore instructions here.
-static void SetBinaryOperandInsts(
-  std::set<std::string> &BinaryOperandInsts){
-
-  std::string BinaryInst[] = {
-    "and",
-    "or",
-    "xor",
-    "shl",
-    "lshr",
-    "ashr",
-    "add",
-    "sub",
-    "mul",
-    "sdiv",
-    "udiv",
-    "urem",
-    "srem",
-    //"alloca",
-  };
-
-  for (auto I : BinaryInst){
-    BinaryOperandInsts.insert(I);
-  }
-
+static void SetBinaryOperandInsts(NameSet &BinaryOperandInsts){
+  LoadNameSet(BinaryOperandInsts, BinaryOperandInstTable, NULL);
 }
 
 // Setup ignore instructions here.
-static void SetSingleOperandInsts(
-  std::set<std::string> &SingleOperandInsts){
-
-  std::string SingleOperandInst[] = {
-    "bitcast",
-    "trunc",
-    "sext",
-    "zext",
-    "inttoptr",
-    "ptrtoint",
-    "extractvalue",
-    "extractelement",
-
-  };
-
-  for (auto I : SingleOperandInst){
-    SingleOperandInsts.insert(I);
-  }
-
+static void SetSingleOperandInsts(NameSet &SingleOperandInsts){
+  LoadNameSet(SingleOperandInsts, SingleOperandInstTable, NULL);
 }
 
 // Setup functions that nerver sink.
@@ -514,28 +312,8 @@ static void SetCopyFuncs(
 }
 
 // Setup functions for heap allocations.
-static void SetHeapAllocFuncs(
-		std::set<std::string> &HeapAllocFuncs){
-
-	std::string HeapAllocFN[] = {
-		"__kmalloc",
-		"__vmalloc",
-		"vmalloc",
-		"krealloc",
-		"devm_kzalloc",
-		"vzalloc",
-		"malloc",
-		"kmem_cache_alloc",
-		"__alloc_skb",
-    "kzalloc", //New added
-    "kmalloc", //New added
-    "kmalloc_array", //New added
-    "alloc", //New added 
-	};
-
-	for (auto F : HeapAllocFN) {
-		HeapAllocFuncs.insert(F);
-	}
+static void SetHeapAllocFuncs(NameSet &HeapAllocFuncs){
+  LoadNameSet(HeapAllocFuncs, HeapAllocFuncTable, NULL);
 }
 
 #endif
@@ -0,0 +1,84 @@
+#ifndef _CONFIG_TABLES_H
+#define _CONFIG_TABLES_H
+
+#include "NameSet.h"
+
+//
+// Default configuration lists compiled into the analyzer. The lists
+// mirroring the files under configs/ are generated from them at build
+// time into ConfigFileTables.h (see GenConfigTables.cmake). Files are
+// only read at start-up from a directory given with -config-dir (see
+// Config.h).
+//
+
+// Generic error handling functions, appended to every error function list
+#define GENERIC_ERR_FUNC_NAMES \
+	"BUG", "BUG_ON", "ASM_BUG", "panic", "ASSERT", "assert", \
+	"dump_stack", "__warn_printk", "usercopy_warn", "signal_fault", \
+	"pr_err", "pr_warn", "pr_warning", "pr_alert", "pr_emerg", "pr_crit",
+
+#include "ConfigFileTables.h"
+
+// LLVM debug functions
+static constexpr const char *DebugFuncNames[] = {
+	"llvm.dbg.declare",
+	"llvm.dbg.value",
+	"llvm.dbg.label",
+	"llvm.lifetime.start",
+	"llvm.lifetime.end",
+	"llvm.lifetime.start.p0i8",
+	"llvm.lifetime.end.p0i8",
+	"arch_static_branch",
+};
+static constexpr auto DebugFuncTable = NAME_TABLE(DebugFuncNames);
+
+// Binary operand instructions
+static constexpr const char *BinaryOperandInstNames[] = {
+	"and",
+	"or",
+	"xor",
+	"shl",
+	"lshr",
+	"ashr",
+	"add",
+	"sub",
+	"mul",
+	"sdiv",
+	"udiv",
+	"urem",
+	"srem",
+};
+static constexpr auto BinaryOperandInstTable = NAME_TABLE(BinaryOperandInstNames);
+
+// Single operand instructions
+static constexpr const char *SingleOperandInstNames[] = {
+	"bitcast",
+	"trunc",
+	"sext",
+	"zext",
+	"inttoptr",
+	"ptrtoint",
+	"extractvalue",
+	"extractelement",
+};
+static constexpr auto SingleOperandInstTable = NAME_TABLE(SingleOperandInstNames);
+
+// Functions for heap allocations
+static constexpr const char *HeapAllocFuncNames[] = {
+	"__kmalloc",
+	"__vmalloc",
+	"vmalloc",
+	"krealloc",
+	"devm_kzalloc",
+	"vzalloc",
+	"malloc",
+	"kmem_cache_alloc",
+	"__alloc_skb",
+	"kzalloc",
+	"kmalloc",
+	"kmalloc_array",
+	"alloc",
+};
+static constexpr auto HeapAllocFuncTable = NAME_TABLE(HeapAllocFuncNames);
+
+#endif
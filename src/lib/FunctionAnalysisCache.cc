@@ -0,0 +1,456 @@
+//===-- FunctionAnalysisCache.cc - Shared per-function analyses ----===//
+//
+// Block numbering, topological order, dominator trees, reachability,
+// edge numbering, block summaries and error edges of a function,
+// computed once and shared by all passes.
+//
+//===-----------------------------------------------------------===//
+
+#include <llvm/IR/CFG.h>
+
+#include <algorithm>
+#include <deque>
+
+#include "FunctionAnalysisCache.h"
+
+using namespace llvm;
+
+FunctionAnalyses::FunctionAnalyses(Function *F_) : F(F_) {
+
+	for (BasicBlock &B : *F) {
+		BlockIDs[&B] = Blocks.size();
+		Blocks.push_back(&B);
+	}
+	RecordedSize = getMemoryUsage();
+}
+
+unsigned FunctionAnalyses::getBlockID(BasicBlock *BB) const {
+
+	auto It = BlockIDs.find(BB);
+	assert(It != BlockIDs.end() && "Block of another function");
+	return It->second;
+}
+
+// Kahn's algorithm, the same order as CallGraphPass::topSort
+const std::vector<BasicBlock *> &FunctionAnalyses::getTopOrder() {
+
+	if (HasTopOrder)
+		return TopOrder;
+	HasTopOrder = true;
+
+	std::vector<unsigned> Indegree(Blocks.size(), 0);
+	for (BasicBlock *B : Blocks) {
+		for (BasicBlock *Succ : successors(B)) {
+			if (Succ != B)
+				Indegree[getBlockID(Succ)]++;
+		}
+	}
+
+	std::deque<BasicBlock *> Ready;
+	for (unsigned i = 0; i < Blocks.size(); ++i) {
+		if (Indegree[i] == 0)
+			Ready.push_back(Blocks[i]);
+	}
+
+	TopOrder.reserve(Blocks.size());
+	while (!Ready.empty()) {
+		BasicBlock *B = Ready.front();
+		Ready.pop_front();
+		TopOrder.push_back(B);
+
+		for (BasicBlock *Succ : successors(B)) {
+			if (Succ != B && --Indegree[getBlockID(Succ)] == 0)
+				Ready.push_back(Succ);
+		}
+	}
+
+	if (TopOrder.size() != Blocks.size())
+		TopOrder.clear();
+	recordMemoryUsage();
+	return TopOrder;
+}
+
+void FunctionAnalyses::setTopOrder(std::vector<BasicBlock *> &&Order) {
+
+	TopOrder = std::move(Order);
+	if (TopOrder.size() != Blocks.size())
+		TopOrder.clear();
+	HasTopOrder = true;
+	recordMemoryUsage();
+}
+
+DominatorTree &FunctionAnalyses::getDomTree() {
+
+	if (!DT) {
+		DT.reset(new DominatorTree(*F));
+		recordMemoryUsage();
+	}
+	return *DT;
+}
+
+PostDominatorTree &FunctionAnalyses::getPostDomTree() {
+
+	if (!PDT) {
+		PDT.reset(new PostDominatorTree(*F));
+		recordMemoryUsage();
+	}
+	return *PDT;
+}
+
+// Loop-free functions take the union of the successor rows in reverse
+// topological order, others fall back to a walk per block.
+void FunctionAnalyses::computeReachability() {
+
+	unsigned N = Blocks.size();
+	Reach.assign(N, BitVector(N));
+
+	const std::vector<BasicBlock *> &Order = getTopOrder();
+	if (!Order.empty()) {
+		for (auto It = Order.rbegin(); It != Order.rend(); ++It) {
+			unsigned ID = getBlockID(*It);
+			Reach[ID].set(ID);
+			for (BasicBlock *Succ : successors(*It))
+				Reach[ID] |= Reach[getBlockID(Succ)];
+		}
+		return;
+	}
+
+	std::vector<unsigned> Worklist;
+	for (unsigned ID = 0; ID < N; ++ID) {
+		BitVector &Row = Reach[ID];
+		Row.set(ID);
+		Worklist.push_back(ID);
+		while (!Worklist.empty()) {
+			BasicBlock *B = Blocks[Worklist.back()];
+			Worklist.pop_back();
+			for (BasicBlock *Succ : successors(B)) {
+				unsigned SuccID = getBlockID(Succ);
+				if (!Row.test(SuccID)) {
+					Row.set(SuccID);
+					Worklist.push_back(SuccID);
+				}
+			}
+		}
+	}
+}
+
+bool FunctionAnalyses::isReachable(BasicBlock *From, BasicBlock *To) {
+
+	if (Reach.empty()) {
+		computeReachability();
+		recordMemoryUsage();
+	}
+	return Reach[getBlockID(From)].test(getBlockID(To));
+}
+
+const ReachabilityIndex &FunctionAnalyses::getReachability(const CFGEdgeMap &Ignore) {
+
+	for (auto &Index : ReachVariants) {
+		if (Index->getIgnoredEdges() == Ignore)
+			return *Index;
+	}
+	ReachVariants.emplace_back(new ReachabilityIndex(*this, Ignore));
+	recordMemoryUsage();
+	return *ReachVariants.back();
+}
+
+const CFGEdgeIndex &FunctionAnalyses::getEdgeIndex() {
+
+	if (!Edges) {
+		Edges.reset(new CFGEdgeIndex(*this));
+		recordMemoryUsage();
+	}
+	return *Edges;
+}
+
+const BlockSummary &FunctionAnalyses::getBlockSummary(BasicBlock *BB) {
+
+	if (Summaries.empty() && !Blocks.empty()) {
+		Summaries.resize(Blocks.size());
+		unsigned InstID = 0;
+		for (unsigned ID = 0; ID < Blocks.size(); ++ID) {
+			BlockSummary &Summary = Summaries[ID];
+			Summary.FirstInst = InstID;
+			for (Instruction &I : *Blocks[ID]) {
+				if (CallInst *CI = dyn_cast<CallInst>(&I))
+					Summary.CallInsts.push_back(CI);
+				++InstID;
+			}
+			Summary.NumInsts = InstID - Summary.FirstInst;
+		}
+		recordMemoryUsage();
+	}
+	return Summaries[getBlockID(BB)];
+}
+
+size_t FunctionAnalyses::getMemoryUsage() const {
+
+	size_t N = Blocks.size();
+	size_t Size = sizeof(*this);
+	Size += N * (sizeof(BasicBlock *) * 2 + sizeof(unsigned));
+	Size += TopOrder.capacity() * sizeof(BasicBlock *);
+
+	// Rough per-node cost of the dominator trees
+	if (DT)
+		Size += N * 64;
+	if (PDT)
+		Size += N * 64;
+
+	if (!Reach.empty())
+		Size += N * (sizeof(BitVector) + (N + 7) / 8);
+
+	for (auto &Summary : Summaries)
+		Size += sizeof(Summary) + Summary.CallInsts.capacity() * sizeof(CallInst *);
+
+	Size += ErrorEdges.size() * (sizeof(CFGEdge) + sizeof(int) + 32);
+
+	for (auto &Rel : StructRelations)
+		Size += 48 + Rel.second.size() * (sizeof(Value *) + 32);
+
+	for (auto &Index : ReachVariants)
+		Size += Index->getMemoryUsage();
+	if (Edges)
+		Size += Edges->getMemoryUsage();
+	return Size;
+}
+
+// Same construction as computeReachability, skipping the ignored edges
+ReachabilityIndex::ReachabilityIndex(FunctionAnalyses &FA_,
+		const CFGEdgeMap &Ignore_) : FA(FA_), Ignore(Ignore_) {
+
+	const std::vector<BasicBlock *> &Blocks = FA.getBlocks();
+	unsigned N = Blocks.size();
+	Rows.assign(N, BitVector(N));
+
+	const std::vector<BasicBlock *> &Order = FA.getTopOrder();
+	if (!Order.empty()) {
+		for (auto It = Order.rbegin(); It != Order.rend(); ++It) {
+			unsigned ID = FA.getBlockID(*It);
+			Instruction *TI = (*It)->getTerminator();
+			Rows[ID].set(ID);
+			for (BasicBlock *Succ : successors(*It)) {
+				if (!isIgnored(TI, Succ))
+					Rows[ID] |= Rows[FA.getBlockID(Succ)];
+			}
+		}
+		return;
+	}
+
+	std::vector<unsigned> Worklist;
+	for (unsigned ID = 0; ID < N; ++ID) {
+		BitVector &Row = Rows[ID];
+		Row.set(ID);
+		Worklist.push_back(ID);
+		while (!Worklist.empty()) {
+			BasicBlock *B = Blocks[Worklist.back()];
+			Worklist.pop_back();
+			Instruction *TI = B->getTerminator();
+			for (BasicBlock *Succ : successors(B)) {
+				unsigned SuccID = FA.getBlockID(Succ);
+				if (!Row.test(SuccID) && !isIgnored(TI, Succ)) {
+					Row.set(SuccID);
+					Worklist.push_back(SuccID);
+				}
+			}
+		}
+	}
+}
+
+bool ReachabilityIndex::reaches(BasicBlock *From, BasicBlock *To) const {
+
+	if (!From || !To)
+		return false;
+	return Rows[FA.getBlockID(From)].test(FA.getBlockID(To));
+}
+
+// Every block of a path that avoids Extra also reaches To in the index,
+// so the walk never leaves the blocks whose row has To
+bool ReachabilityIndex::reaches(BasicBlock *From, BasicBlock *To,
+		const CFGEdgeMap &Extra) const {
+
+	if (!reaches(From, To))
+		return false;
+	if (Extra.empty() || From == To)
+		return true;
+
+	unsigned ToID = FA.getBlockID(To);
+	BitVector Visited(Rows.size());
+	std::vector<BasicBlock *> Worklist(1, From);
+	Visited.set(FA.getBlockID(From));
+
+	while (!Worklist.empty()) {
+		BasicBlock *B = Worklist.back();
+		Worklist.pop_back();
+		Instruction *TI = B->getTerminator();
+
+		for (BasicBlock *Succ : successors(B)) {
+			unsigned SuccID = FA.getBlockID(Succ);
+			if (Visited.test(SuccID) || !Rows[SuccID].test(ToID))
+				continue;
+			if (isIgnored(TI, Succ) || Extra.count(std::make_pair(TI, Succ)))
+				continue;
+			if (Succ == To)
+				return true;
+			Visited.set(SuccID);
+			Worklist.push_back(Succ);
+		}
+	}
+	return false;
+}
+
+size_t ReachabilityIndex::getMemoryUsage() const {
+
+	size_t N = Rows.size();
+	return sizeof(*this) + Ignore.size() * (sizeof(CFGEdge) + sizeof(int) + 32)
+		+ N * (sizeof(BitVector) + (N + 7) / 8);
+}
+
+CFGEdgeIndex::CFGEdgeIndex(FunctionAnalyses &FA_) : FA(FA_) {
+
+	const std::vector<BasicBlock *> &Blocks = FA.getBlocks();
+	unsigned N = Blocks.size();
+
+	// Outgoing edges, numbered by source block
+	std::vector<unsigned> LastSource(N, N);
+	std::vector<unsigned> NumIn(N, 0);
+	OutBegin.reserve(N + 1);
+	for (unsigned ID = 0; ID < N; ++ID) {
+		OutBegin.push_back(Sources.size());
+		for (BasicBlock *Succ : successors(Blocks[ID])) {
+			unsigned SuccID = FA.getBlockID(Succ);
+			if (LastSource[SuccID] == ID)
+				continue;
+			LastSource[SuccID] = ID;
+			Sources.push_back(ID);
+			Targets.push_back(SuccID);
+			NumIn[SuccID]++;
+		}
+	}
+	OutBegin.push_back(Sources.size());
+	OutEdges.resize(Sources.size());
+	for (unsigned E = 0; E < Sources.size(); ++E)
+		OutEdges[E] = E;
+
+	// Incoming edges, bucketed by target block
+	InBegin.assign(N + 1, 0);
+	for (unsigned ID = 0; ID < N; ++ID)
+		InBegin[ID + 1] = InBegin[ID] + NumIn[ID];
+	std::vector<unsigned> Fill(InBegin.begin(), InBegin.end() - 1);
+	InEdges.resize(Sources.size());
+	for (unsigned E = 0; E < Sources.size(); ++E)
+		InEdges[Fill[Targets[E]]++] = E;
+
+	// Iterative DFS from the entry for the post-order
+	if (!N)
+		return;
+	std::vector<bool> Visited(N, false);
+	std::vector<std::pair<unsigned, unsigned>> Stack;
+	RPO.reserve(N);
+	Stack.push_back(std::make_pair(0, OutBegin[0]));
+	Visited[0] = true;
+	while (!Stack.empty()) {
+		unsigned ID = Stack.back().first;
+		unsigned &Next = Stack.back().second;
+		if (Next == OutBegin[ID + 1]) {
+			RPO.push_back(ID);
+			Stack.pop_back();
+			continue;
+		}
+		unsigned SuccID = Targets[Next++];
+		if (!Visited[SuccID]) {
+			Visited[SuccID] = true;
+			Stack.push_back(std::make_pair(SuccID, OutBegin[SuccID]));
+		}
+	}
+	std::reverse(RPO.begin(), RPO.end());
+
+	for (unsigned ID = 0; ID < N; ++ID) {
+		if (!Visited[ID])
+			RPO.push_back(ID);
+	}
+}
+
+CFGEdgeIndex::CFGEdge CFGEdgeIndex::getEdge(unsigned E) const {
+
+	return std::make_pair(FA.getBlock(Sources[E])->getTerminator(),
+		FA.getBlock(Targets[E]));
+}
+
+size_t CFGEdgeIndex::getMemoryUsage() const {
+
+	return sizeof(*this) + (Sources.size() * 4 + OutBegin.size()
+		+ InBegin.size() + RPO.size()) * sizeof(unsigned);
+}
+
+std::shared_ptr<FunctionAnalyses> FunctionAnalysisCache::get(Function *F) {
+
+	std::lock_guard<std::mutex> Guard(Lock);
+
+	auto It = Entries.find(F);
+	if (It != Entries.end()) {
+		Entry &E = It->second;
+		LRU.splice(LRU.begin(), LRU, E.LRUPos);
+
+		// Analyses grow lazily, refresh the size of the entry on reuse.
+		// Another thread may be filling them, so take the recorded size.
+		MemoryUsage -= E.Size;
+		E.Size = E.Analyses->getRecordedMemoryUsage();
+		MemoryUsage += E.Size;
+
+		std::shared_ptr<FunctionAnalyses> Analyses = E.Analyses;
+		evict(F);
+		return Analyses;
+	}
+
+	Entry E;
+	E.Analyses = std::make_shared<FunctionAnalyses>(F);
+	LRU.push_front(F);
+	E.LRUPos = LRU.begin();
+	E.Size = E.Analyses->getRecordedMemoryUsage();
+	MemoryUsage += E.Size;
+
+	std::shared_ptr<FunctionAnalyses> Analyses = E.Analyses;
+	Entries[F] = std::move(E);
+	evict(F);
+	return Analyses;
+}
+
+// Drop least recently used entries until the budget is met
+void FunctionAnalysisCache::evict(Function *Keep) {
+
+	if (!MemoryBudget)
+		return;
+
+	while (MemoryUsage > MemoryBudget && !LRU.empty()) {
+		Function *Victim = LRU.back();
+		if (Victim == Keep)
+			break;
+
+		auto It = Entries.find(Victim);
+		MemoryUsage -= It->second.Size;
+		LRU.pop_back();
+		Entries.erase(It);
+		NumEvictions++;
+	}
+}
+
+void FunctionAnalysisCache::invalidate(Function *F) {
+
+	std::lock_guard<std::mutex> Guard(Lock);
+
+	auto It = Entries.find(F);
+	if (It == Entries.end())
+		return;
+
+	MemoryUsage -= It->second.Size;
+	LRU.erase(It->second.LRUPos);
+	Entries.erase(It);
+}
+
+void FunctionAnalysisCache::clear() {
+
+	std::lock_guard<std::mutex> Guard(Lock);
+	Entries.clear();
+	LRU.clear();
+	MemoryUsage = 0;
+}
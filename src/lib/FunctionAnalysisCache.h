@@ -0,0 +1,316 @@
+#ifndef _FUNCTION_ANALYSIS_CACHE_H
+#define _FUNCTION_ANALYSIS_CACHE_H
+
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Dominators.h>
+#include <llvm/Analysis/PostDominators.h>
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/BitVector.h>
+#include <llvm/ADT/DenseMap.h>
+
+#include <atomic>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+class ReachabilityIndex;
+class CFGEdgeIndex;
+
+//
+// Facts of one block that path collection and the checkers read instead
+// of walking its instructions
+//
+struct BlockSummary {
+	// Call instructions in block order
+	std::vector<llvm::CallInst *> CallInsts;
+	// Instructions [FirstInst, FirstInst + NumInsts) in function order
+	unsigned FirstInst = 0;
+	unsigned NumInsts = 0;
+};
+
+//
+// Per-function facts shared by the passes. Every analysis is computed
+// the first time it is requested. An instance is used by one thread at
+// a time; the cache below hands instances out to any thread and reads
+// only the size recorded after each computation.
+//
+class FunctionAnalyses {
+
+	public:
+		// Same layout as the CFGEdge maps of the passes
+		typedef std::pair<llvm::Instruction *, llvm::BasicBlock *> CFGEdge;
+		typedef std::map<CFGEdge, int> CFGEdgeMap;
+		// Same layout as PointerAnalysisMap
+		typedef std::map<llvm::Value *, std::set<llvm::Value *>> ValueRelationMap;
+
+		FunctionAnalyses(llvm::Function *F_);
+
+		llvm::Function *getFunction() const { return F; }
+
+		// Dense block numbering in function order
+		unsigned getNumBlocks() const { return Blocks.size(); }
+		const std::vector<llvm::BasicBlock *> &getBlocks() const { return Blocks; }
+		llvm::BasicBlock *getBlock(unsigned ID) const { return Blocks[ID]; }
+		unsigned getBlockID(llvm::BasicBlock *BB) const;
+
+		// Topological block order, self-loops ignored. Empty if the
+		// function still has a loop.
+		const std::vector<llvm::BasicBlock *> &getTopOrder();
+		void setTopOrder(std::vector<llvm::BasicBlock *> &&Order);
+
+		llvm::DominatorTree &getDomTree();
+		llvm::PostDominatorTree &getPostDomTree();
+
+		// Reachability over all CFG edges. A block reaches itself.
+		bool isReachable(llvm::BasicBlock *From, llvm::BasicBlock *To);
+
+		// Reachability without the edges of Ignore, built once per
+		// distinct edge set (the normal-path and error-path masks of the
+		// path pair analysis)
+		const ReachabilityIndex &getReachability(const CFGEdgeMap &Ignore);
+
+		// Dense edge numbering for the edge dataflow solver
+		const CFGEdgeIndex &getEdgeIndex();
+
+		// Summaries of all blocks are built on the first request
+		const BlockSummary &getBlockSummary(llvm::BasicBlock *BB);
+
+		// Error edges of the path pair analysis. They depend on pass
+		// state, so the pass computes them through Compute once.
+		template <typename ComputeT>
+		const CFGEdgeMap &getErrorEdges(ComputeT Compute) {
+			if (!HasErrorEdges) {
+				Compute(ErrorEdges);
+				HasErrorEdges = true;
+				recordMemoryUsage();
+			}
+			return ErrorEdges;
+		}
+
+		// Struct relations of the pointer analysis, computed the first
+		// time a checker asks for them
+		template <typename ComputeT>
+		const ValueRelationMap &getStructRelations(ComputeT Compute) {
+			if (!HasStructRelations) {
+				Compute(StructRelations);
+				HasStructRelations = true;
+				recordMemoryUsage();
+			}
+			return StructRelations;
+		}
+
+		// Approximate size in bytes of what has been computed so far
+		size_t getMemoryUsage() const;
+
+		// Size as of the last computation, safe to read from any thread
+		size_t getRecordedMemoryUsage() const {
+			return RecordedSize.load(std::memory_order_relaxed);
+		}
+
+	private:
+		void computeReachability();
+		void recordMemoryUsage() {
+			RecordedSize.store(getMemoryUsage(), std::memory_order_relaxed);
+		}
+
+		llvm::Function *F;
+		std::vector<llvm::BasicBlock *> Blocks;
+		llvm::DenseMap<llvm::BasicBlock *, unsigned> BlockIDs;
+
+		bool HasTopOrder = false;
+		std::vector<llvm::BasicBlock *> TopOrder;
+
+		std::unique_ptr<llvm::DominatorTree> DT;
+		std::unique_ptr<llvm::PostDominatorTree> PDT;
+
+		// Row i: blocks reachable from block i
+		std::vector<llvm::BitVector> Reach;
+		std::vector<std::unique_ptr<ReachabilityIndex>> ReachVariants;
+
+		std::unique_ptr<CFGEdgeIndex> Edges;
+
+		std::vector<BlockSummary> Summaries;
+
+		bool HasErrorEdges = false;
+		CFGEdgeMap ErrorEdges;
+
+		bool HasStructRelations = false;
+		ValueRelationMap StructRelations;
+
+		std::atomic<size_t> RecordedSize;
+};
+
+//
+// Transitive closure of the CFG of a function without a set of ignored
+// edges, one bit row per block. Queries read one bit; queries that
+// ignore further edges only walk blocks that still reach the target.
+//
+class ReachabilityIndex {
+
+	public:
+		typedef FunctionAnalyses::CFGEdge CFGEdge;
+		typedef FunctionAnalyses::CFGEdgeMap CFGEdgeMap;
+
+		ReachabilityIndex(FunctionAnalyses &FA_, const CFGEdgeMap &Ignore_);
+
+		FunctionAnalyses &getAnalyses() const { return FA; }
+		const CFGEdgeMap &getIgnoredEdges() const { return Ignore; }
+		bool empty() const { return Rows.empty(); }
+
+		// A block reaches itself
+		bool reaches(llvm::BasicBlock *From, llvm::BasicBlock *To) const;
+
+		// As above, also ignoring the edges of Extra
+		bool reaches(llvm::BasicBlock *From, llvm::BasicBlock *To,
+			const CFGEdgeMap &Extra) const;
+
+		size_t getMemoryUsage() const;
+
+	private:
+		bool isIgnored(llvm::Instruction *TI, llvm::BasicBlock *Succ) const {
+			return Ignore.count(std::make_pair(TI, Succ)) != 0;
+		}
+
+		FunctionAnalyses &FA;
+		CFGEdgeMap Ignore;
+		std::vector<llvm::BitVector> Rows;
+};
+
+//
+// Dense numbering of the CFG edges of a function. The edges of a block
+// are numbered together; switch cases to the same successor share one
+// edge, as they share one CFGEdge key.
+//
+class CFGEdgeIndex {
+
+	public:
+		typedef FunctionAnalyses::CFGEdge CFGEdge;
+
+		CFGEdgeIndex(FunctionAnalyses &FA_);
+
+		FunctionAnalyses &getAnalyses() const { return FA; }
+		unsigned getNumEdges() const { return Sources.size(); }
+
+		// Block IDs of the ends of an edge
+		unsigned getSource(unsigned E) const { return Sources[E]; }
+		unsigned getTarget(unsigned E) const { return Targets[E]; }
+		CFGEdge getEdge(unsigned E) const;
+
+		llvm::ArrayRef<unsigned> getOutEdges(unsigned B) const {
+			return llvm::makeArrayRef(OutEdges).slice(OutBegin[B],
+				OutBegin[B + 1] - OutBegin[B]);
+		}
+		llvm::ArrayRef<unsigned> getInEdges(unsigned B) const {
+			return llvm::makeArrayRef(InEdges).slice(InBegin[B],
+				InBegin[B + 1] - InBegin[B]);
+		}
+
+		// Block IDs in reverse post-order from the entry, followed by
+		// the unreachable blocks
+		const std::vector<unsigned> &getRPO() const { return RPO; }
+
+		size_t getMemoryUsage() const;
+
+	private:
+		FunctionAnalyses &FA;
+		std::vector<unsigned> Sources;
+		std::vector<unsigned> Targets;
+		// Edges of block B are in [Begin[B], Begin[B + 1])
+		std::vector<unsigned> OutBegin, OutEdges;
+		std::vector<unsigned> InBegin, InEdges;
+		std::vector<unsigned> RPO;
+};
+
+enum class DataflowDirection { Forward, Backward };
+
+//
+// Worklist solver for problems whose facts live on CFG edges.
+// Transfer(B, Values) gives the new fact of the edges leaving block B in
+// the direction of the problem: its outgoing edges for a forward
+// problem, its incoming edges for a backward one. Values holds the
+// initial facts. Blocks are visited in reverse post-order (post-order
+// when backward) and again when an edge they read changes, so a
+// monotone Transfer reaches its fixpoint in one sweep on acyclic CFGs.
+//
+template <typename ValueT, typename TransferT>
+void solveEdgeDataflow(const CFGEdgeIndex &G, DataflowDirection Dir,
+		std::vector<ValueT> &Values, TransferT Transfer) {
+
+	bool Forward = Dir == DataflowDirection::Forward;
+	const std::vector<unsigned> &RPO = G.getRPO();
+	unsigned N = RPO.size();
+	if (!N)
+		return;
+
+	// Visiting position of each block
+	std::vector<unsigned> Order(N), Pos(N);
+	for (unsigned i = 0; i < N; ++i) {
+		Order[i] = Forward ? RPO[i] : RPO[N - 1 - i];
+		Pos[Order[i]] = i;
+	}
+
+	llvm::BitVector Pending(N, true);
+	int P = 0;
+	while (P != -1) {
+		Pending.reset(P);
+		unsigned B = Order[P];
+		ValueT V = Transfer(B, const_cast<const std::vector<ValueT> &>(Values));
+
+		// Blocks reading a changed edge; restart at the earliest one if
+		// it lies behind the current position
+		int Restart = -1;
+		for (unsigned E : Forward ? G.getOutEdges(B) : G.getInEdges(B)) {
+			if (Values[E] == V)
+				continue;
+			Values[E] = V;
+			int Q = Pos[Forward ? G.getTarget(E) : G.getSource(E)];
+			Pending.set(Q);
+			if (Q <= P && (Restart == -1 || Q < Restart))
+				Restart = Q;
+		}
+		P = Restart != -1 ? Restart : Pending.find_next(P);
+	}
+}
+
+//
+// Owns the FunctionAnalyses of all functions. Entries are evicted in
+// least recently used order once their approximate size exceeds the
+// memory budget; an evicted entry stays alive while a pass holds it.
+// A pass that changes the CFG of a function must invalidate it.
+//
+class FunctionAnalysisCache {
+
+	public:
+		std::shared_ptr<FunctionAnalyses> get(llvm::Function *F);
+
+		void invalidate(llvm::Function *F);
+		void clear();
+
+		// 0 disables eviction
+		void setMemoryBudget(size_t Bytes) { MemoryBudget = Bytes; }
+
+		size_t getMemoryUsage() const { return MemoryUsage; }
+		unsigned getNumEvictions() const { return NumEvictions; }
+
+	private:
+		struct Entry {
+			std::shared_ptr<FunctionAnalyses> Analyses;
+			std::list<llvm::Function *>::iterator LRUPos;
+			size_t Size = 0;
+		};
+
+		void evict(llvm::Function *Keep);
+
+		std::mutex Lock;
+		llvm::DenseMap<llvm::Function *, Entry> Entries;
+		std::list<llvm::Function *> LRU;    // Most recently used first
+		size_t MemoryBudget = 0;
+		size_t MemoryUsage = 0;
+		unsigned NumEvictions = 0;
+};
+
+#endif
@@ -0,0 +1,70 @@
+#
+# Generate ConfigFileTables.h, the compiled-in default lists, from the
+# files under configs/. Run by the build:
+#   cmake -DCONFIG_DIR=<configs dir> -DOUTPUT=<header> -P GenConfigTables.cmake
+#
+# Entries are the lines of a file longer than one character, as
+# ReadConfigFile in Config.h reads them from -config-dir.
+#
+
+if (NOT CONFIG_DIR OR NOT OUTPUT)
+  message(FATAL_ERROR "usage: cmake -DCONFIG_DIR=<dir> -DOUTPUT=<file> -P GenConfigTables.cmake")
+endif ()
+
+set (Header "// Generated from src/lib/configs by GenConfigTables.cmake, do not edit\n")
+
+# Append the array Array with the entries of configs/File. Table names
+# the name table built from it, none for lists paired by position.
+# Extra is appended to the entries as is.
+function (add_config_list Array File Table Comment Extra)
+  set (Path "${CONFIG_DIR}/${File}")
+  if (NOT EXISTS "${Path}")
+    message(FATAL_ERROR "Missing config file ${Path}")
+  endif ()
+  file(STRINGS "${Path}" Lines LENGTH_MINIMUM 2)
+  if (NOT Lines AND NOT Extra)
+    message(FATAL_ERROR "Config file ${Path} has no entries")
+  endif ()
+
+  set (Out "\n// From configs/${File}${Comment}\n")
+  string(APPEND Out "static constexpr const char *${Array}[] = {\n")
+  foreach (Line IN LISTS Lines)
+    string(REPLACE "\\" "\\\\" Line "${Line}")
+    string(REPLACE "\"" "\\\"" Line "${Line}")
+    string(REPLACE "\t" "\\t" Line "${Line}")
+    string(APPEND Out "\t\"${Line}\",\n")
+  endforeach ()
+  if (Extra)
+    string(APPEND Out "\t${Extra}\n")
+  endif ()
+  string(APPEND Out "};\n")
+  if (Table)
+    string(APPEND Out "static constexpr auto ${Table} = NAME_TABLE(${Array});\n")
+  endif ()
+  set (Header "${Header}${Out}" PARENT_SCOPE)
+endfunction ()
+
+add_config_list(KraceSkipFuncNames krace-skip-funcs KraceSkipFuncTable "" "")
+add_config_list(TestFuncNames test-funcs TestFuncTable "" "")
+add_config_list(AutoFreedFuncNames auto-freed-alloc-funcs AutoFreedFuncTable "" "")
+add_config_list(EscapeFuncNames escape-funcs EscapeFuncTable "" "")
+add_config_list(MemberGetFuncNames member-get-funcs MemberGetFuncTable "" "")
+add_config_list(ErrFuncNamesLinux err-funcs ErrFuncTableLinux
+  ", plus the generic error handling functions" GENERIC_ERR_FUNC_NAMES)
+add_config_list(ErrFuncNamesFreeBSD err-funcs-freebsd ErrFuncTableFreeBSD
+  ", plus the generic error handling functions" GENERIC_ERR_FUNC_NAMES)
+add_config_list(ErrFuncNamesPHP err-funcs-php ErrFuncTablePHP
+  ", plus the generic error handling functions" GENERIC_ERR_FUNC_NAMES)
+add_config_list(RefcountRelatedFuncNames refcount-related-funcs RefcountRelatedFuncTable "" "")
+add_config_list(RefcountIncFuncNames refcount-funcs-inc "" "" "")
+add_config_list(RefcountDecFuncNames refcount-funcs-dec "" "" "")
+add_config_list(PairLeadFuncNames pair-funcs-lead ""
+  ", the i-th lead pairs with the i-th follower" "")
+add_config_list(PairFollowerFuncNames pair-funcs-follower "" "" "")
+
+# Only replace the header when it changes, so an unrelated edit under
+# configs/ does not rebuild every file
+set (Tmp "${OUTPUT}.tmp")
+file(WRITE "${Tmp}" "${Header}")
+execute_process(COMMAND ${CMAKE_COMMAND} -E copy_if_different "${Tmp}" "${OUTPUT}")
+file(REMOVE "${Tmp}")
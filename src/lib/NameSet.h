@@ -0,0 +1,152 @@
+#ifndef _NAME_SET_H
+#define _NAME_SET_H
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/ADT/StringSet.h>
+
+#include <cstdint>
+#include <cstring>
+
+//
+// Name tables built at compile time: open addressing with linear
+// probing over a power-of-two slot array at most half full, keyed by
+// FNV-1a. Lookups take a StringRef and never allocate.
+//
+
+constexpr uint32_t nameHash(const char *S, size_t Len) {
+	uint32_t H = 2166136261u;
+	for (size_t i = 0; i < Len; ++i) {
+		H ^= (unsigned char)S[i];
+		H *= 16777619u;
+	}
+	return H;
+}
+
+constexpr size_t constStrLen(const char *S) {
+	size_t Len = 0;
+	while (S[Len])
+		++Len;
+	return Len;
+}
+
+constexpr bool constStrEqual(const char *A, const char *B) {
+	while (*A && *A == *B) {
+		++A;
+		++B;
+	}
+	return *A == *B;
+}
+
+constexpr size_t nameTableSlots(size_t NumNames) {
+	size_t Slots = 2;
+	while (Slots < NumNames * 2)
+		Slots *= 2;
+	return Slots;
+}
+
+template <size_t NumSlots>
+struct StaticNameTable {
+	const char *Names[NumSlots];
+	uint32_t Lengths[NumSlots];
+	uint32_t Hashes[NumSlots];
+	uint32_t Count;
+};
+
+template <size_t NumSlots, size_t N>
+constexpr StaticNameTable<NumSlots> buildNameTable(const char *const (&Names)[N]) {
+	StaticNameTable<NumSlots> T{};
+	for (size_t i = 0; i < N; ++i) {
+		size_t Len = constStrLen(Names[i]);
+		uint32_t H = nameHash(Names[i], Len);
+		size_t Slot = H & (NumSlots - 1);
+		bool Dup = false;
+		while (T.Names[Slot]) {
+			if (T.Hashes[Slot] == H && constStrEqual(T.Names[Slot], Names[i])) {
+				Dup = true;
+				break;
+			}
+			Slot = (Slot + 1) & (NumSlots - 1);
+		}
+		if (Dup)
+			continue;
+		T.Names[Slot] = Names[i];
+		T.Lengths[Slot] = Len;
+		T.Hashes[Slot] = H;
+		T.Count++;
+	}
+	return T;
+}
+
+// Build the table of a constexpr array of names
+#define NAME_TABLE(Names) \
+	buildNameTable<nameTableSlots(sizeof(Names) / sizeof(Names[0]))>(Names)
+
+//
+// A set of names: a compile-time table of defaults plus the names added
+// at run time (config override files, inferred functions).
+//
+class NameSet {
+
+	public:
+		NameSet() {}
+
+		template <size_t NumSlots>
+		void setDefaults(const StaticNameTable<NumSlots> &T) {
+			Names = T.Names;
+			Lengths = T.Lengths;
+			Hashes = T.Hashes;
+			Mask = NumSlots - 1;
+			NumDefaults = T.Count;
+		}
+
+		// Sets without config overrides or inferred names only probe
+		// the table
+		size_t count(llvm::StringRef Name) const {
+			return inDefaults(Name) || (!Added.empty() && Added.count(Name));
+		}
+
+		// Returns true if Name was not in the set
+		bool insert(llvm::StringRef Name) {
+			if (inDefaults(Name))
+				return false;
+			return Added.insert(Name).second;
+		}
+
+		template <typename IterT>
+		void insert(IterT Begin, IterT End) {
+			for (; Begin != End; ++Begin)
+				insert(*Begin);
+		}
+
+		size_t size() const { return NumDefaults + Added.size(); }
+		bool empty() const { return size() == 0; }
+
+		void clear() {
+			Names = nullptr;
+			NumDefaults = 0;
+			Added.clear();
+		}
+
+	private:
+		bool inDefaults(llvm::StringRef Name) const {
+			if (!Names)
+				return false;
+			uint32_t H = nameHash(Name.data(), Name.size());
+			for (uint32_t Slot = H & Mask; Names[Slot]; Slot = (Slot + 1) & Mask) {
+				if (Hashes[Slot] == H && Lengths[Slot] == Name.size()
+					&& memcmp(Names[Slot], Name.data(), Name.size()) == 0)
+					return true;
+			}
+			return false;
+		}
+
+		const char *const *Names = nullptr;
+		const uint32_t *Lengths = nullptr;
+		const uint32_t *Hashes = nullptr;
+		uint32_t Mask = 0;
+		uint32_t NumDefaults = 0;
+
+		llvm::StringSet<> Added;
+};
+
+#endif
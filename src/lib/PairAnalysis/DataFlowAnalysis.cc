@@ -25,7 +25,7 @@ using namespace llvm;
 
 
 //Find if two criticalvars share the same source
-bool PairAnalysisPass::findCVSource(CriticalVar CVA, CriticalVar CVB){
+bool PairAnalysisPass::findCVSource(const CriticalVar &CVA, const CriticalVar &CVB){
     
     bool result = true;
 
@@ -43,41 +43,31 @@ bool PairAnalysisPass::findCVSource(CriticalVar CVA, CriticalVar CVB){
 
     check_getelementptrInfo:
     
-    //Second make sure the getelementptrInfo is the same (not strict)
+    //Second make sure the getelementptrInfo is the same (not strict):
+    //CVA and CVB share a struct pointer, and every shared struct pointer
+    //has the same indices. Both maps are sorted, walk them together
     if(CVA.getelementptrInfo.size() == 0 && CVB.getelementptrInfo.size() == 0)
         return true;
     
-    set<Value *> eleSet_A, eleSet_B;
-    eleSet_A.clear();
-    eleSet_B.clear();
-    for(auto i = CVA.getelementptrInfo.begin(); i!=CVA.getelementptrInfo.end();i++){
-        Value* CVA_first = i->first;
-        eleSet_A.insert(CVA_first);
-    }
-    for(auto i = CVB.getelementptrInfo.begin(); i!=CVB.getelementptrInfo.end();i++){
-        Value* CVB_first = i->first;
-        eleSet_B.insert(CVB_first);
-    }
-    if(!findCommonOfSet(eleSet_A,eleSet_B))
-        return false;
-
-    bool foundtag = true;
-    for(auto i = CVA.getelementptrInfo.begin(); i!=CVA.getelementptrInfo.end();i++){
-        Value* CVA_first = i->first;
-        if(CVB.getelementptrInfo.count(CVA_first)==0){
-            continue;
-        }
+    bool foundcommon = false;
+    auto i = CVA.getelementptrInfo.begin(), ie = CVA.getelementptrInfo.end();
+    auto j = CVB.getelementptrInfo.begin(), je = CVB.getelementptrInfo.end();
+    while(i != ie && j != je){
+        if(i->first < j->first)
+            ++i;
+        else if(j->first < i->first)
+            ++j;
         else{
-            if(CVA.getelementptrInfo[CVA_first] != CVB.getelementptrInfo[CVA_first]){
-                foundtag = false;
-                break;
-            }
+            if(i->second != j->second)
+                return false;
+            foundcommon = true;
+            ++i;
+            ++j;
         }
     }
-    result = foundtag;
     //Todo: use Alias
 
-    return result;
+    return foundcommon;
 }
 
 //Return true if this value is checked
@@ -249,7 +239,7 @@ void PairAnalysisPass::initPathValueSet(SinglePath singlepath,
 // Find same-origin variables from the given variable
 void PairAnalysisPass::findSameVariablesFrom(Function *F,
         CriticalVar &criticalvar,
-        std::set<CFGEdge>pathedgeset
+        const std::set<CFGEdge> &pathedgeset
         ) {
 
 	//Value* VSource = V;
@@ -350,7 +340,7 @@ void PairAnalysisPass::findSameVariablesFrom(Function *F,
             StringRef FName = getCalledFuncName(CAI);
 
             //Ignore llvm debug funcs
-            if(1 == Ctx->DebugFuncs.count(FName)){
+            if(Ctx->CalleeClasses.get(CAI) & CC_Debug){
                 //OP << "Found a debug funcs: "<<FName<<"\n";
                 continue;
             }
@@ -648,11 +638,14 @@ bool PairAnalysisPass::checkValueEscape(Function *F,
 bool PairAnalysisPass::checkValueRedefine(Function *F,
     Value *cirticalvalue,
     BasicBlock *CommonHead,
-    EdgeIgnoreMap edgeIgnoreMap){
+    const ConnectGraph &connectGraph){
 
     if(!F || !cirticalvalue)
         return false;
 
+    //Out edges of the blocks releasing the value
+    EdgeIgnoreMap releaseEdgeMap;
+
     for(User *U : cirticalvalue->users()){
         if(U == cirticalvalue)
             continue;
@@ -663,7 +656,7 @@ bool PairAnalysisPass::checkValueRedefine(Function *F,
         
         BasicBlock *U_BB = I->getParent();
         Instruction *U_TI = U_BB->getTerminator();
-        if(!checkBlockPairConnectivity(U_BB,CommonHead,edgeIgnoreMap))
+        if(!connectGraph.reaches(U_BB,CommonHead,releaseEdgeMap))
             continue;
         
         CallInst *CAI = dyn_cast<CallInst>(U);
@@ -672,14 +665,14 @@ bool PairAnalysisPass::checkValueRedefine(Function *F,
             if(BB_FName.empty())
                 continue;
 
-            if(Ctx->ReleaseFuncSet.count(BB_FName) || checkStringContainSubString(BB_FName,"free")){
+            if(Ctx->CalleeClasses.get(CAI) & (CC_ReleaseFunc | CC_Free)){
                 if(U_BB == CommonHead)
                     return true;
 
                 for(BasicBlock *Succ : successors(U_TI)){
                     CFGEdge edge = make_pair(U_TI,Succ);
                     pair<CFGEdge,int> value(edge,1);
-                    edgeIgnoreMap.insert(value);
+                    releaseEdgeMap.insert(value);
                 }       
             }
             continue;
@@ -689,7 +682,7 @@ bool PairAnalysisPass::checkValueRedefine(Function *F,
     Instruction *Init = dyn_cast<Instruction>(cirticalvalue);
     if(Init!=NULL){
         BasicBlock *Init_BB = Init->getParent();
-        if(!checkBlockPairConnectivity(Init_BB,CommonHead,edgeIgnoreMap)){
+        if(!connectGraph.reaches(Init_BB,CommonHead,releaseEdgeMap)){
             return true;
         }
     }
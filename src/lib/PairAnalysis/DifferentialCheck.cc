@@ -20,19 +20,73 @@
 #include <omp.h>
 
 #include "PairAnalysis.h"
+#include "../PointerAnalysis.h"
 
 using namespace llvm;
 
-//#define OP in
+//Fill the fields shared by all bug types: path j has the operation, path i misses it
+//Only IR handles are recorded here, the report sink symbolizes them later
+void PairAnalysisPass::initBugReport(BugReport &report, Function *F,
+    PathPairs &pathpairs, int i, int j){
+
+    report.Func = F;
+    auto copies = Ctx->FuncCopies.find(F);
+    if(copies != Ctx->FuncCopies.end())
+        report.FuncCopies = copies->second;
+    report.StartBB = pathpairs.startBlock.BB;
+    report.PathWith = j;
+    report.PathWithout = i;
+    for(auto it = pathpairs.Paths[j].CBChain.begin(); it != pathpairs.Paths[j].CBChain.end();it++)
+        report.PathWithBBs.push_back(it->BB);
+    for(auto it = pathpairs.Paths[i].CBChain.begin(); it != pathpairs.Paths[i].CBChain.end();it++)
+        report.PathWithoutBBs.push_back(it->BB);
+    if(pathpairs.Paths[j].getPathLength() != 0)
+        report.BranchInst = pathpairs.Paths[j].CBChain[0].BB->getTerminator();
+}
+
+//Record the sources of a critical variable in a missing-check report
+void PairAnalysisPass::addCriticalVarDetails(BugReport &report, string prefix, CriticalVar &CV){
+
+    for(auto i = CV.sourceset.begin(); i != CV.sourceset.end(); i++){
+        BugReportDetail detail;
+        detail.Label = prefix + "Source";
+        detail.LineInst = dyn_cast<Instruction>(*i);
+        detail.V = *i;
+        report.RawDetails.push_back(detail);
+    }
+    for(auto i = CV.sourcefuncs.begin(); i != CV.sourcefuncs.end(); i++){
+        BugReportDetail detail;
+        detail.Label = prefix + "SourceFunc";
+        detail.Text = *i;
+        report.RawDetails.push_back(detail);
+    }
+    for(auto i = CV.getelementptrInfo.begin(); i != CV.getelementptrInfo.end(); i++){
+        for(auto j = i->second.begin(); j!=i->second.end();j++){
+            BugReportDetail detail;
+            detail.Label = prefix + "GEPSource";
+            detail.V = i->first;
+            detail.From = *j;
+            report.RawDetails.push_back(detail);
+        }
+    }
+}
 
-int GlobalBugNum = 0;
+//Record a detail line "label(line): value" for a missing-check report
+static void addInstDetail(BugReport &report, string label, Value *V){
+    BugReportDetail detail;
+    detail.Label = label;
+    detail.LineInst = dyn_cast<Instruction>(V);
+    detail.V = V;
+    report.RawDetails.push_back(detail);
+}
 
 
 //Execute object based similar path analysis against path pairs in PathGroup
 //There will be other checks in the future
 void PairAnalysisPass::similarPathAnalysis(Function *F,
     std::vector<PathPairs> &PathGroup,
-    ConnectGraph connectGraph,
+    const ConnectGraph &connectGraph,
+    PathFactCache &factCache,
     map<Value*,EdgeIgnoreMap> edgeIgnoreMap_init,
     EdgeIgnoreMap edgeIgnoreMap,
     bool in_err_paths){
@@ -42,76 +96,94 @@ void PairAnalysisPass::similarPathAnalysis(Function *F,
     
     for(auto i = PathGroup.begin(); i != PathGroup.end(); i++){
         PathPairs curpathpair = *i;
-        similarPathAnalysis_singlePathpair(F,curpathpair,connectGraph,edgeIgnoreMap_init,edgeIgnoreMap,in_err_paths);
+        similarPathAnalysis_singlePathpair(F,curpathpair,connectGraph,factCache,edgeIgnoreMap_init,edgeIgnoreMap,in_err_paths);
     }
 }
 
-void PairAnalysisPass::initPairFuncCallSet(set<Value *> pathvalueset,
-    set<Value *> &pairfunccallset,
-    set<Value *> GlobalPairFuncSet){
+void PairAnalysisPass::initPathFactCache(Function *F, PathFactCache &factCache){
 
-    pairfunccallset.clear();
-    
-    if(pathvalueset.empty())
-        return;
-    
-    for(auto it = pathvalueset.begin(); it != pathvalueset.end();it++){
+    factCache.FA = Ctx->FuncAnalyses.get(F);
+    factCache.blockFacts.clear();
+    factCache.SOBranchSet.clear();
+    for(auto it = Ctx->SecurityOperationSets[F].begin(); it != Ctx->SecurityOperationSets[F].end();it++)
+        factCache.SOBranchSet.insert(it->branch);
+    initGlobalPairFuncSet(F, factCache.GlobalPairFuncSet);
+    initGlobalRefcountFuncSet(F, factCache.GlobalRefCountFuncSet);
+    initGlobalUnlockFuncSet(F, factCache.GlobalLockFuncSet, factCache.GlobalUnlockFuncSet);
+}
 
-        CallInst *CAI = dyn_cast<CallInst>(*it);
-        if(CAI){
-            if(1 == GlobalPairFuncSet.count(*it)){
-                pairfunccallset.insert(*it);
-            }
-        }
+//Find the security operations and value sources of the instructions in BB
+void PairAnalysisPass::collectBlockFacts(Function *F, BasicBlock *BB,
+    const set<CFGEdge> &pathedgeSet,
+    PathFactCache &factCache,
+    PathBlockFacts &facts){
+
+    const BlockSummary &summary = factCache.FA->getBlockSummary(BB);
+    for(CallInst *CAI : summary.CallInsts){
+        if(factCache.GlobalPairFuncSet.count(CAI))
+            facts.pairfunccalls.push_back(CAI);
+        if(factCache.GlobalRefCountFuncSet.count(CAI))
+            facts.refcountfunccalls.push_back(CAI);
+        if(factCache.GlobalLockFuncSet.count(CAI))
+            facts.lockfunccalls.push_back(CAI);
+        if(factCache.GlobalUnlockFuncSet.count(CAI))
+            facts.unlockfunccalls.push_back(CAI);
     }
-}
 
-void PairAnalysisPass::initRefcountFuncCallSet(set<Value *> pathvalueset,
-    set<Value *> &refcountfunccallset,
-    set<Value *> GlobalRefCountFuncSet){
-    
-    refcountfunccallset.clear();
+    for(BasicBlock::iterator i = BB->begin(); i != BB->end(); i++){
 
-    if(pathvalueset.empty())
-        return;
-    
-    for(auto it = pathvalueset.begin(); it != pathvalueset.end();it++){
+        CriticalVar CV;
 
-        CallInst *CAI = dyn_cast<CallInst>(*it);
-        if(CAI){
-            if(1 == GlobalRefCountFuncSet.count(*it)){
-                refcountfunccallset.insert(*it);
-            }
-        }
-    }
-}
+        CV.resource_release_inst = &*i;
+        CV.inst = &*i;
 
-void PairAnalysisPass::initUnlockFuncCallSet(set<Value *> pathvalueset,
-    set<Value *> &lockfunccallset,
-    set<Value *> &unlockfunccallset,
-    set<Value *> GlobalLockFuncSet,
-    set<Value *> GlobalUnlockFuncSet){
-    
-    unlockfunccallset.clear();
+        //Find source of all values
+        findSameVariablesFrom(F,CV,pathedgeSet);
 
-    if(pathvalueset.empty())
-        return;
-    
-    for(auto it = pathvalueset.begin(); it != pathvalueset.end();it++){
+        facts.normalvars.push_back(CV);
+
+        //Only the instruction of a security operation can match one,
+        //as CV.inst changes after a match
+        if(!factCache.SOBranchSet.count(CV.inst))
+            continue;
+
+        //Find security operations in current path
+        for(auto i = Ctx->SecurityOperationSets[F].begin();i!=Ctx->SecurityOperationSets[F].end();i++){
+            SecurityOperation SO = *i;
+            Value* SOBranch = SO.branch; //first
+            Value* SOCheckedValue = SO.checkedValue; //second
+            int operationType = SO.operationType;
+
+            //Find resource release
+            if(CV.resource_release_inst == SOBranch){
 
-        CallInst *CAI = dyn_cast<CallInst>(*it);
-        if(CAI){
+                CV.SOType = operationType;
 
-            if(1 == GlobalUnlockFuncSet.count(*it)){
-                unlockfunccallset.insert(*it);
+                if(operationType == ResourceRelease){
+                    CV.inst = SOCheckedValue;
+                    facts.resourcereleases.push_back(CV);
+                }
             }
 
-            if(1 == GlobalLockFuncSet.count(*it)){
-                lockfunccallset.insert(*it);
+            //Find initialization
+            if(operationType == Initialization){
+                if(CV.inst == SOBranch){
+                    CV.SOType = operationType;
+                    CV.check = SOCheckedValue; // The inited value
+                    facts.initoperations.push_back(CV);
+                }
             }
-        }
-    }
 
+            if(operationType == Securitycheck){
+                if(CV.inst == SOBranch){
+                    CV.SOType = operationType;
+                    CV.check = SOCheckedValue; // The checked value
+                    facts.criticalvars.push_back(CV);
+                }
+            }
+
+        }//End find security operation
+    }
 }
 
 void PairAnalysisPass::initGlobalPairFuncSet(Function *F, 
@@ -281,7 +353,8 @@ void PairAnalysisPass::initEdgeIgnoreMap_Init(Function *F,
 
 //This function works on a path pair
 void PairAnalysisPass::similarPathAnalysis_singlePathpair(Function *F, 
-    PathPairs pathpairs, ConnectGraph connectGraph,
+    PathPairs pathpairs, const ConnectGraph &connectGraph,
+    PathFactCache &factCache,
     map<Value*,EdgeIgnoreMap> edgeIgnoreMap_init,
     EdgeIgnoreMap edgeIgnoreMap,
     bool in_err_paths){
@@ -312,14 +385,6 @@ void PairAnalysisPass::similarPathAnalysis_singlePathpair(Function *F,
     vector<set<Value *>>pathvalueset_vector;
     pathvalueset_vector.clear();
 
-    set<Value *> GlobalPairFuncSet;
-    initGlobalPairFuncSet(F, GlobalPairFuncSet);
-    set<Value *> GlobalRefCountFuncSet;
-    initGlobalRefcountFuncSet(F, GlobalRefCountFuncSet);
-    set<Value *> GlobalLockFuncSet;
-    set<Value *> GlobalUnlockFuncSet;
-    initGlobalUnlockFuncSet(F,GlobalLockFuncSet,GlobalUnlockFuncSet);
-
     //Travel all singlepaths in a pathpair
     //Check if security checks are in one path pair
     long int testnum = 0;
@@ -341,12 +406,9 @@ void PairAnalysisPass::similarPathAnalysis_singlePathpair(Function *F,
         initoperationset.clear();
 
         set<Value *> pairfunccallset;
-        initPairFuncCallSet(pathvalueset,pairfunccallset,GlobalPairFuncSet);
         set<Value *> refcountfunccallset;
-        initRefcountFuncCallSet(pathvalueset,refcountfunccallset,GlobalRefCountFuncSet);
         set<Value *> unlockfunccallset;
         set<Value *> lockfunccallset;
-        initUnlockFuncCallSet(pathvalueset,lockfunccallset,unlockfunccallset,GlobalLockFuncSet,GlobalUnlockFuncSet);
 
         set<Value *> refcountset;
         
@@ -368,64 +430,41 @@ void PairAnalysisPass::similarPathAnalysis_singlePathpair(Function *F,
 
         }
 
-        for(auto j = singlepath.CBChain.begin(); j != singlepath.CBChain.end();j++){
-            CompoundBlock CBB = *j;
-            BasicBlock* BB = CBB.BB;
-
-            //Collect all instructions of current path
-            for(BasicBlock::iterator i = BB->begin(); i != BB->end(); i++){
-
-                auto midinst = dyn_cast<Instruction>(i);
-
-                CriticalVar CV;
-
-                CV.resource_release_inst = &*i;
-                CV.inst = &*i;
-
-                //Find source of all values
-                findSameVariablesFrom(F,CV,pathedgeSet);
-
-                normalvarset.insert(CV);
-
-                //Find security operations in current path
-                for(auto i = Ctx->SecurityOperationSets[F].begin();i!=Ctx->SecurityOperationSets[F].end();i++){
-                    SecurityOperation SO = *i;
-                    Value* SOBranch = SO.branch; //first
-                    Value* SOCheckedValue = SO.checkedValue; //second
-                    int operationType = SO.operationType;
-
-                    //auto I = dyn_cast<Instruction>(SOBranch);
-                    //Find resource release
-                    if(CV.resource_release_inst == SOBranch){
-
-                        CV.SOType = operationType;
-
-                        if(operationType == ResourceRelease){
-                            //OP << "Found inside\n";
-                            CV.inst = SOCheckedValue;
-                            resourcereleaseset.insert(CV);
-                        }
-                    }
-
-                    //Find initialization
-                    if(operationType == Initialization){
-                        if(CV.inst == SOBranch){
-                            CV.SOType = operationType;
-                            CV.check = SOCheckedValue; // The inited value
-                            initoperationset.insert(CV);
-                        }
-                    }
-
-                    if(operationType == Securitycheck){
-                        if(CV.inst == SOBranch){
-                            CV.SOType = operationType;
-                            CV.check = SOCheckedValue; // The checked value
-                            criticalvarset.insert(CV);
-                        }
-                    }
+        //Phi sources only follow self-loop edges of the path, so paths
+        //without one share the facts of their blocks
+        bool sharedfacts = true;
+        for(auto it = pathedgeSet.begin(); it != pathedgeSet.end(); it++){
+            if(it->first->getParent() == it->second){
+                sharedfacts = false;
+                break;
+            }
+        }
 
-                }//End find security operation
+        for(auto j = singlepath.CBChain.begin(); j != singlepath.CBChain.end();j++){
+            BasicBlock* BB = j->BB;
+
+            PathBlockFacts pathfacts;
+            PathBlockFacts *facts = &pathfacts;
+            if(sharedfacts){
+                auto it = factCache.blockFacts.find(BB);
+                if(it == factCache.blockFacts.end()){
+                    it = factCache.blockFacts.insert(make_pair(BB, PathBlockFacts())).first;
+                    collectBlockFacts(F,BB,set<CFGEdge>(),factCache,it->second);
+                }
+                facts = &it->second;
             }
+            else{
+                collectBlockFacts(F,BB,pathedgeSet,factCache,pathfacts);
+            }
+
+            normalvarset.insert(facts->normalvars.begin(),facts->normalvars.end());
+            criticalvarset.insert(facts->criticalvars.begin(),facts->criticalvars.end());
+            resourcereleaseset.insert(facts->resourcereleases.begin(),facts->resourcereleases.end());
+            initoperationset.insert(facts->initoperations.begin(),facts->initoperations.end());
+            pairfunccallset.insert(facts->pairfunccalls.begin(),facts->pairfunccalls.end());
+            refcountfunccallset.insert(facts->refcountfunccalls.begin(),facts->refcountfunccalls.end());
+            lockfunccallset.insert(facts->lockfunccalls.begin(),facts->lockfunccalls.end());
+            unlockfunccallset.insert(facts->unlockfunccalls.begin(),facts->unlockfunccalls.end());
         }
 
         //Collect all values for each paths
@@ -485,22 +524,22 @@ void PairAnalysisPass::similarPathAnalysis_singlePathpair(Function *F,
             //if(!in_err_paths)
             //    continue;
 
-            differentialCheck_ResourceRelease(F,pathpairs,i,j,resourcereleasefuncpairarr,pathpairnormalarr,edgeIgnoreMap,reportSet);
-            differentialCheck_ResourceRelease(F,pathpairs,j,i,resourcereleasefuncpairarr,pathpairnormalarr,edgeIgnoreMap,reportSet);
+            differentialCheck_ResourceRelease(F,pathpairs,i,j,resourcereleasefuncpairarr,pathpairnormalarr,connectGraph,reportSet);
+            differentialCheck_ResourceRelease(F,pathpairs,j,i,resourcereleasefuncpairarr,pathpairnormalarr,connectGraph,reportSet);
 
         }
     }
 }
 
 //Consider use chain, check if CV shows in VS set
-bool PairAnalysisPass::findCommonPairFunc(set<Value *> VS, Value* CV, BasicBlock* CommonHead){
+bool PairAnalysisPass::findCommonPairFunc(const set<Value *> &VS, Value* CV, BasicBlock* CommonHead){
     
     if(!CV || VS.empty())
         return false;
     
     CallInst *CAI_CV = dyn_cast<CallInst>(CV);
     StringRef CVFName = getCalledFuncName(CAI_CV);
-    auto CV_Peerfunc_Name_set = Ctx->PairFuncs[CVFName];
+    const set<string> &CV_Peerfunc_Name_set = getPeerFuncNames(Ctx->PairFuncs, CVFName);
 
     for(auto i = VS.begin(); i != VS.end(); i++){
         CallInst *CAI_VS = dyn_cast<CallInst>(*i);
@@ -523,7 +562,7 @@ bool PairAnalysisPass::findCommonPairFunc(set<Value *> VS, Value* CV, BasicBlock
             return true;
         }
         
-        auto VS_Peerfunc_Name_set = Ctx->PairFuncs[FName];
+        const set<string> &VS_Peerfunc_Name_set = getPeerFuncNames(Ctx->PairFuncs, FName);
         if(findCommonOfSet(VS_Peerfunc_Name_set,CV_Peerfunc_Name_set)){
 
             if(CommonHead == NULL)
@@ -545,14 +584,14 @@ bool PairAnalysisPass::findCommonPairFunc(set<Value *> VS, Value* CV, BasicBlock
     return false;
 }
 
-bool PairAnalysisPass::findCommonRefcountFunc(set<Value *> VS, Value* CV){
+bool PairAnalysisPass::findCommonRefcountFunc(const set<Value *> &VS, Value* CV){
     if(!CV || VS.empty())
         return false;
     
     CallInst *CAI_CV = dyn_cast<CallInst>(CV);
     //Function *CF = CAI->getCalledFunction();
     StringRef CVFName = getCalledFuncName(CAI_CV);
-    auto CV_Peerfunc_Name_set = Ctx->RefcountFuncs[CVFName];
+    const set<string> &CV_Peerfunc_Name_set = getPeerFuncNames(Ctx->RefcountFuncs, CVFName);
 
     for(auto i = VS.begin(); i != VS.end(); i++){
         CallInst *CAI_VS = dyn_cast<CallInst>(*i);
@@ -562,7 +601,7 @@ bool PairAnalysisPass::findCommonRefcountFunc(set<Value *> VS, Value* CV){
             return true;
         }
 
-        auto VS_Peerfunc_Name_set = Ctx->RefcountFuncs[FName];
+        const set<string> &VS_Peerfunc_Name_set = getPeerFuncNames(Ctx->RefcountFuncs, FName);
         if(findCommonOfSet(VS_Peerfunc_Name_set,CV_Peerfunc_Name_set)){
             return true;
         }
@@ -571,7 +610,7 @@ bool PairAnalysisPass::findCommonRefcountFunc(set<Value *> VS, Value* CV){
     return false;
 }
 
-bool PairAnalysisPass::findCommonUnlockFunc(set<Value *> VS, Value* CV){
+bool PairAnalysisPass::findCommonUnlockFunc(const set<Value *> &VS, Value* CV){
     if(!CV || VS.empty())
         return false;
     
@@ -596,7 +635,7 @@ bool PairAnalysisPass::findCommonUnlockFunc(set<Value *> VS, Value* CV){
 //Check if the function pair only shows in path CV
 //If both pair funcs are shown in only one path, then this is not a bug
 //Return true if there is a real bug
-bool checkPairFuncUse(string CV_Peerfunc_Name, set<Value *> CVPath, set<Value *> HeadValues){
+bool checkPairFuncUse(const string &CV_Peerfunc_Name, const set<Value *> &CVPath, const set<Value *> &HeadValues){
     
     if(CV_Peerfunc_Name.size()==0 || CVPath.empty())
         return false;
@@ -716,10 +755,10 @@ bool PairAnalysisPass::checkFuncFailinIf(Value* funccall,
 
 
 void PairAnalysisPass::differentialCheck_Unlock(Function *F,
-    PathPairs pathpairs,
+    PathPairs &pathpairs,
     int i, int j,
-    map<int, set<Value *>> pathpairlockarr,
-    map<int, set<Value *>> pathpairunlockarr,
+    map<int, set<Value *>> &pathpairlockarr,
+    map<int, set<Value *>> &pathpairunlockarr,
     set<string> &reportSet){
 
     if(!F)
@@ -731,9 +770,6 @@ void PairAnalysisPass::differentialCheck_Unlock(Function *F,
     if(pathpairunlockarr[i].empty() && pathpairunlockarr[j].empty())
         return;
     
-    ofstream in;
-    in.open("BugReports.txt",ios::app);
-
     //check if unlock in path j does not show in path i
     for(auto k=pathpairunlockarr[j].begin();k!=pathpairunlockarr[j].end();k++){
         
@@ -807,53 +843,26 @@ void PairAnalysisPass::differentialCheck_Unlock(Function *F,
                 continue;
 
             //Report a bug
-            OP<<"\n=============================\n";
-            printf("\033[31mWarning: find a potential bug:\033[0m\n");
-            OP << "Global Bug num:" << GlobalBugNum++ <<"\n";
-            string topfuncname = F->getName();
-            OP << "File name: "<<getInstFilename(dyn_cast<Instruction>(unlockcall))<<"\n";
-            
-            OP << "Function: "<< topfuncname <<"\n";
-            OP << "Bug Type: "<< "Missing unlock bug"<<"\n";
-            OP << "-----------------------------\n";
-            OP << "Current path pair start at block-"<<getBlockName(pathpairs.startBlock.BB)<<"\n";
-            OP << "Refcount function is shown in path \'"<< j <<"\' but not in path \'"<<i<<"\'\n";
-            OP << "--Path "<< j <<": ";
-            //printSinglePath(pathpairs.Paths[j]);
-            OP << " ";
-            for(auto it = pathpairs.Paths[j].CBChain.begin(); it != pathpairs.Paths[j].CBChain.end();it++){
-                CompoundBlock CBB = *it;
-                BasicBlock* BB = CBB.BB;
-                OP << "Block-"<<getBlockName(BB)<<" ";
-            }
-            OP << "\n";
-            
-            OP << "--Path "<< i <<": ";
-            //printSinglePath(pathpairs.Paths[i]);
-            OP << " ";
-            for(auto it = pathpairs.Paths[i].CBChain.begin(); it != pathpairs.Paths[i].CBChain.end();it++){
-                CompoundBlock CBB = *it;
-                BasicBlock* BB = CBB.BB;
-                OP << "Block-"<<getBlockName(BB)<<" ";
-            }
-            OP << "\n";
-            
-            OP << "--Branch from line "<<getBranchLineNo(pathpairs.Paths[j])<<"\n";
-            OP << "-----------------------------\n";
-            OP << "Unlock Func("<<getInstLineNo(dyn_cast<Instruction>(unlockcall)) <<"): " << getValueContent(CV_CAI) <<"\n";
-            OP<<"=============================\n";
+            BugReport report;
+            initBugReport(report, F, pathpairs, i, j);
+            report.FileInst = dyn_cast<Instruction>(unlockcall);
+            report.BugType = "Missing unlock bug";
+            report.Description = "Unlock function is shown in path \'" + to_string(j) + "\' but not in path \'" + to_string(i) + "\'";
+            report.OperationKind = "Unlock Func";
+            report.OperationInst = dyn_cast<Instruction>(unlockcall);
+            report.OperationValue = CV_CAI;
+            Ctx->BugReports.submit(std::move(report));
             Ctx->NumBugs++;
-            reportSet.insert(topfuncname);
+            reportSet.insert(F->getName());
 
         }
     }
-    in.close();
 }
 
 void PairAnalysisPass::differentialCheck_Refcount(Function *F,
-    PathPairs pathpairs,
+    PathPairs &pathpairs,
     int i, int j,
-    map<int, set<Value *>> pathpairfuncpairarr,
+    map<int, set<Value *>> &pathpairfuncpairarr,
     set<string> &reportSet){
 
     if(!F)
@@ -865,9 +874,6 @@ void PairAnalysisPass::differentialCheck_Refcount(Function *F,
     if(pathpairfuncpairarr[i].empty() && pathpairfuncpairarr[j].empty())
         return;
 
-    ofstream in;
-    in.open("BugReports.txt",ios::app);
-
     //check if pair func in path j does not show in path i
     for(auto k=pathpairfuncpairarr[j].begin();k!=pathpairfuncpairarr[j].end();k++){
 
@@ -878,7 +884,7 @@ void PairAnalysisPass::differentialCheck_Refcount(Function *F,
         //Check if pair funcs in path j occur in path i
         if(!findCommonRefcountFunc(pathpairfuncpairarr[i],pairfunccall)){
 
-            auto CV_Peerfunc_Name_set = Ctx->RefcountFuncs[CV_FName];
+            const set<string> &CV_Peerfunc_Name_set = getPeerFuncNames(Ctx->RefcountFuncs, CV_FName);
             bool findtag;
 
             //检测是否一对pair function都仅仅在一条路径（path j）出现
@@ -912,8 +918,7 @@ void PairAnalysisPass::differentialCheck_Refcount(Function *F,
 
 				    CallInst *CAI = dyn_cast<CallInst>(&*I);
                     if(CAI){
-                        StringRef FName = getCalledFuncName(CAI);
-                        if(Ctx->RefcountRelatedFuncs.count(FName) == 1)
+                        if(Ctx->CalleeClasses.get(CAI) & CC_RefcountRelated)
                             findtag = false;
                     }
                 }
@@ -928,58 +933,29 @@ void PairAnalysisPass::differentialCheck_Refcount(Function *F,
                 continue;
 
             //Report a bug
-            OP<<"\n=============================\n";
-            printf("\033[31mWarning: find a potential bug:\033[0m\n");
-            OP << "Global Bug num:" << GlobalBugNum++ <<"\n";
-            string topfuncname = F->getName();
-            //OP << "F: "<<*F<<"\n";
-            OP << "File name: "<<getInstFilename(dyn_cast<Instruction>(pairfunccall))<<"\n";
-            //OP << "File name: "<<getSourceFuncName(dyn_cast<Instruction>(pairfunccall))<<"\n";
-            
-            OP << "Function: "<< topfuncname <<"\n";
-            OP << "Bug Type: "<< "Refcount bug"<<"\n";
-            OP << "-----------------------------\n";
-            OP << "Current path pair start at block-"<<getBlockName(pathpairs.startBlock.BB)<<"\n";
-            OP << "Refcount function is shown in path \'"<< j <<"\' but not in path \'"<<i<<"\'\n";
-            OP << "--Path "<< j <<": ";
-            //printSinglePath(pathpairs.Paths[j]);
-            OP << " ";
-            for(auto it = pathpairs.Paths[j].CBChain.begin(); it != pathpairs.Paths[j].CBChain.end();it++){
-                CompoundBlock CBB = *it;
-                BasicBlock* BB = CBB.BB;
-                OP << "Block-"<<getBlockName(BB)<<" ";
-            }
-            OP << "\n";
-            
-            OP << "--Path "<< i <<": ";
-            //printSinglePath(pathpairs.Paths[i]);
-            OP << " ";
-            for(auto it = pathpairs.Paths[i].CBChain.begin(); it != pathpairs.Paths[i].CBChain.end();it++){
-                CompoundBlock CBB = *it;
-                BasicBlock* BB = CBB.BB;
-                OP << "Block-"<<getBlockName(BB)<<" ";
-            }
-            OP << "\n";
-            
-            OP << "--Branch from line "<<getBranchLineNo(pathpairs.Paths[j])<<"\n";
-            OP << "-----------------------------\n";
-            OP << "Refcount Func("<<getInstLineNo(dyn_cast<Instruction>(pairfunccall)) <<"): " << string(CV_FName) <<"\n";
-            OP<<"=============================\n";
+            BugReport report;
+            initBugReport(report, F, pathpairs, i, j);
+            report.FileInst = dyn_cast<Instruction>(pairfunccall);
+            report.BugType = "Refcount bug";
+            report.Description = "Refcount function is shown in path \'" + to_string(j) + "\' but not in path \'" + to_string(i) + "\'";
+            report.OperationKind = "Refcount Func";
+            report.OperationInst = dyn_cast<Instruction>(pairfunccall);
+            report.Operation = CV_FName;
+            Ctx->BugReports.submit(std::move(report));
             Ctx->NumBugs++;
-            reportSet.insert(topfuncname);
+            reportSet.insert(F->getName());
         }
 
     }//end check
 
-    in.close();
 }
 
 void PairAnalysisPass::differentialCheck_ResourceRelease(Function *F,
-    PathPairs pathpairs,
+    PathPairs &pathpairs,
     int i, int j,
-    map<int, set<CriticalVar>> resourcereleasefuncpairarr,
-    std::map<int, set<CriticalVar>> pathpairnormalarr,
-    EdgeIgnoreMap edgeIgnoreMap,
+    map<int, set<CriticalVar>> &resourcereleasefuncpairarr,
+    std::map<int, set<CriticalVar>> &pathpairnormalarr,
+    const ConnectGraph &connectGraph,
     set<string> &reportSet){
 
     if(!F)
@@ -992,8 +968,7 @@ void PairAnalysisPass::differentialCheck_ResourceRelease(Function *F,
         return;
     }
 
-    ofstream in;
-    in.open("BugReports.txt",ios::app);
+    std::shared_ptr<FunctionAnalyses> FA;
 
     //Check if pair funcs in path j occur in path i
     for(auto k=resourcereleasefuncpairarr[j].begin();k!=resourcereleasefuncpairarr[j].end();k++){
@@ -1020,7 +995,11 @@ void PairAnalysisPass::differentialCheck_ResourceRelease(Function *F,
         }
 
         bool foundtag = false;
-        PointerAnalysisMap structRelations = Ctx->FuncStructResults[F];
+
+        //Struct relations are computed the first time F gets here
+        if(!FA)
+            FA = Ctx->FuncAnalyses.get(F);
+        const PointerAnalysisMap &structRelations = Ctx->PointerAnalysis->getStructRelations(*FA);
 
         for(auto q = resourcereleasefuncpairarr[i].begin();q!=resourcereleasefuncpairarr[i].end();q++){
             CriticalVar CV_q = *q;
@@ -1037,8 +1016,9 @@ void PairAnalysisPass::differentialCheck_ResourceRelease(Function *F,
                 break;
             }
 
-            if(structRelations.count(cirticalvalue_q)){
-                if(structRelations[cirticalvalue_q].count(cirticalvalue)){
+            auto rel = structRelations.find(cirticalvalue_q);
+            if(rel != structRelations.end()){
+                if(rel->second.count(cirticalvalue)){
                     foundtag = true;
                     break;
                 }
@@ -1092,8 +1072,7 @@ void PairAnalysisPass::differentialCheck_ResourceRelease(Function *F,
 
             CallInst *CAI = dyn_cast<CallInst>(TV);
             if(CAI){
-                StringRef calledFName = getCalledFuncName(CAI);
-                if(Ctx->EscapeFuncs.count(calledFName)){
+                if(Ctx->CalleeClasses.get(CAI) & CC_Escape){
                     foundtag = true;
                     break;
                 }
@@ -1105,7 +1084,7 @@ void PairAnalysisPass::differentialCheck_ResourceRelease(Function *F,
                 Value* vop = STI->getValueOperand();
                 auto call = dyn_cast<Function>(vop);
                 if(call){
-                    if(call->getName().contains("free") || call->getName().contains("release")){
+                    if(Ctx->CalleeClasses.get(call) & CC_AnyFree){
                         foundtag = true;
                         break;
                     }
@@ -1138,12 +1117,12 @@ void PairAnalysisPass::differentialCheck_ResourceRelease(Function *F,
         Instruction *resource_acq = dyn_cast<Instruction>(cirticalvalue);
         if(resource_acq != NULL){
             BasicBlock *resource_acq_bb = resource_acq->getParent();
-            if(!checkBlockPairConnectivity(resource_acq_bb,CommonHead,edgeIgnoreMap)){
+            if(!connectGraph.reaches(resource_acq_bb,CommonHead)){
                 continue;
             }
         }  
 
-        if(checkValueRedefine(F,cirticalvalue,CommonHead,edgeIgnoreMap))
+        if(checkValueRedefine(F,cirticalvalue,CommonHead,connectGraph))
             continue;
 
         //Check value escape to F's arguments
@@ -1171,28 +1150,26 @@ void PairAnalysisPass::differentialCheck_ResourceRelease(Function *F,
             if(BB == CommonHead)
                 continue;
             //OP << "Block-"<<getBlockName(BB)<<"\n";
-            for(BasicBlock::iterator i = BB->begin(); i != BB->end(); i++){
-                CallInst * CAI = dyn_cast<CallInst>(i);
-                if(CAI){
+            for(CallInst *CAI : FA->getBlockSummary(BB).CallInsts){
 
-                    StringRef BB_FName = getCalledFuncName(CAI);
-                    if(BB_FName.empty())
-                        continue;
+                StringRef BB_FName = getCalledFuncName(CAI);
+                if(BB_FName.empty())
+                    continue;
 
-                    if(Ctx->ReleaseFuncSet.count(BB_FName) || checkStringContainSubString(BB_FName,"free")){
-                        if(checkValidCaller(cirticalvalue,CAI)){
-                            foundtag = true;
-                            break;
-                        }
+                if(Ctx->CalleeClasses.get(CAI) & (CC_ReleaseFunc | CC_Free)){
+                    if(checkValidCaller(cirticalvalue,CAI)){
+                        foundtag = true;
+                        break;
+                    }
 
-                        unsigned argnum = CAI->getNumArgOperands();
-                        for(unsigned j=0;j<argnum;j++){
-                            Value* arg = CAI->getArgOperand(j);
-                            if(structRelations.count(arg)){
-                                if(structRelations[arg].count(cirticalvalue)){
-                                    foundtag = true;
-                                    break;
-                                }
+                    unsigned argnum = CAI->getNumArgOperands();
+                    for(unsigned j=0;j<argnum;j++){
+                        Value* arg = CAI->getArgOperand(j);
+                        auto rel = structRelations.find(arg);
+                        if(rel != structRelations.end()){
+                            if(rel->second.count(cirticalvalue)){
+                                foundtag = true;
+                                break;
                             }
                         }
                     }
@@ -1206,54 +1183,29 @@ void PairAnalysisPass::differentialCheck_ResourceRelease(Function *F,
             continue;
         
         //Report a bug
-        OP<<"\n=============================\n";
-        printf("\033[31mWarning: find a potential bug:\033[0m\n");
-        OP << "Global Bug num:" << GlobalBugNum++ <<"\n";
-        string topfuncname = F->getName();
-        OP << "File name: "<<getInstFilename(dyn_cast<Instruction>(releaseoperation))<<"\n";
-            
-        OP << "Function: "<< topfuncname <<"\n";
-        OP << "Bug Type: "<< "Missing release"<<"\n";
-        OP << "-----------------------------\n";
-        OP << "Current path pair start at block-"<<getBlockName(pathpairs.startBlock.BB)<<"\n";
-        OP << "Release function is shown in path \'"<< j <<"\' but not in path \'"<<i<<"\'\n";
-        OP << "--Path "<< j <<": ";
-        OP << " ";
-        for(auto it = pathpairs.Paths[j].CBChain.begin(); it != pathpairs.Paths[j].CBChain.end();it++){
-            CompoundBlock CBB = *it;
-            BasicBlock* BB = CBB.BB;
-            OP << "Block-"<<getBlockName(BB)<<" ";
-        }
-        OP << "\n";
-        OP << "--Path "<< i <<": ";
-        OP << " ";
-        for(auto it = pathpairs.Paths[i].CBChain.begin(); it != pathpairs.Paths[i].CBChain.end();it++){
-            CompoundBlock CBB = *it;
-            BasicBlock* BB = CBB.BB;
-            OP << "Block-"<<getBlockName(BB)<<" ";
-        }
-        OP << "\n";
-        OP << "--Branch from line "<<getBranchLineNo(pathpairs.Paths[j])<<"\n";
-        OP << "-----------------------------\n";
-        OP << "Target value: "<< getValueContent(cirticalvalue) <<"\n";
-        //OP << "Alloc point:  "<< getValueContent(getoperation)<<"\n";
-        OP << "Release Func("<<getInstLineNo(dyn_cast<Instruction>(releaseoperation)) <<"): " << string(CV_FName) <<"\n";
-        //OP << "Critical value: "<< *cirticalvalue <<"\n";
-        OP<<"=============================\n";
+        BugReport report;
+        initBugReport(report, F, pathpairs, i, j);
+        report.FileInst = dyn_cast<Instruction>(releaseoperation);
+        report.BugType = "Missing release";
+        report.Description = "Release function is shown in path \'" + to_string(j) + "\' but not in path \'" + to_string(i) + "\'";
+        report.Target = cirticalvalue;
+        report.OperationKind = "Release Func";
+        report.OperationInst = dyn_cast<Instruction>(releaseoperation);
+        report.Operation = CV_FName;
+        Ctx->BugReports.submit(std::move(report));
         Ctx->NumBugs++;
-        reportSet.insert(topfuncname);
+        reportSet.insert(F->getName());
     }
 
-    in.close();
 }
 
 //Used in similarPathAnalysis_singlePathpair
 void PairAnalysisPass::differentialCheck_SecurityCheck(Function *F,
-    PathPairs pathpairs,
+    PathPairs &pathpairs,
     int i, int j,
-    vector<set<Value *>>pathvalueset_vector,
-    map<int, set<CriticalVar>> pathpaircriticalarr,
-    map<int, set<CriticalVar>> pathpairnormalarr,
+    vector<set<Value *>> &pathvalueset_vector,
+    map<int, set<CriticalVar>> &pathpaircriticalarr,
+    map<int, set<CriticalVar>> &pathpairnormalarr,
     set<string> &reportSet){
     
     if(!F)
@@ -1266,9 +1218,6 @@ void PairAnalysisPass::differentialCheck_SecurityCheck(Function *F,
         return;
     }
 
-    ofstream in;
-    in.open("BugReports.txt",ios::app);
-
     set<Value *>normalvalues_of_path_i;
     set<Value *>normalvalues_of_path_j;
     normalvalues_of_path_i.clear();
@@ -1394,86 +1343,27 @@ void PairAnalysisPass::differentialCheck_SecurityCheck(Function *F,
                 //if(0 == pathpaircriticalarr[i].count(CV_normal)){
                 if(!foundtag){
 
-                    OP<<"\n=============================\n";
-                    printf("\033[31mWarning: find a potential bug:\033[0m\n");
-                    OP << "Global Bug num:" << GlobalBugNum++ <<"\n";
-                    string topfuncname = F->getName();
-                    OP << "File name: "<<getInstFilename(dyn_cast<Instruction>(CV_critical.inst))<<"\n";
-                    OP << "Function: "<< topfuncname <<"\n";
-                    OP << "Bug Type: "<< "Missing check"<<"\n";
-                    OP << "-----------------------------\n";
-                    OP << "Current path pair start at block-"<<getBlockName(pathpairs.startBlock.BB)<<"\n";
-                    OP << "CriticalVar is checked in path \'"<< j <<"\' but not in path \'"<<i<<"\'\n";
-                    OP << "--Path "<< j <<": ";
-                    OP << " ";
-                    for(auto it = pathpairs.Paths[j].CBChain.begin(); it != pathpairs.Paths[j].CBChain.end();it++){
-                        CompoundBlock CBB = *it;
-                        BasicBlock* BB = CBB.BB;
-                        OP << "Block-"<<getBlockName(BB)<<" ";
-                    }
-                    OP << "\n";
-                    OP << "--Path "<< i <<": ";
-                    OP << " ";
-                    for(auto it = pathpairs.Paths[i].CBChain.begin(); it != pathpairs.Paths[i].CBChain.end();it++){
-                        CompoundBlock CBB = *it;
-                        BasicBlock* BB = CBB.BB;
-                        OP << "Block-"<<getBlockName(BB)<<" ";
-                    }
-                    OP << "\n";
-                    OP << "--Branch from line "<<getBranchLineNo(pathpairs.Paths[j])<<"\n";
-                    OP << "-----------------------------\n";
-                    OP << "CriticalVar("<<getInstLineNo(dyn_cast<Instruction>(checkedvalue))<<"): "<<getValueContent(checkedvalue)<<"\n";
-                    
-                    OP << "CriticalSource:\n";
-                    for(auto i = CV_critical.sourceset.begin(); i != CV_critical.sourceset.end(); i++){
-                        OP << "--Source("<<getInstLineNo(dyn_cast<Instruction>(*i))<<"): "<<getValueContent(*i)<<"\n";
-                    }
-
-                    OP << "Sourcefuns:\n";
-                    for(auto i = CV_critical.sourcefuncs.begin(); i != CV_critical.sourcefuncs.end(); i++){
-                        string funcname = *i;
-                        OP << "--" << funcname <<"\n";
-                    }
-
-                    OP<<"getelementptr source: \n";
-                    for(auto i = CV_critical.getelementptrInfo.begin(); i != CV_critical.getelementptrInfo.end(); i++){
-                        OP<<"--Source 1: "<<getValueContent(i->first)<<"\n";
-                        for(auto j = i->second.begin(); j!=i->second.end();j++){
-                            OP<<"Source 2: "<<getValueContent(*j)<<"\n";
-                        }
-                    }
-                    
-                    OP << "CheckInst("<<getInstLineNo(dyn_cast<Instruction>(CV_critical.check))<< "): "<<getValueContent(CV_critical.check)<<"\n";
-                    OP << "-----------------------------\n";
-                    OP << "NormalInst("<<getInstLineNo(dyn_cast<Instruction>(CV_normal.inst))<<"): "<< getValueContent(CV_normal.inst)<<"\n";
-                    OP << "NormalSource:\n";
-                    for(auto i = CV_normal.sourceset.begin(); i != CV_normal.sourceset.end(); i++){
-                        OP << "--Source("<<getInstLineNo(dyn_cast<Instruction>(*i))<<"): "<<getValueContent(*i)<<"\n";
-                    }
-
-                    OP << "Sourcefuns:\n";
-                    for(auto i = CV_normal.sourcefuncs.begin(); i != CV_normal.sourcefuncs.end(); i++){
-                        string funcname = *i;
-                        OP << "--" << funcname <<"\n";
-                    }
-
-                    OP<<"getelementptr source: \n";
-                    for(auto i = CV_normal.getelementptrInfo.begin(); i != CV_normal.getelementptrInfo.end(); i++){
-                        OP<<"--Source 1: "<<getValueContent(i->first)<<"\n";
-                        for(auto j = i->second.begin(); j!=i->second.end();j++){
-                            OP<<"Source 2: "<<getValueContent(*j)<<"\n";
-                        }
-                    }
-
-                    OP<<"=============================\n";
+                    BugReport report;
+                    initBugReport(report, F, pathpairs, i, j);
+                    report.FileInst = dyn_cast<Instruction>(CV_critical.inst);
+                    report.BugType = "Missing check";
+                    report.Description = "CriticalVar is checked in path \'" + to_string(j) + "\' but not in path \'" + to_string(i) + "\'";
+                    report.Target = CV_normal.inst;
+                    report.OperationKind = "CriticalVar";
+                    report.OperationInst = dyn_cast<Instruction>(checkedvalue);
+                    report.OperationValue = checkedvalue;
+                    addCriticalVarDetails(report, "Critical", CV_critical);
+                    addInstDetail(report, "CheckInst", CV_critical.check);
+                    addInstDetail(report, "NormalInst", CV_normal.inst);
+                    addCriticalVarDetails(report, "Normal", CV_normal);
+                    Ctx->BugReports.submit(std::move(report));
                     Ctx->NumBugs++;
 
-                    reportSet.insert(topfuncname);
+                    reportSet.insert(F->getName());
                 }
             }
         }
 
     }//end check
-    in.close();
 
 }
\ No newline at end of file
@@ -26,7 +26,6 @@ using namespace llvm;
 //#define PRINT_PATH_PAIR_RESULT
 //#define TEST_ONE_CASE "target_function_name"
 //#define PRINT_FUNCTION_NAME
-//#define DUMP_ERR_EDGE
 //#define CONCURRENT
 #define MAX_BLOCK_NUM 500
 
@@ -100,242 +99,198 @@ bool PairAnalysisPass::doModulePass(Module *M) {
     ofstream in;
     
     for(Module::iterator f = M->begin(), fe = M->end();	f != fe; ++f){
-        Function *F = &*f;
+        analyzeFunction(&*f);
+    }
+
+    return false;
+}
 
-        if(F->empty())
-            continue;
+void PairAnalysisPass::analyzeFunction(Function *F){
+
+    if(F->empty())
+        return;
+    
+    //Skip functions in skipfunc list
+    if(1 == Ctx->SkipFuncs.count(F->getName())){
+        return;
+    }
         
-        //Skip functions in skipfunc list
-        if(1 == Ctx->SkipFuncs.count(F->getName())){
-            continue;
-        }
-            
-        //F is not empty or ignored
-        Ctx->NumFunctions++;
+    //F is not empty or ignored
+    Ctx->NumFunctions++;
 
 #ifdef TEST_ONE_CASE
-        //Only test specific function
-        if(F->getName()!= TEST_ONE_CASE){
-            continue;
-        }
+    //Only test specific function
+    if(F->getName()!= TEST_ONE_CASE){
+        return;
+    }
 #endif
-        
-        if(1 == Ctx->Loopfuncs.count(F)){
-            continue;
-        }
+    
+    if(1 == Ctx->Loopfuncs.count(F)){
+        return;
+    }
+
+    //Reports of the representative cover its copies
+    if(Ctx->DuplicateFuncs.count(F)){
+        return;
+    }
 
-        /*if(Ctx->SecurityOperationSets.count(F) == 0){
-            continue;
-        }*/
+    /*if(Ctx->SecurityOperationSets.count(F) == 0){
+        return;
+    }*/
 
 #ifdef PRINT_FUNCTION_NAME
-        OP << "Current func: " << F->getName() << "\n";
+    OP << "Current func: " << F->getName() << "\n";
 #endif
-        
-        //Get the first basic block
-        Function::iterator bb = F->begin();
-        BasicBlock * B = &*bb;
+    
+    //Get the first basic block
+    Function::iterator bb = F->begin();
+    BasicBlock * B = &*bb;
 
-        //Print all blocks and their line number
+    //Print all blocks and their line number
 #ifdef SINGLE_FUNCTION_DEBUG_PRINT
-        
-        for(Function::iterator b = F->begin(); 
-            b != F->end(); b++){
-            BasicBlock * bb = &*b;
-            OP << "Block-"<<getBlockName(bb)<<" ";
-            printBlockMessage(bb);
-        }
+    
+    for(Function::iterator b = F->begin(); 
+        b != F->end(); b++){
+        BasicBlock * bb = &*b;
+        OP << "Block-"<<getBlockName(bb)<<" ";
+        printBlockMessage(bb);
+    }
 #endif  
 
-        vector<BasicBlock*> globalblockset;
-        initGlobalBlockSet(F,globalblockset);
+    std::shared_ptr<FunctionAnalyses> FA = Ctx->FuncAnalyses.get(F);
+    const vector<BasicBlock*> &globalblockset = FA->getBlocks();
 
-        //If the block number is too large, then we ignore this function
-        if(globalblockset.size()>MAX_BLOCK_NUM){
-            Ctx->Longfuncs.insert(F);
-            globalblockset.clear();
-            OP << "Long func: "<< F->getName()<<"\n";
-            continue;
-        }
+    //If the block number is too large, then we ignore this function
+    if(globalblockset.size()>MAX_BLOCK_NUM){
+        Ctx->Longfuncs.insert(F);
+        OP << "Long func: "<< F->getName()<<"\n";
+        return;
+    }
 
-        //Record the return value of May_Return_Err block
-        map<BasicBlock *,Value *> blockAttributeMap;
-        blockAttributeMap.clear();
+    // Find all error edges in CFG
+    const EdgeIgnoreMap &errEdgeMap = FA->getErrorEdges(
+        [&](EdgeIgnoreMap &edges){ computeErrorEdges(F, edges); });
+
+    //dumpErrEdges(errEdgeMap);
+
+    /////////////////////////////////////////////////////////////////////
+    //************************
+    //*Recursively find paths*
+    //************************
+    /////////////////////////////////////////////////////////////////////
+    std::vector<PathPairs> PathGroup;
+    PathGroup.clear();
+    std::vector<PathPairs> PathGroup_Normal;
+    PathGroup_Normal.clear();
+    std::vector<PathPairs> PathGroup_Error;
+    PathGroup_Error.clear();
+
+    map<BasicBlock *,SinglePath> branchvisitMap;
+    branchvisitMap.clear();
+
+    //Blocks are shared by the normal and error path pairs
+    PathFactCache factCache;
+    initPathFactCache(F, factCache);
+
+    //Prepair this for missing init detection
+    //Generate a edgeIgnoremap that ignore init operations
+    map<Value*,EdgeIgnoreMap> edgeIgnoreMap_init;
+    //Todo: design a better filter strategy
+    //initEdgeIgnoreMap_Init(F, edgeIgnoreMap_init);
+
+    /////////////////////////////////////////////////////////////////////
+    //----------First we ignore the error edges and only collect normal path pairs
+    /////////////////////////////////////////////////////////////////////
+    SinglePath curpath;
+    curpath.CBChain.clear();
+
+    EdgeIgnoreMap edgeIgnoreMap_normal;
+    edgeIgnoreMap_normal = errEdgeMap;
+    addSelfLoopEdges(F,edgeIgnoreMap_normal); //also ignore loop edge
+
+    map<BasicBlock*,int> indegreeMap;
+    initIndegreeMap(F,indegreeMap,edgeIgnoreMap_normal);
+    
+    //dumpErrEdges(edgeIgnoreMap_normal);
+    
+    const ConnectGraph &connectGraph = FA->getReachability(edgeIgnoreMap_normal);
 
-        //Return value check
-        BBErrMap bbErrMap;
-        set<BasicBlock *> normalblockSet;
-        bbErrMap.clear(), normalblockSet.clear();
-        EdgeErrMap edgeErrMap;
-        edgeErrMap.clear();
-        
-        // Find and record basic blocks that set error returning code
-        checkErrReturn(F, bbErrMap, blockAttributeMap);
-        for(auto i = bbErrMap.begin(); i != bbErrMap.end();i++){
-            BasicBlock* bb = i->first;
-            int CV = i->second;
-
-            if(CV == Not_Return_Err){
-                bbErrMap[bb] = May_Return_Err;
-                normalblockSet.insert(bb);
-            }
-        }
+    //Collect normal path pairs
+    recurFindPaths(branchvisitMap,edgeIgnoreMap_normal,indegreeMap,B,connectGraph,curpath,PathGroup_Normal);
+    similarPathAnalysis(F,PathGroup_Normal,connectGraph,factCache,edgeIgnoreMap_init,edgeIgnoreMap_normal,false);
 
-        // Find and record basic blocks that have error handling code
-        Type* return_value_type = F->getReturnType();
-        if(return_value_type->isVoidTy()){
-            checkErrHandle(F, bbErrMap);
-        }
-        //checkErrHandle(F, bbErrMap);
 
-        markAllEdgesErrFlag(F, bbErrMap, edgeErrMap);
-        
-        for(auto it = blockAttributeMap.begin(); it != blockAttributeMap.end();it++){
-            markCallCases(F, it->second, edgeErrMap);
-        }
+    /////////////////////////////////////////////////////////////////////
+    //-----------Then we target the error paths
+    /////////////////////////////////////////////////////////////////////
+    SinglePath curpath2;
+    curpath2.CBChain.clear();
+    B = &*bb;
 
-#ifdef DUMP_ERR_EDGE
-        dumpErrEdges(edgeErrMap);
-#endif    
-        
-        // Find all error edges in CFG
-        EdgeIgnoreMap errEdgeMap;
-        errEdgeMap.clear();
-        for(auto it = edgeErrMap.begin(); it != edgeErrMap.end();it++){
-            CFGEdge edge = it->first;
-		    int flag = it->second;
-
-            //Found an error edge
-            if(!checkEdgeErr(edge,edgeErrMap)){
-                pair<CFGEdge,int> value(edge,1);
-                errEdgeMap.insert(value);
-            }
-        }
+    EdgeIgnoreMap normalEdgeMap;
+    initNormalEdgeMap(F,normalEdgeMap,errEdgeMap);
+    //showEdgeIgnoreMap(normalEdgeMap);
 
-        //dumpErrEdges(errEdgeMap);
-
-        /////////////////////////////////////////////////////////////////////
-        //************************
-        //*Recursively find paths*
-        //************************
-        /////////////////////////////////////////////////////////////////////
-        std::vector<PathPairs> PathGroup;
-        PathGroup.clear();
-        std::vector<PathPairs> PathGroup_Normal;
-        PathGroup_Normal.clear();
-        std::vector<PathPairs> PathGroup_Error;
-        PathGroup_Error.clear();
-
-        map<BasicBlock *,SinglePath> branchvisitMap;
-        branchvisitMap.clear();
-
-        //Prepair this for missing init detection
-        //Generate a edgeIgnoremap that ignore init operations
-        map<Value*,EdgeIgnoreMap> edgeIgnoreMap_init;
-        //Todo: design a better filter strategy
-        //initEdgeIgnoreMap_Init(F, edgeIgnoreMap_init);
-
-        /////////////////////////////////////////////////////////////////////
-        //----------First we ignore the error edges and only collect normal path pairs
-        /////////////////////////////////////////////////////////////////////
-        SinglePath curpath;
-        curpath.CBChain.clear();
-
-        EdgeIgnoreMap edgeIgnoreMap_normal;
-        edgeIgnoreMap_normal = errEdgeMap;
-        addSelfLoopEdges(F,edgeIgnoreMap_normal); //also ignore loop edge
-
-        map<BasicBlock*,int> indegreeMap;
-        initIndegreeMap(F,indegreeMap,edgeIgnoreMap_normal);
-        
-        //dumpErrEdges(edgeIgnoreMap_normal);
-        
-        ConnectGraph connectGraph;
-        initConnectGraph(F,connectGraph, globalblockset, edgeIgnoreMap_normal);
+    //dumpErrEdges(normalEdgeMap);
+    
+    branchvisitMap.clear();
+    EdgeIgnoreMap edgeIgnoreMap_bug = normalEdgeMap;
+    addSelfLoopEdges(F,edgeIgnoreMap_bug);
+    indegreeMap.clear();
+    initIndegreeMap(F,indegreeMap,edgeIgnoreMap_bug);
+    const ConnectGraph &connectGraph_bug = FA->getReachability(edgeIgnoreMap_bug);
+    
+    //Collect error path pairs
+    recurFindPaths(branchvisitMap,edgeIgnoreMap_bug,indegreeMap,B,connectGraph_bug,curpath2,PathGroup_Error);
+    similarPathAnalysis(F,PathGroup_Error,connectGraph_bug,factCache,edgeIgnoreMap_init,edgeIgnoreMap_bug,true);
 
-        //Collect normal path pairs
-        recurFindPaths(branchvisitMap,edgeIgnoreMap_normal,indegreeMap,B,connectGraph,curpath,PathGroup_Normal);
-        similarPathAnalysis(F,PathGroup_Normal,connectGraph,edgeIgnoreMap_init,edgeIgnoreMap_normal,false);
+    //Finally merge these two path pair groups
+    PathGroup.insert(PathGroup.end(),PathGroup_Normal.begin(),PathGroup_Normal.end());
+    PathGroup.insert(PathGroup.end(),PathGroup_Error.begin(),PathGroup_Error.end());
+    
 
+    //No path pairs are found
+    if(PathGroup.empty()){
+        return;
+    }
 
-        /////////////////////////////////////////////////////////////////////
-        //-----------Then we target the error paths
-        /////////////////////////////////////////////////////////////////////
-        SinglePath curpath2;
-        curpath2.CBChain.clear();
-        B = &*bb;
+    //Print collected path pairs
+#ifdef PRINT_PATH_PAIR_RESULT
+    OP << "Current func: " << F->getName() << "\n"; 
+    int n=0;
+    int subn=0;
 
-        EdgeIgnoreMap normalEdgeMap;
-        initNormalEdgeMap(F,normalEdgeMap,errEdgeMap);
-        //showEdgeIgnoreMap(normalEdgeMap);
-    
-        //dumpErrEdges(normalEdgeMap);
+    for(int i=0;i<PathGroup.size();i++,n++){
         
-        branchvisitMap.clear();
-        EdgeIgnoreMap edgeIgnoreMap_bug = normalEdgeMap;
-        addSelfLoopEdges(F,edgeIgnoreMap_bug);
-        indegreeMap.clear();
-        initIndegreeMap(F,indegreeMap,edgeIgnoreMap_bug);
-        initConnectGraph(F,connectGraph, globalblockset, edgeIgnoreMap_bug);
+        OP << "  Current path group: " << i+1 << "\n";
+        PathPairs curpathpairs = PathGroup[i];
         
-        //Collect error path pairs
-        recurFindPaths(branchvisitMap,edgeIgnoreMap_bug,indegreeMap,B,connectGraph,curpath2,PathGroup_Error);
-        similarPathAnalysis(F,PathGroup_Error,connectGraph,edgeIgnoreMap_init,edgeIgnoreMap_bug,true);
+        BasicBlock *startbb = PathGroup[i].startBlock.BB;
 
-        //Finally merge these two path pair groups
-        PathGroup.insert(PathGroup.end(),PathGroup_Normal.begin(),PathGroup_Normal.end());
-        PathGroup.insert(PathGroup.end(),PathGroup_Error.begin(),PathGroup_Error.end());
-        
+        //Find every path pair
+        for(int j=0;j<curpathpairs.getPathNum();j++){
 
-        //No path pairs are found
-        if(PathGroup.empty()){
-            continue;
-        }
+            OP << "    Current single path: " << j+1 << "\n";
+            SinglePath curpath = curpathpairs.Paths[j];
+            OP << "      ";
 
-        //Print collected path pairs
-#ifdef PRINT_PATH_PAIR_RESULT
-        OP << "Current func: " << F->getName() << "\n"; 
-        int n=0;
-        int subn=0;
-
-        for(int i=0;i<PathGroup.size();i++,n++){
-            
-            OP << "  Current path group: " << i+1 << "\n";
-            PathPairs curpathpairs = PathGroup[i];
-            
-            BasicBlock *startbb = PathGroup[i].startBlock.BB;
-
-            //Find every path pair
-            for(int j=0;j<curpathpairs.getPathNum();j++){
-
-                OP << "    Current single path: " << j+1 << "\n";
-                SinglePath curpath = curpathpairs.Paths[j];
-                OP << "      ";
-
-                for(int k=0;k<curpath.getPathLength();k++){
-                    BasicBlock* curbb = curpath.CBChain[k].BB;
-                    OP << "Block-" << getBlockName(curbb) <<"  ";
-                }
-                OP << "\n";                
+            for(int k=0;k<curpath.getPathLength();k++){
+                BasicBlock* curbb = curpath.CBChain[k].BB;
+                OP << "Block-" << getBlockName(curbb) <<"  ";
             }
-
-            OP << "  Current path pairs end" <<"\n\n";
+            OP << "\n";                
         }
-#endif
 
-        functionend:
+        OP << "  Current path pairs end" <<"\n\n";
+    }
+#endif
 
-        Ctx->NumPathPairs += PathGroup.size();
+    functionend:
 
-        //Clean
-        curpath.CBChain.clear();
-        PathGroup.clear();
-        globalblockset.clear();
-        connectGraph.clear();
-        indegreeMap.clear();
-        bbErrMap.clear();
-        edgeErrMap.clear();
-    }
+    Ctx->NumPathPairs += PathGroup.size();
 
-    return false;
+    //Clean
+    curpath.CBChain.clear();
+    PathGroup.clear();
+    indegreeMap.clear();
 }
@@ -4,6 +4,7 @@
 #include <llvm/Analysis/BasicAliasAnalysis.h>
 #include <llvm/Analysis/AliasAnalysis.h>
 #include <queue>
+#include <stack>
 #include "../Analyzer.h"
 #include "../Tools.h"
 #include <fstream>
@@ -16,7 +17,7 @@ class PairAnalysisPass : public IterativeModulePass {
     //Define compound basic block structure
     typedef struct CompoundBlock {
         llvm::BasicBlock *BB;
-        std::vector <llvm::Function *> CallFunctionSet;
+        const BlockSummary *Summary;    //Owned by the function analyses of BB
         bool ignore;
         bool branch;
         bool merge;
@@ -25,7 +26,7 @@ class PairAnalysisPass : public IterativeModulePass {
 
         CompoundBlock(){
             BB = NULL;
-            CallFunctionSet.clear();
+            Summary = NULL;
             ignore = false;
             branch = false;
             merge = false;
@@ -66,12 +67,12 @@ class PairAnalysisPass : public IterativeModulePass {
         int getInstNumber(){
             int num = 0;
             for(int i = 0; i < CBChain.size();i++){
-                CompoundBlock CB = CBChain[i];
-                BasicBlock* BB = CB.BB;
-                for(BasicBlock::iterator I = BB->begin(), IE = BB->end();
-                    I != IE; ++I) {
-                    num++;
+                CompoundBlock &CB = CBChain[i];
+                if(CB.Summary){
+                    num += CB.Summary->NumInsts;
+                    continue;
                 }
+                num += CB.BB->size();
             }
             return num;
         }
@@ -184,6 +185,31 @@ class PairAnalysisPass : public IterativeModulePass {
     } CriticalVar;
  
 
+    //Security operations and sources found in one block. They do not
+    //depend on the path through the block unless the path has a
+    //self-loop edge, see findSameVariablesFrom
+    typedef struct PathBlockFacts {
+        std::vector<CriticalVar> normalvars;
+        std::vector<CriticalVar> criticalvars;
+        std::vector<CriticalVar> resourcereleases;
+        std::vector<CriticalVar> initoperations;
+        std::vector<Value *> pairfunccalls;
+        std::vector<Value *> refcountfunccalls;
+        std::vector<Value *> lockfunccalls;
+        std::vector<Value *> unlockfunccalls;
+    } PathBlockFacts;
+
+    //Block facts of a function, shared by all of its path pairs
+    typedef struct PathFactCache {
+        std::shared_ptr<FunctionAnalyses> FA;
+        set<Value *> SOBranchSet;           //Instructions of security operations
+        set<Value *> GlobalPairFuncSet;
+        set<Value *> GlobalRefCountFuncSet;
+        set<Value *> GlobalLockFuncSet;
+        set<Value *> GlobalUnlockFuncSet;
+        std::map<BasicBlock *, PathBlockFacts> blockFacts;
+    } PathFactCache;
+
     typedef std::map<BasicBlock *,int> BBIndegreeMap;
     //typedef std::map<BasicBlock *,bool> BranchIgnoreMap;
 
@@ -196,7 +222,8 @@ class PairAnalysisPass : public IterativeModulePass {
     typedef std::map<CFGEdge, int> EdgeIgnoreMap;
     
     typedef std::pair<BasicBlock*, BasicBlock*> Blockpair;
-    typedef std::map<Blockpair, bool> ConnectGraph;
+    //Block reachability without the ignored edges of a path group
+    typedef ReachabilityIndex ConnectGraph;
 
     //Return value check:
     enum ErrFlag {
@@ -222,15 +249,8 @@ class PairAnalysisPass : public IterativeModulePass {
         //Path pair collection
         ////////////////////////////////////////////////////////
 
-        bool updateConnectGraph(ConnectGraph &connectGraph, 
-            std::vector<BasicBlock*> globalblockset);
-
-        void initConnectGraph(Function *F,ConnectGraph &connectGraph,
-            std::vector<BasicBlock*> globalblockset,
-            EdgeIgnoreMap edgeIgnoreMap);
-        
         bool checkBlockAToB_Version2(BasicBlock*a, BasicBlock *b,
-            ConnectGraph connectGraph);
+            const ConnectGraph &connectGraph);
 
         //Check if a basic block is a branch block with the help of edgeIgnoreMap
         bool checkBranchWithMap(BasicBlock *bb, 
@@ -258,7 +278,7 @@ class PairAnalysisPass : public IterativeModulePass {
             EdgeIgnoreMap &edgeIgnoreMap,
             std::map<BasicBlock*, int> &indegreeMap,
             BasicBlock *bb, 
-            ConnectGraph &connectGraph,
+            const ConnectGraph &connectGraph,
             SinglePath &curpath,
             //std::vector<SinglePath> &Paths, 
             std::vector<PathPairs> &PathGroup);
@@ -266,19 +286,13 @@ class PairAnalysisPass : public IterativeModulePass {
         void initGlobalPathMap(std::vector<PathPairs> PathGroup,
             std::map<BasicBlock *, PathPairs> &GlobalPathMap);
 
-        void initPairFuncCallSet(set<Value *> pathvalueset,
-            set<Value *> &pairfunccallset,
-            set<Value *> GlobalPairFuncSet);
-        
-        void initRefcountFuncCallSet(set<Value *> pathvalueset,
-            set<Value *> &refcountfunccallset,
-            set<Value *> GlobalRefCountFuncSet);
+        void initPathFactCache(Function *F, PathFactCache &factCache);
 
-        void initUnlockFuncCallSet(set<Value *> pathvalueset,
-            set<Value *> &lockfunccallset,
-            set<Value *> &unlockfunccallset,
-            set<Value *> GlobalLockFuncSet,
-            set<Value *> GlobalUnlockFuncSet);
+        //Collect the facts of BB, pathedgeSet is only used by phi sources
+        void collectBlockFacts(Function *F, BasicBlock *BB,
+            const set<CFGEdge> &pathedgeSet,
+            PathFactCache &factCache,
+            PathBlockFacts &facts);
 
         void initGlobalPairFuncSet(Function *F, 
             set<Value *> &GlobalPairFuncSet);
@@ -311,8 +325,6 @@ class PairAnalysisPass : public IterativeModulePass {
             std::map<BasicBlock *,Value *> &blockAttributeMap);
         
 
-        bool isValueErrno(Value *V, Function *F);
-
         // Mark the given block with an error flag.
 	    void markBBErr(BasicBlock *BB, ErrFlag flag, BBErrMap &bbErrMap);
 
@@ -332,9 +344,9 @@ class PairAnalysisPass : public IterativeModulePass {
         // Some return values of function cannot be identified, use this to solve this problem
         void markCallCases(Function *F,Value * Cond, EdgeErrMap &edgeErrMap);
 
-        // Recursively mark edges from the error-handling block to the
-        // closest branches
-        void recurMarkEdgesToErrHandle(BasicBlock *BB, EdgeErrMap &edgeErrMap);
+        // Mark edges from the error-handling blocks to the closest branches
+        void markErrHandleEdges(Function *F, BBErrMap &bbErrMap, 
+                EdgeErrMap &edgeErrMap);
 
         // Incorporate newFlag into existing flag
         void updateReturnFlag(int &errFlag, int &newFlag);
@@ -355,7 +367,10 @@ class PairAnalysisPass : public IterativeModulePass {
         // Dump marked edges.
 	    void dumpErrEdges(EdgeErrMap &edgeErrMap);
         
-        bool checkEdgeErr(CFGEdge edge, EdgeErrMap edgeErrMap);
+        bool checkEdgeErr(CFGEdge edge, const EdgeErrMap &edgeErrMap);
+
+        // Error edges of F, kept in the shared function analyses
+        void computeErrorEdges(Function *F, EdgeIgnoreMap &errEdgeMap);
 
         ////////////////////////////////////////////////////////
         //Differential Check
@@ -364,52 +379,57 @@ class PairAnalysisPass : public IterativeModulePass {
         //Execute security check analysis against path pairs in PathGroup
         void similarPathAnalysis(Function *F,
             std::vector<PathPairs> &PathGroup,
-            ConnectGraph connectGraph,
+            const ConnectGraph &connectGraph,
+            PathFactCache &factCache,
             map<Value*,EdgeIgnoreMap> edgeIgnoreMap_init,
             EdgeIgnoreMap edgeIgnoreMap,
             bool in_err_paths);
 
         void similarPathAnalysis_singlePathpair(Function *F,
             PathPairs pathpairs,
-            ConnectGraph connectGraph,
+            const ConnectGraph &connectGraph,
+            PathFactCache &factCache,
             map<Value*,EdgeIgnoreMap> edgeIgnoreMap_init,
             EdgeIgnoreMap edgeIgnoreMap,
             bool in_err_paths);
 
         //Used in similarPathAnalysis_singlePathpair
         void differentialCheck_SecurityCheck(Function *F,
-            PathPairs pathpairs,
+            PathPairs &pathpairs,
             int i, int j,
-            std::vector<set<Value *>>pathvalueset_vector,
-            std::map<int, set<CriticalVar>> pathpaircriticalarr,
-            std::map<int, set<CriticalVar>> pathpairnormalarr,
+            std::vector<set<Value *>> &pathvalueset_vector,
+            std::map<int, set<CriticalVar>> &pathpaircriticalarr,
+            std::map<int, set<CriticalVar>> &pathpairnormalarr,
             set<string> &reportSet);
         
         void differentialCheck_Refcount(Function *F,
-            PathPairs pathpairs,
+            PathPairs &pathpairs,
             int i, int j,
-            map<int, set<Value *>> pathpairfuncpairarr,
+            map<int, set<Value *>> &pathpairfuncpairarr,
             set<string> &reportSet);
 
         void differentialCheck_Unlock(Function *F,
-            PathPairs pathpairs,
+            PathPairs &pathpairs,
             int i, int j,
-            map<int, set<Value *>> pathpairlockarr,
-            map<int, set<Value *>> pathpairunlockarr,
+            map<int, set<Value *>> &pathpairlockarr,
+            map<int, set<Value *>> &pathpairunlockarr,
             set<string> &reportSet);
         
         void differentialCheck_ResourceRelease(Function *F,
-            PathPairs pathpairs,
+            PathPairs &pathpairs,
             int i, int j,
-            map<int, set<CriticalVar>> resourcereleasefuncpairarr,
-            std::map<int, set<CriticalVar>> pathpairnormalarr,
-            EdgeIgnoreMap edgeIgnoreMap,
+            map<int, set<CriticalVar>> &resourcereleasefuncpairarr,
+            std::map<int, set<CriticalVar>> &pathpairnormalarr,
+            const ConnectGraph &connectGraph,
             set<string> &reportSet);
-        
 
-        bool findCommonPairFunc(set<Value *> VS, Value* CV, BasicBlock* CommonHead);
-        bool findCommonRefcountFunc(set<Value *> VS, Value* CV);
-        bool findCommonUnlockFunc(set<Value *> VS, Value* CV);
+        void initBugReport(BugReport &report, Function *F,
+            PathPairs &pathpairs, int i, int j);
+        void addCriticalVarDetails(BugReport &report, string prefix, CriticalVar &CV);
+
+        bool findCommonPairFunc(const set<Value *> &VS, Value* CV, BasicBlock* CommonHead);
+        bool findCommonRefcountFunc(const set<Value *> &VS, Value* CV);
+        bool findCommonUnlockFunc(const set<Value *> &VS, Value* CV);
 
         bool checkCondofCommonHead(Function *F, BasicBlock* CommonHead);
         bool checkTargetinCommonHeadCond(Value *targetvar, BasicBlock* CommonHead);
@@ -439,7 +459,7 @@ class PairAnalysisPass : public IterativeModulePass {
         bool checkValueRedefine(Function *F,
             Value *cirticalvalue,
             BasicBlock *CommonHead,
-            EdgeIgnoreMap edgeIgnoreMap);
+            const ConnectGraph &connectGraph);
 
         ////////////////////////////////////////////////////////
         //Test functions
@@ -456,29 +476,30 @@ class PairAnalysisPass : public IterativeModulePass {
         //This function comes from SecurityCheck.cc
         void findSameVariablesFrom(Function *F,
             CriticalVar &criticalvar,
-            std::set<CFGEdge>pathedgeset
+            const std::set<CFGEdge> &pathedgeset
             //Value *V, 
             //set<Value*> &VSourceSet,
             //std::set<Value *>pathvalueset
             );
         
         //Find if two criticalvars share the same source
-        bool findCVSource(CriticalVar CVA, CriticalVar CVB);
+        bool findCVSource(const CriticalVar &CVA, const CriticalVar &CVB);
 
         //Return true if this value is checked
         bool checkUseChain(Value *V, SinglePath path);
         
         //Find the top block
-        BasicBlock * findTopBlock(std::set<BasicBlock *> blockset, ConnectGraph connectGraph);
-        BasicBlock * findTopBlock(std::set<BasicBlock *> blockset);
-        BasicBlock * findBottomBlock(std::set<BasicBlock *> blockset);
+        BasicBlock * findTopBlock(std::set<BasicBlock *> blockset, const ConnectGraph &connectGraph);
+        //Over all CFG edges
+        BasicBlock * findTopBlock(std::set<BasicBlock *> blockset, FunctionAnalyses &FA);
+        BasicBlock * findBottomBlock(std::set<BasicBlock *> blockset, FunctionAnalyses &FA);
 
 
         //Check if there is a path from fromBB to toBB 
         bool checkBlockPairConnectivity(
             BasicBlock* fromBB, 
             BasicBlock* toBB,
-            EdgeIgnoreMap edgeIgnoreMap);
+            const EdgeIgnoreMap &edgeIgnoreMap);
         
         bool checkBlockPairConnectivity(BasicBlock* fromBB, BasicBlock* toBB);
 
@@ -495,6 +516,11 @@ class PairAnalysisPass : public IterativeModulePass {
         bool checkReturnBlock(BasicBlock *bb, EdgeIgnoreMap edgeIgnoreMap);
 
     public:
+        // Check if the value is an errno, also used by the function
+        // summaries. Unlike SecurityChecksPass::isValueErrno, it does not
+        // count -EINPROGRESS, -ETIMEDOUT and -ERESTARTSYS as errors.
+        static bool isValueErrno(Value *V, Function *F);
+
         PairAnalysisPass(GlobalContext *Ctx_)
          : IterativeModulePass(Ctx_, "PairAnalysis") { }
         virtual bool doInitialization(llvm::Module *);
@@ -503,6 +529,9 @@ class PairAnalysisPass : public IterativeModulePass {
         
         virtual void run(ModuleList &modules);
 
+        // Run the pass on one function, for the fused pipeline
+        void analyzeFunction(Function *F);
+
 };
 
 
@@ -99,7 +99,7 @@ bool PairAnalysisPass::checkReturnBlock(BasicBlock *bb, EdgeIgnoreMap edgeIgnore
 
 //Find the top block
 BasicBlock * PairAnalysisPass::findTopBlock(std::set<BasicBlock *> blockset, 
-    ConnectGraph connectGraph){
+    const ConnectGraph &connectGraph){
     
     if(blockset.empty() || connectGraph.empty())
         return NULL;
@@ -123,7 +123,8 @@ BasicBlock * PairAnalysisPass::findTopBlock(std::set<BasicBlock *> blockset,
     return NULL;
 }
 
-BasicBlock * PairAnalysisPass::findTopBlock(std::set<BasicBlock *> blockset){
+BasicBlock * PairAnalysisPass::findTopBlock(std::set<BasicBlock *> blockset,
+    FunctionAnalyses &FA){
     
     if(blockset.empty())
         return NULL;
@@ -137,7 +138,7 @@ BasicBlock * PairAnalysisPass::findTopBlock(std::set<BasicBlock *> blockset){
         for(auto j = blockset.begin(); j != blockset.end();j++){
             BasicBlock *bb2 = *j;
 
-            if(!checkBlockPairConnectivity(bb1, bb2)){
+            if(!FA.isReachable(bb1, bb2)){
                 top = false;
                 break;
             }
@@ -150,7 +151,8 @@ BasicBlock * PairAnalysisPass::findTopBlock(std::set<BasicBlock *> blockset){
 }
 
 //Find the bottom block
-BasicBlock * PairAnalysisPass::findBottomBlock(std::set<BasicBlock *> blockset){
+BasicBlock * PairAnalysisPass::findBottomBlock(std::set<BasicBlock *> blockset,
+    FunctionAnalyses &FA){
     
     if(blockset.empty())
         return NULL;
@@ -166,7 +168,7 @@ BasicBlock * PairAnalysisPass::findBottomBlock(std::set<BasicBlock *> blockset){
             if(bb1 == bb2)
                 continue;
             
-            if(checkBlockPairConnectivity(bb1, bb2)){
+            if(FA.isReachable(bb1, bb2)){
                 bottom = false;
                 break;
             }
@@ -202,7 +204,7 @@ void PairAnalysisPass::initGlobalPathMap(std::vector<PathPairs> PathGroup,
 bool PairAnalysisPass::checkBlockPairConnectivity(
     BasicBlock* fromBB, 
     BasicBlock* toBB,
-    EdgeIgnoreMap edgeIgnoreMap){
+    const EdgeIgnoreMap &edgeIgnoreMap){
 
     if(fromBB == NULL || toBB == NULL)
         return false;
@@ -249,35 +251,11 @@ bool PairAnalysisPass::checkBlockPairConnectivity(
 
     if(fromBB == NULL || toBB == NULL)
         return false;
-    
-    //Use BFS to detect if there is a path from fromBB to toBB
-    std::list<BasicBlock *> EB; //BFS record list
-    std::set<BasicBlock *> PB; //Global value set to avoid loop
-    EB.push_back(fromBB);
-
-    while (!EB.empty()) {
-
-        BasicBlock *TB = EB.front(); //Current checking block
-		EB.pop_front();
-
-		if (PB.find(TB) != PB.end())
-			continue;
-		PB.insert(TB);
 
-        //Found a path
-        if(TB == toBB)
-            return true;
-
-        auto TI = TB->getTerminator();
-
-        for(BasicBlock *Succ: successors(TB)){
-
-            EB.push_back(Succ);
-        }
-
-    }//end while
+    if(fromBB->getParent() != toBB->getParent())
+        return false;
 
-    return false;
+    return Ctx->FuncAnalyses.get(fromBB->getParent())->isReachable(fromBB, toBB);
 }
 
 //Get the condition of a branch inst
@@ -457,16 +435,16 @@ bool PairAnalysisPass::checkCondofCommonHead(Function *F, BasicBlock* CommonHead
         CallInst *CAI = dyn_cast<CallInst>(TV);
         if(CAI){
 
-            StringRef FName = getCalledFuncName(CAI);
-            if(1 == Ctx->MemberGetFuncs.count(FName)){
+            uint32_t categories = Ctx->CalleeClasses.get(CAI);
+            if(categories & CC_MemberGet){
                 Value *arg = CAI->getArgOperand(0);
                 EV.push_back(arg);
             }
-            else if(FName.contains("_get_drvdata")){
+            else if(categories & CC_GetDrvdata){
                 Value *arg = CAI->getArgOperand(0);
                 EV.push_back(arg);
             }
-            else if(Ctx->EscapeFuncs.count(FName)){
+            else if(categories & CC_Escape){
                 return true;
             }
 
@@ -727,8 +705,7 @@ void PairAnalysisPass::initPostConditions(SinglePath path,
 
             CallInst * cinst = dyn_cast<CallInst>(iter);
             if(cinst) {
-                StringRef FName = getCalledFuncName(cinst);
-                if (Ctx->DebugFuncs.count(FName) == 1)
+                if (Ctx->CalleeClasses.get(cinst) & CC_Debug)
                     continue;
                 post_condistions.push(cinst);
             }
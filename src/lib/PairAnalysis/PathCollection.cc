@@ -26,103 +26,14 @@ using namespace llvm;
 
 //#define DEBUG_PATH_COLLECTION_RESULT
 
-//Warshall Algorithm
-bool PairAnalysisPass::updateConnectGraph(ConnectGraph &connectGraph,
-    vector<BasicBlock*> globalblockset){
-
-    bool changetag = false;
-
-    if(connectGraph.empty())
-        return changetag;
-    
-    //Searching backwards is faster
-    for(auto rit = connectGraph.rbegin(); rit != connectGraph.rend();rit++){
-        Blockpair blockpair = rit->first;
-        BasicBlock* firstbb = blockpair.first;
-        BasicBlock* secondbb = blockpair.second;
-        if(rit->second && firstbb != secondbb){
-            
-            for(auto it = globalblockset.begin(); it != globalblockset.end();it++){
-
-                BasicBlock* firstbb_in = *it;
-
-                Blockpair blockpair_update(firstbb_in,firstbb);
-                if(connectGraph[blockpair_update]){
-                    Blockpair blockpair_update2(firstbb_in,secondbb);
-                    if(connectGraph[blockpair_update2]==false)
-                        changetag = true;
-                    connectGraph[blockpair_update2]=true;
-                }   
-            }
-        }
-    }
-    return changetag;
-}
-
-//Current assume that CFG has no loop
-//ConnectGraph is used to check if a block is reachable for another
-void PairAnalysisPass::initConnectGraph(Function *F,ConnectGraph &connectGraph,
-    vector<BasicBlock*> globalblockset,
-    EdgeIgnoreMap edgeIgnoreMap){
-
-    connectGraph.clear();
-    if(!F)
-        return;
-    
-    vector<vector<BasicBlock*>> CG;
-    CG.clear();
-
-    //init
-    for (Function::iterator b1 = F->begin(), e1 = F->end();
-		b1 != e1; ++b1) {
-            
-		BasicBlock *BB1 = &*b1;
-
-        for(Function::iterator b2 = F->begin(), e2 = F->end(); 
-            b2 != e2; ++b2){
-
-            BasicBlock *BB2 = &*b2;
-            Blockpair blockpair(BB1,BB2);
-            pair<Blockpair, bool> value(blockpair,false);
-
-            if(BB1==BB2){
-                value.second = true;
-            }
-            
-            connectGraph.insert(value);
-        }
-        
-        //succ check
-        auto TI = BB1->getTerminator();
-        if(TI->getNumSuccessors() == 0)
-            continue;
-        
-        for(BasicBlock *Succ : successors(BB1)){
-            CFGEdge edge = make_pair(TI,Succ);
-            if(edgeIgnoreMap.count(edge) != 0){
-                continue;
-            }
-
-            Blockpair blockpair(BB1,Succ);
-            connectGraph[blockpair] = true;
-        }
-        
-    }
-
-    while(updateConnectGraph(connectGraph,globalblockset)){
-        //OP << "Round again\n";
-    }
-}
-
 bool PairAnalysisPass::checkBlockAToB_Version2(BasicBlock*a, BasicBlock *b,
-    ConnectGraph connectGraph){
+    const ConnectGraph &connectGraph){
     
     if(!a || !b){
         return false;
     }
 
-    Blockpair blockpair(a,b);
-    return connectGraph[blockpair];
+    return connectGraph.reaches(a,b);
 }
 
 //Check if a basic block is a branch block with the help of edgeIgnoreMap
@@ -285,6 +196,7 @@ void PairAnalysisPass::initNormalEdgeMap(Function *F,
     EdgeIgnoreMap errEdgeMap){
 
     normalEdgeMap.clear();
+    std::shared_ptr<FunctionAnalyses> FA = Ctx->FuncAnalyses.get(F);
 
     //Build a CFG with only error edges    
     set<CFGEdge> targetEdgeSet;
@@ -345,7 +257,7 @@ void PairAnalysisPass::initNormalEdgeMap(Function *F,
                     //We need to select one from predblockset to extend the graph
                     //Always choose the longest path
                     else {
-                        predblock = findBottomBlock(predblockset);
+                        predblock = findBottomBlock(predblockset, *FA);
                         if(predblock == NULL)
                             predblock = *(predblockset.begin());
                     }
@@ -388,7 +300,7 @@ void PairAnalysisPass::initNormalEdgeMap(Function *F,
                 if(succblockset.size() == 1)
                     succblock = *(succblockset.begin());
                 else {
-                    succblock = findTopBlock(succblockset);
+                    succblock = findTopBlock(succblockset, *FA);
                 }
                 
                 if(succblock == NULL && succblockset.size() != 0) {
@@ -429,7 +341,7 @@ void PairAnalysisPass::recurFindPaths(std::map<BasicBlock *, SinglePath> &branch
     EdgeIgnoreMap &edgeIgnoreMap,
     std::map<BasicBlock*, int> &indegreeMap,
     BasicBlock *bb,                          //Record current basic block
-    ConnectGraph &connectGraph,     
+    const ConnectGraph &connectGraph,     
     SinglePath &curpath,                      //Record current path (from branch)
     std::vector<PathPairs> &PathGroup){      //Record current path pair group
     
@@ -441,7 +353,7 @@ void PairAnalysisPass::recurFindPaths(std::map<BasicBlock *, SinglePath> &branch
     //Transform BasicBlock to CompoundBlock
     CompoundBlock CB;
     CB.BB = bb;
-    findFunctionCalls(bb,CB.CallFunctionSet);
+    CB.Summary = &connectGraph.getAnalyses().getBlockSummary(bb);
 
     auto TI = bb->getTerminator();
     int NumSucc = TI->getNumSuccessors();
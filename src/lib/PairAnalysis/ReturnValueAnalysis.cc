@@ -38,6 +38,7 @@ using namespace std;
 //#define OPENSSL_RETURN_STYLE
 
 //#define DEBUG_PRINT
+//#define DUMP_ERR_EDGE
 
 // SelectInsts that take error codes
 set<Instruction *>PairAnalysisPass::ErrSelectInstSet;
@@ -578,81 +579,10 @@ void PairAnalysisPass::markBBErr(BasicBlock *BB,
 }
 
 /// Efficiently but inprecisely check if the function may return an
-/// error
+/// error, the walk over its callees is done once by WrapperAnalysis
 bool PairAnalysisPass::mayReturnErr(Function *F) {
 
-	std::set<Function *> PF;
-	std::list<Function *> EF;
-
-	PF.clear();
-	EF.clear();
-	EF.push_back(F);
-
-	while (!EF.empty()) {
-
-		Function *TF = EF.front();
-		EF.pop_front();
-
-		if (PF.count(TF) != 0)
-			continue;
-		PF.insert(TF);
-
-		if (TF->empty())
-			continue;
-
-		for (Function::iterator b = TF->begin(), e = TF->end();
-				b != e; ++b) {
-			BasicBlock *BB = &*b;
-			for (BasicBlock::iterator I = BB->begin(),
-					IE = BB->end(); I != IE; ++I) {
-				StoreInst *SI = dyn_cast<StoreInst>(&*I);
-				if (SI) {
-					Value *SV = SI->getValueOperand();
-					if (isValueErrno(SV, TF)) {
-						return true;
-					}
-					continue;
-				}
-				CallInst *CI = dyn_cast<CallInst>(&*I);
-				if (CI) {
-					Type * Ty= CI->getType();
-					if (Ty->isPointerTy())
-						return true;
-					Function *CF = CI->getCalledFunction();
-					if (!CF)
-						continue;
-					StringRef FName = getCalledFuncName(CI);
-					if (FName == "ERR_PTR" || FName == "PTR_ERR")
-						return true;
-					// Get the actual called function
-					if (Ctx->Callees[CI].size() == 0)
-						continue;
-					CF = *(Ctx->Callees[CI].begin());
-					if (CF) {
-						EF.push_back(CF);
-						continue;
-					}
-
-					continue;
-				}
-				ReturnInst *RI = dyn_cast<ReturnInst>(&*I);
-				if (RI) {
-					Value *RV = RI->getReturnValue();
-					if (!RV)
-						continue;
-					if (CallInst *RCI = dyn_cast<CallInst>(RV)) {
-						if (Ctx->Callees[RCI].size() == 0)
-							continue;
-						Function *RF = *(Ctx->Callees[RCI].begin());
-						if (RF)
-							EF.push_back(RF);
-					}
-					continue;
-				}
-			}
-		}
-	}
-	return false;
+	return Ctx->getFuncSummary(F).MayReturnPairErr;
 }
 
 /// Infer error-handling branch for a condition
@@ -773,9 +703,8 @@ void PairAnalysisPass::checkErrHandle(Function *F,
 					continue;
 				}
 
-				auto FIter = Ctx->ErrorHandleFuncs.find(funcName);
 				// The called function handles an error, so mark the edge
-				if (FIter != Ctx->ErrorHandleFuncs.end()) {
+				if (Ctx->ErrorHandleFuncs.count(funcName)) {
 					markBBErr(BB, Must_Handle_Err, bbErrMap);
 					continue;
 				}
@@ -790,9 +719,7 @@ void PairAnalysisPass::checkErrHandle(Function *F,
 				getSourceCodeLine(CI, line);
 
 				if (regex_search(line, match, pattern)) {
-					auto FIter = Ctx->ErrorHandleFuncs.find(match[0].str());
-
-					if (FIter != Ctx->ErrorHandleFuncs.end()) {
+					if (Ctx->ErrorHandleFuncs.count(match[0].str())) {
 						markBBErr(BB, Must_Handle_Err, bbErrMap);
 						continue;
 					}
@@ -902,6 +829,50 @@ void PairAnalysisPass::markCallCases(Function *F,Value * Cond, EdgeErrMap &edgeE
 
 }
 
+// Mark the CFG with error flags and collect the edges that are on
+// error paths
+void PairAnalysisPass::computeErrorEdges(Function *F, EdgeIgnoreMap &errEdgeMap) {
+
+	//Record the return value of May_Return_Err block
+	map<BasicBlock *,Value *> blockAttributeMap;
+
+	//Return value check
+	BBErrMap bbErrMap;
+	EdgeErrMap edgeErrMap;
+
+	// Find and record basic blocks that set error returning code
+	checkErrReturn(F, bbErrMap, blockAttributeMap);
+	for(auto i = bbErrMap.begin(); i != bbErrMap.end();i++){
+		if(i->second == Not_Return_Err)
+			i->second = May_Return_Err;
+	}
+
+	// Find and record basic blocks that have error handling code
+	Type* return_value_type = F->getReturnType();
+	if(return_value_type->isVoidTy()){
+		checkErrHandle(F, bbErrMap);
+	}
+
+	markAllEdgesErrFlag(F, bbErrMap, edgeErrMap);
+
+	for(auto it = blockAttributeMap.begin(); it != blockAttributeMap.end();it++){
+		markCallCases(F, it->second, edgeErrMap);
+	}
+
+#ifdef DUMP_ERR_EDGE
+	dumpErrEdges(edgeErrMap);
+#endif
+
+	errEdgeMap.clear();
+	for(auto it = edgeErrMap.begin(); it != edgeErrMap.end();it++){
+		CFGEdge edge = it->first;
+
+		//Found an error edge
+		if(!checkEdgeErr(edge,edgeErrMap))
+			errEdgeMap.insert(make_pair(edge,1));
+	}
+}
+
 // Traverse the CFG to mark all edges with an error flag
 // This may need modify
 bool PairAnalysisPass::markAllEdgesErrFlag(Function *F, BBErrMap &bbErrMap, 
@@ -910,6 +881,10 @@ bool PairAnalysisPass::markAllEdgesErrFlag(Function *F, BBErrMap &bbErrMap,
 	if (bbErrMap.size() == 0)
 		return false;
 
+	// The only marking for error-handling cases, it does not depend on
+	// the return flags
+	markErrHandleEdges(F, bbErrMap, edgeErrMap);
+
 	// Recursively mark flags
 	for (Function::iterator b = F->begin(), e = F->end();
 			b != e; ++b) {
@@ -922,10 +897,6 @@ bool PairAnalysisPass::markAllEdgesErrFlag(Function *F, BBErrMap &bbErrMap,
 
 		// Upon error-related operations, update edges
 		int NewFlag = bbErrMap[BB];
-		// The only marking for error-handling cases
-		if (NewFlag & Must_Handle_Err) {
-			recurMarkEdgesToErrHandle(BB, edgeErrMap);
-		}
 
 		// Marking error-returning cases
 		if ((NewFlag & ERR_RETURN_MASK)) {
@@ -948,40 +919,36 @@ bool PairAnalysisPass::markAllEdgesErrFlag(Function *F, BBErrMap &bbErrMap,
 	return true;
 }
 
-/// Recursively mark edges from the error-handling block to the
-/// closest branches
-void PairAnalysisPass::recurMarkEdgesToErrHandle(BasicBlock *BB, 
-		EdgeErrMap &edgeErrMap) {
-	// Invalid input.
-	if (!BB)
-		return;
-
-	std::set<BasicBlock *> PB;
-	std::list<BasicBlock *> EB;
-	PB.clear();
-	EB.clear();
+/// Mark edges from the error-handling blocks to the closest branches:
+/// an edge is marked if its target handles the error or reaches an
+/// error-handling block through blocks that do not branch
+void PairAnalysisPass::markErrHandleEdges(Function *F, 
+		BBErrMap &bbErrMap, EdgeErrMap &edgeErrMap) {
 
-	EB.push_back(BB);
-	while (!EB.empty()) {
+	std::shared_ptr<FunctionAnalyses> FA = Ctx->FuncAnalyses.get(F);
+	const CFGEdgeIndex &Edges = FA->getEdgeIndex();
 
-		BasicBlock *TB = EB.front();
-		EB.pop_front();
-		if (PB.count(TB) != 0)
-			continue;
-		PB.insert(TB);
-		// Iterate on each predecessor basic block.
-		for (BasicBlock *predBB : predecessors(TB)) {
-			Instruction *TI = predBB->getTerminator();	
-			CFGEdge CE = std::make_pair(TI, TB);
-			int NewHandleFlag = Must_Handle_Err;
-			if (edgeErrMap[CE] & NewHandleFlag)
-				continue;
-			updateHandleFlag(edgeErrMap[CE], NewHandleFlag);
+	std::vector<bool> Handled(Edges.getNumEdges(), false);
+	solveEdgeDataflow(Edges, DataflowDirection::Backward, Handled,
+		[&](unsigned B, const std::vector<bool> &Values) {
+			BasicBlock *BB = FA->getBlock(B);
+			auto It = bbErrMap.find(BB);
+			if (It != bbErrMap.end() && (It->second & Must_Handle_Err))
+				return true;
 			// reaches a branch, stop
-			if (TI->getNumSuccessors() > 1)
-				continue;
-			EB.push_back(predBB);
-		}
+			if (BB->getTerminator()->getNumSuccessors() > 1)
+				return false;
+			for (unsigned E : Edges.getOutEdges(B)) {
+				if (Values[E])
+					return true;
+			}
+			return false;
+		});
+
+	int NewHandleFlag = Must_Handle_Err;
+	for (unsigned E = 0; E < Edges.getNumEdges(); ++E) {
+		if (Handled[E])
+			updateHandleFlag(edgeErrMap[Edges.getEdge(E)], NewHandleFlag);
 	}
 }
 
@@ -1244,14 +1211,15 @@ void PairAnalysisPass::dumpErrEdges(EdgeErrMap &edgeErrMap) {
 
 //Return true if this edge is Not_Return_Err
 //Return false if this edge returns err
-bool PairAnalysisPass::checkEdgeErr(CFGEdge edge, EdgeErrMap edgeErrMap){
+bool PairAnalysisPass::checkEdgeErr(CFGEdge edge, const EdgeErrMap &edgeErrMap){
 
 	//Not tagged, this should be Not_Return_Err
-	if(edgeErrMap.count(edge)==0){
+	auto it = edgeErrMap.find(edge);
+	if(it == edgeErrMap.end()){
 		return true;
 	}
 
-	int flag = edgeErrMap[edge];
+	int flag = it->second;
 	int err_return_flag = flag & ERR_RETURN_MASK;
 	int err_handle_flag = flag & ERR_HANDLE_MASK;
 
@@ -2,7 +2,12 @@
 #include <llvm/IR/Function.h>
 #include <llvm/IR/InstIterator.h>
 #include <llvm/IR/LegacyPassManager.h>
+#include <llvm/IR/ModuleSlotTracker.h>
 #include <llvm/Analysis/MemoryLocation.h>
+#include <llvm/Analysis/ValueTracking.h>
+#include <llvm/ADT/DenseSet.h>
+
+#include <algorithm>
 
 #include "PointerAnalysis.h"
 #include "Tools.h"
@@ -11,6 +16,7 @@
 
 /// Alias types used to do pointer analysis.
 #define MUST_ALIAS
+//#define PRINT_ALIAS_PAIRS
 
 bool PointerAnalysisPass::doInitialization(Module *M) {
     return false;
@@ -20,21 +26,98 @@ bool PointerAnalysisPass::doFinalization(Module *M) {
     return false;
 }
 
+/// Whether To is Ty or the type of its first member, recursively, as a
+/// pointer to a struct or an array also points to its first member.
+static bool isPrefixType(Type *Ty, Type *To) {
+
+    while (Ty != To) {
+        if (StructType *STy = dyn_cast<StructType>(Ty)) {
+            if (STy->isOpaque() || STy->getNumElements() == 0)
+                return false;
+            Ty = STy->getElementType(0);
+        }
+        else if (ArrayType *ATy = dyn_cast<ArrayType>(Ty))
+            Ty = ATy->getElementType();
+        else
+            return false;
+    }
+    return true;
+}
+
+/// Whether pointers to these types may point to the same memory: char
+/// and types of unknown layout alias anything, other types only alias
+/// themselves and the structs and arrays they start.
+static bool mayAliasTypes(Type *Ty1, Type *Ty2) {
+
+    if (Ty1 == Ty2)
+        return true;
+    if (Ty1->isIntegerTy(8) || Ty2->isIntegerTy(8))
+        return true;
+    if (!Ty1->isSized() || !Ty2->isSized())
+        return true;
+    return isPrefixType(Ty1, Ty2) || isPrefixType(Ty2, Ty1);
+}
+
 /// Detect aliased pointers in this function.
+/// Pointers are grouped by underlying object: two different identified
+/// objects never alias, so pointers into different objects are only
+/// queried when one of the objects is unidentified. Such pointers are
+/// further split by pointee type and only queried when the types are
+/// compatible. Each pair is queried once.
 void PointerAnalysisPass::detectAliasPointers(Function *F,
     AAResults &AAR,
     PointerAnalysisMap &aliasPtrs) {
     
-    std::set<AddrMemPair> addrSet; //pair<Value *, MemoryLocation *>
-    Value *Addr1, *Addr2;
-    MemoryLocation *MemLoc1, *MemLoc2;
+    const DataLayout &DL = F->getParent()->getDataLayout();
+    std::vector<AddrMemPair> addrs; //pair<Value *, MemoryLocation>
+    DenseSet<AddrMemPair> addrSet;
     std::set<Value*> DstSet, LPSet;
 
-    DstSet.clear();
-    LPSet.clear();
-    addrSet.clear();
+    //Pointers of each underlying object
+    std::vector<std::vector<unsigned>> groups;
+    std::vector<bool> groupIdentified;
+    DenseMap<const Value *, unsigned> groupOf;
+    std::vector<unsigned> addrGroup;
+
+    //Pointee type of each pointer, and the pointers into unidentified
+    //objects of each type
+    std::vector<Type *> types;
+    DenseMap<Type *, unsigned> typeOf;
+    std::vector<unsigned> addrType;
+    std::vector<std::vector<unsigned>> unidentified;
+
     aliasPtrs.clear();
 
+    auto addAddr = [&](Value *Addr, const MemoryLocation &MemLoc) {
+        //The same location gives the same answers
+        if (!addrSet.insert(std::make_pair(Addr, MemLoc)).second)
+            return;
+
+        const Value *Obj = GetUnderlyingObject(Addr, DL);
+        auto git = groupOf.find(Obj);
+        if (git == groupOf.end()) {
+            git = groupOf.insert(std::make_pair(Obj, groups.size())).first;
+            groups.emplace_back();
+            groupIdentified.push_back(isIdentifiedObject(Obj));
+        }
+
+        Type *Ty = Addr->getType()->getPointerElementType();
+        auto tit = typeOf.find(Ty);
+        if (tit == typeOf.end()) {
+            tit = typeOf.insert(std::make_pair(Ty, types.size())).first;
+            types.push_back(Ty);
+            unidentified.emplace_back();
+        }
+
+        unsigned idx = addrs.size();
+        groups[git->second].push_back(idx);
+        if (!groupIdentified[git->second])
+            unidentified[tit->second].push_back(idx);
+        addrGroup.push_back(git->second);
+        addrType.push_back(tit->second);
+        addrs.push_back(std::make_pair(Addr, MemLoc));
+    };
+
     // Scan instructions to extract all pointers.
     for (inst_iterator i = inst_begin(F), ei = inst_end(F); i != ei; ++i) {
         Instruction *iInst = dyn_cast<Instruction>(&*i);
@@ -44,27 +127,18 @@ void PointerAnalysisPass::detectAliasPointers(Function *F,
         CallBase *CB = dyn_cast<CallBase>(iInst);   //This line is changed
 
         if (LI) {
-            MemLoc1 = new MemoryLocation();
-            *MemLoc1 = MemoryLocation::get(LI);
-            addrSet.insert(std::make_pair(LI->getPointerOperand(),
-                                            MemLoc1));
+            addAddr(LI->getPointerOperand(), MemoryLocation::get(LI));
             LPSet.insert(LI->getPointerOperand());
         } 
         else if (SI) {
-            MemLoc1 = new MemoryLocation();
-            *MemLoc1 = MemoryLocation::get(SI);
-            addrSet.insert(std::make_pair(SI->getPointerOperand(),
-                                            MemLoc1));
+            addAddr(SI->getPointerOperand(), MemoryLocation::get(SI));
         } 
         else if (CB) {
             //ImmutableCallSite CS(CI);
             //CallBase CS(iInst);
 
             //Ignore debug functions
-            StringRef FName = getCalledFuncName(CB);
-            if (Ctx->DebugFuncs.count(FName) == 1)
-                continue;
-            if (FName.contains("err") || FName.contains("ERR"))
+            if (Ctx->CalleeClasses.get(CB) & (CC_Debug | CC_AnyErr))
                 continue;
             
             //OP<<"CB: "<<*CB<<"\n";
@@ -77,9 +151,7 @@ void PointerAnalysisPass::detectAliasPointers(Function *F,
                 if (!Arg->getType()->isPointerTy())
                     continue;
 
-                MemLoc1 = new MemoryLocation();
-                *MemLoc1 = MemoryLocation::getForArgument(CB, j, *TLI);
-                addrSet.insert(std::make_pair(Arg, MemLoc1));
+                addAddr(Arg, MemoryLocation::getForArgument(CB, j, *TLI));
 
                 Function *CF = CB->getCalledFunction();
                 if (CF && CF->getName() == "copy_from_user" && j < 2)  
@@ -88,77 +160,104 @@ void PointerAnalysisPass::detectAliasPointers(Function *F,
         }
     }
 
-    for (std::set<AddrMemPair>::iterator it1 = addrSet.begin(),
-        it1e = addrSet.end(); it1 != it1e; ++it1) {
-        Addr1 = it1->first;
-        MemLoc1 = it1->second;
-
-        for (std::set<AddrMemPair>::iterator it2 = addrSet.begin(),
-            it2e = addrSet.end(); it2 != it2e; ++it2) {
-            if (it2 == it1)
-                continue;
-
-            Addr2 = it2->first;
-            MemLoc2 = it2->second;
-
-            if (Addr1 == Addr2)
-                continue;
-
-            //Compare different pointers
-            AliasResult AResult = AAR.alias(*MemLoc1, *MemLoc2);
-            if (AResult == MustAlias || AResult == PartialAlias) {
-                OP <<"Addr1: "<<*Addr1<<"\n";
-                OP <<"Addr2: "<<*Addr2<<"\n\n";
-            }
+    //The answer and the filters below are symmetric, so a pair is
+    //queried once and recorded in both directions
+    auto queryPair = [&](unsigned idx1, unsigned idx2) {
+        Value *Addr1 = addrs[idx1].first;
+        Value *Addr2 = addrs[idx2].first;
+
+        if (Addr1 == Addr2)
+            return;
+
+        //Compare different pointers
+        AliasResult AResult = AAR.alias(addrs[idx1].second, addrs[idx2].second);
+#ifdef PRINT_ALIAS_PAIRS
+        if (AResult == MustAlias || AResult == PartialAlias) {
+            OP <<"Addr1: "<<*Addr1<<"\n";
+            OP <<"Addr2: "<<*Addr2<<"\n\n";
+        }
+#endif
 
 #ifdef MUST_ALIAS
-            if (AResult != MustAlias && AResult != PartialAlias) {
+        if (AResult != MustAlias && AResult != PartialAlias) {
 #else
-		    if (AResult == NoAlias) {
+        if (AResult == NoAlias) {
 #endif
-                bool flag = true;
+            bool flag = true;
+
+            if (AResult == MayAlias) {
+                CallInst *CI;
+
+                CI = dyn_cast<CallInst>(Addr1);
+                if (CI && (Ctx->CalleeClasses.get(CI) & CC_Kmalloc))
+                    flag = false;
+
+                CI = dyn_cast<CallInst>(Addr2);
+                if (CI && (Ctx->CalleeClasses.get(CI) & CC_Kmalloc))
+                    flag = false;
+
+                //Hack for copy_from_user - dst and SCheck
+                if (DstSet.find(Addr1) != DstSet.end() && 
+                    LPSet.find(Addr2) != LPSet.end())
+                        flag = false;
+                if (DstSet.find(Addr2) != DstSet.end() &&
+                    LPSet.find(Addr1) != LPSet.end())
+                        flag = false;
+                if (DstSet.find(Addr1) != DstSet.end() && 
+                    DstSet.find(Addr2) !=  DstSet.end())
+                        flag = false;
+            }
 
-                if (AResult == MayAlias) {
-                    CallInst *CI;
+            if (flag)
+                return;
+        }
 
-                    CI = dyn_cast<CallInst>(Addr1);
-                    if (CI) {
-                        StringRef FName = getCalledFuncName(CI);
-                        if (FName.contains("kmalloc"))
-                            flag = false;
-                    }
+        aliasPtrs[Addr1].insert(Addr2);
+        aliasPtrs[Addr2].insert(Addr1);
+    };
 
-                    CI = dyn_cast<CallInst>(Addr2);
-                    if (CI) {
-                        StringRef FName = getCalledFuncName(CI);
-                        if (FName.contains("kmalloc"))
-                            flag = false;
-                    }
+    //Pointers into the same object
+    for (std::vector<unsigned> &group : groups) {
+        for (unsigned x = 0; x < group.size(); ++x) {
+            for (unsigned y = x + 1; y < group.size(); ++y)
+                queryPair(group[x], group[y]);
+        }
+    }
 
-                    //Hack for copy_from_user - dst and SCheck
-                    if (DstSet.find(Addr1) != DstSet.end() && 
-                        LPSet.find(Addr2) != LPSet.end())
-                            flag = false;
-                    if (DstSet.find(Addr2) != DstSet.end() &&
-                        LPSet.find(Addr1) != LPSet.end())
-                            flag = false;
-                    if (DstSet.find(Addr1) != DstSet.end() && 
-                        DstSet.find(Addr2) !=  DstSet.end())
-                            flag = false;
-                }
+    //Pointers into different objects, at least one of them unidentified
+    std::vector<bool> compatible(types.size() * types.size());
+    for (unsigned t1 = 0; t1 < types.size(); ++t1) {
+        for (unsigned t2 = t1; t2 < types.size(); ++t2) {
+            bool c = mayAliasTypes(types[t1], types[t2]);
+            compatible[t1 * types.size() + t2] = c;
+            compatible[t2 * types.size() + t1] = c;
+        }
+    }
 
-                if (flag)
+    for (unsigned g = 0; g < groups.size(); ++g) {
+        if (!groupIdentified[g])
+            continue;
+        for (unsigned x : groups[g]) {
+            for (unsigned t = 0; t < types.size(); ++t) {
+                if (!compatible[addrType[x] * types.size() + t])
                     continue;
+                for (unsigned y : unidentified[t])
+                    queryPair(x, y);
             }
+        }
+    }
 
-            auto as = aliasPtrs.find(Addr1);
-            if (as == aliasPtrs.end()) {
-                std::set<Value *> sv;
-                sv.clear();
-                sv.insert(Addr2);
-                aliasPtrs[Addr1] = sv;
-            } else if (as->second.count(Addr2) == 0) {
-                as->second.insert(Addr2);
+    for (unsigned t1 = 0; t1 < types.size(); ++t1) {
+        for (unsigned t2 = t1; t2 < types.size(); ++t2) {
+            if (!compatible[t1 * types.size() + t2])
+                continue;
+            std::vector<unsigned> &ptrs1 = unidentified[t1];
+            std::vector<unsigned> &ptrs2 = unidentified[t2];
+            for (unsigned x = 0; x < ptrs1.size(); ++x) {
+                for (unsigned y = (t1 == t2 ? x + 1 : 0); y < ptrs2.size(); ++y) {
+                    if (addrGroup[ptrs1[x]] != addrGroup[ptrs2[y]])
+                        queryPair(ptrs1[x], ptrs2[y]);
+                }
             }
         }
     }
@@ -191,16 +290,14 @@ void PointerAnalysisPass::detectAliasPointers_new(Function *F,
 
         CallInst *CAI = dyn_cast<CallInst>(iInst);
         if (CAI){
-            StringRef FName = getCalledFuncName(CAI);
+            uint32_t Categories = Ctx->CalleeClasses.get(CAI);
 
             //Ignore debug functions
-            if (Ctx->DebugFuncs.count(FName) == 1)
-                continue;
-            if (FName.contains("err") || FName.contains("ERR"))
+            if (Categories & (CC_Debug | CC_AnyErr))
                 continue;
 
             //Resolve data transfer functions
-            if (FName.contains("_get_drvdata")) {
+            if (Categories & CC_GetDrvdata) {
                 Value *arg = CAI->getArgOperand(0);
                 structRelations[arg].insert(CAI);
                 ptrset.insert(CAI);
@@ -208,14 +305,14 @@ void PointerAnalysisPass::detectAliasPointers_new(Function *F,
 
                 continue;
             }
-            if (FName.contains("_set_drvdata")) {
+            if (Categories & CC_SetDrvdata) {
                 Value *dev = CAI->getArgOperand(0);
                 Value *data = CAI->getArgOperand(1);
                 structRelations[dev].insert(data);
                 ptrset.insert(CAI);
                 continue;
             }
-            if (FName.contains("copy_from_user") || FName.contains("copy_to_user")) {
+            if (Categories & CC_CopyUser) {
                 Value *dst = CAI->getArgOperand(0);
                 Value *source = CAI->getArgOperand(1);
                 aliasPtrs[dst].insert(source);
@@ -400,6 +497,13 @@ void PointerAnalysisPass::detectStructRelation_new(Function *F,
 
     map<Value*,StructNode*> globalrecord;
 
+    //Nodes are shared between values, free them all at the end
+    vector<unique_ptr<StructNode>> nodepool;
+    auto newNode = [&nodepool](){
+        nodepool.emplace_back(new StructNode());
+        return nodepool.back().get();
+    };
+
     for (inst_iterator i = inst_begin(F), ei = inst_end(F); i != ei; ++i) {
         Instruction *iInst = dyn_cast<Instruction>(&*i);
 
@@ -411,7 +515,7 @@ void PointerAnalysisPass::detectStructRelation_new(Function *F,
             stnode = globalrecord[iInst];
         }
         else {
-            stnode = new StructNode();
+            stnode = newNode();
             globalrecord[iInst] = stnode;
         }
 
@@ -517,7 +621,7 @@ void PointerAnalysisPass::detectStructRelation_new(Function *F,
             if(isConstant(vop))
                 continue;
 
-            StructNode* popNode = new StructNode();
+            StructNode* popNode = newNode();
             if(globalrecord.count(pop)!=0){
                 popNode = globalrecord[pop];
             }
@@ -525,7 +629,7 @@ void PointerAnalysisPass::detectStructRelation_new(Function *F,
                 popNode->insert_member(pop);
             }
 
-            StructNode* vopNode = new StructNode();
+            StructNode* vopNode = newNode();
             if(globalrecord.count(vop)!= 0){
                 vopNode = globalrecord[vop];
             }
@@ -546,7 +650,7 @@ void PointerAnalysisPass::detectStructRelation_new(Function *F,
 
             Value *ParrentValue = GEP->getPointerOperand();
 
-            StructNode* pnode = new StructNode();
+            StructNode* pnode = newNode();
             if(globalrecord.count(ParrentValue) != 0)
                 pnode = globalrecord[ParrentValue];
             else {
@@ -593,8 +697,25 @@ void PointerAnalysisPass::detectStructRelation_new(Function *F,
 }
 
 bool PointerAnalysisPass::doModulePass(Module *M) {
-    // Save TargetLibraryInfo.
 
+    prepareModule(M);
+
+    for (Module::iterator f = M->begin(), fe = M->end();
+        f != fe; ++f) {
+        analyzeFunction(&*f);
+    }
+
+    return false;
+}
+
+void PointerAnalysisPass::prepareModule(Module *M) {
+
+    // No checker queries alias pointers at the moment, so alias
+    // analysis is only set up on request
+    if (!AliasQueries)
+        return;
+
+    // Save TargetLibraryInfo.
     Triple ModuleTriple(M->getTargetTriple());
     TargetLibraryInfoImpl TLII(ModuleTriple);
     TLI = new TargetLibraryInfo(TLII);
@@ -611,42 +732,88 @@ bool PointerAnalysisPass::doModulePass(Module *M) {
         if (F.isDeclaration())
             continue;
 
+        if (Ctx->DuplicateFuncs.count(&F))
+            continue;
+
         FPasses->run(F);
     }
     FPasses->doFinalization();
 
     // Basic alias analysis result.
-    AAResults &AAR = AARPass->getAAResults();
+    AAR = &AARPass->getAAResults();
+}
 
-    for (Module::iterator f = M->begin(), fe = M->end();
-        f != fe; ++f) {
-        Function *F = &*f;
-        PointerAnalysisMap aliasPtrs; //map<llvm::Value *, std::set<llvm::Value *>>
-        PointerAnalysisMap structRelations;
+// Struct relations are computed on demand by getStructRelations
+void PointerAnalysisPass::analyzeFunction(Function *F) {
+
+    if (!AliasQueries)
+        return;
+
+    PointerAnalysisMap aliasPtrs; //map<llvm::Value *, std::set<llvm::Value *>>
+    PointerAnalysisMap structRelations;
 
 #ifdef TEST_ONE_CASE
-        if (F->getName()!= TEST_ONE_CASE)
-            continue;
+    if (F->getName()!= TEST_ONE_CASE)
+        return;
 #endif
 
-        if (F->empty())
-            continue;
-        
-        // Only consider security operation related functions
-        //if (Ctx->SecurityOperationSets.count(F) == 0)
-        //    continue;
+    if (F->empty())
+        return;
 
-        //detectAliasPointers(F, AAR, aliasPtrs);
-        //detectAliasPointers_new(F, AAR, aliasPtrs, structRelations);
-        //detectStructRelation(F, structRelations);
-        detectStructRelation_new(F, structRelations);
+    if (Ctx->DuplicateFuncs.count(F))
+        return;
 
-        // Save pointer analysis result.
-        Ctx->FuncPAResults[F] = aliasPtrs;
-        Ctx->FuncAAResults[F] = &AAR;
+    detectAliasPointers(F, *AAR, aliasPtrs);
+    //detectAliasPointers_new(F, *AAR, aliasPtrs, structRelations);
 
-        Ctx->FuncStructResults[F] = structRelations;
+    if (VerboseLevel >= 2)
+        printAliasPointers(F, aliasPtrs);
+
+    // Save pointer analysis result.
+    Ctx->FuncPAResults[F] = aliasPtrs;
+    Ctx->FuncAAResults[F] = AAR;
+}
+
+/// Print one line per pointer with aliases, sorted so that runs can be
+/// compared: "[Alias] <function>: <pointer> -> <aliases>"
+void PointerAnalysisPass::printAliasPointers(Function *F,
+    PointerAnalysisMap &aliasPtrs) {
+
+    ModuleSlotTracker MST(F->getParent());
+    MST.incorporateFunction(*F);
+    auto getOperand = [&](Value *V) {
+        std::string Str;
+        raw_string_ostream OS(Str);
+        V->printAsOperand(OS, false, MST);
+        return OS.str();
+    };
+
+    std::vector<std::string> Lines;
+    for (auto &Entry : aliasPtrs) {
+        std::vector<std::string> Aliases;
+        for (Value *V : Entry.second)
+            Aliases.push_back(getOperand(V));
+        std::sort(Aliases.begin(), Aliases.end());
+
+        std::string Line = "[Alias] " + F->getName().str() + ": "
+            + getOperand(Entry.first) + " ->";
+        for (std::string &A : Aliases)
+            Line += " " + A;
+        Lines.push_back(Line + "\n");
     }
+    std::sort(Lines.begin(), Lines.end());
 
-    return false;
+    std::string Out;
+    for (std::string &Line : Lines)
+        Out += Line;
+    OP << Out;
+}
+
+const PointerAnalysisMap &PointerAnalysisPass::getStructRelations(
+    FunctionAnalyses &FA) {
+
+    return FA.getStructRelations([&](PointerAnalysisMap &structRelations){
+        //detectStructRelation(FA.getFunction(), structRelations);
+        detectStructRelation_new(FA.getFunction(), structRelations);
+    });
 }
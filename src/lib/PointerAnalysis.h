@@ -3,10 +3,13 @@
 
 #include "Analyzer.h"
 
+// Compute the alias pointers of each function (-alias-queries)
+extern cl::opt<bool> AliasQueries;
+
 
 class PointerAnalysisPass : public IterativeModulePass {
 
-    typedef std::pair<Value *, MemoryLocation *> AddrMemPair;
+    typedef std::pair<Value *, MemoryLocation> AddrMemPair;
 
     typedef struct StructNode {
         
@@ -44,6 +47,7 @@ class PointerAnalysisPass : public IterativeModulePass {
     
     private:
         TargetLibraryInfo *TLI;
+        AAResults *AAR = NULL;
 
         void detectAliasPointers(Function *, AAResults &,
                                 PointerAnalysisMap &);
@@ -52,6 +56,8 @@ class PointerAnalysisPass : public IterativeModulePass {
                                 PointerAnalysisMap &,
                                 PointerAnalysisMap &);
 
+        void printAliasPointers(Function *F, PointerAnalysisMap &);
+
         void detectStructRelation(Function *F, PointerAnalysisMap &);
         void detectStructRelation_new(Function *F, PointerAnalysisMap &);
 
@@ -61,6 +67,15 @@ class PointerAnalysisPass : public IterativeModulePass {
         virtual bool doInitialization(llvm::Module *);
         virtual bool doFinalization(llvm::Module *);
         virtual bool doModulePass(llvm::Module *);
+
+        // Set up alias analysis for M, then run the pass on its
+        // functions one at a time (fused pipeline)
+        void prepareModule(llvm::Module *M);
+        void analyzeFunction(Function *F);
+
+        // Struct relations of the function of FA, computed on the first
+        // query and kept with its other analyses
+        const PointerAnalysisMap &getStructRelations(FunctionAnalyses &FA);
 };
 
 #endif
@@ -45,9 +45,6 @@ using namespace std;
 //#define TEST_ONE_CASE "uac_clock_source_is_valid"
 //#define SHOW_SECURITY_CHECK
 
-// SelectInsts that take error codes
-set<Instruction *>SecurityChecksPass::ErrSelectInstSet;
-
 /// Check if the value is an errno.
 bool SecurityChecksPass::isValueErrno(Value *V, Function *F) {
 	// Invalid input.
@@ -154,8 +151,7 @@ void SecurityChecksPass::findErrorCodes(Function *F) {
 			continue;
 
 		StringRef FName = getCalledFuncName(CI);
-		auto FIter = Ctx->ErrorHandleFuncs.find(FName.str());
-		if (FIter == Ctx->ErrorHandleFuncs.end()) 
+		if (!Ctx->ErrorHandleFuncs.count(FName))
 			continue;
 
 		// collect storeinst
@@ -413,40 +409,36 @@ void SecurityChecksPass::recurMarkEdgesToBlock(CFGEdge &CE, int flag,
 	}
 }
 
-/// Recursively mark edges from the error-handling block to the
-/// closest branches
-void SecurityChecksPass::recurMarkEdgesToErrHandle(BasicBlock *BB, 
-		EdgeErrMap &edgeErrMap) {
-	// Invalid input.
-	if (!BB)
-		return;
+/// Mark edges from the error-handling blocks to the closest branches:
+/// an edge is marked if its target handles the error or reaches an
+/// error-handling block through blocks that do not branch
+void SecurityChecksPass::markErrHandleEdges(Function *F, 
+		BBErrMap &bbErrMap, EdgeErrMap &edgeErrMap) {
 
-	std::set<BasicBlock *> PB;
-	std::list<BasicBlock *> EB;
-	PB.clear();
-	EB.clear();
+	std::shared_ptr<FunctionAnalyses> FA = Ctx->FuncAnalyses.get(F);
+	const CFGEdgeIndex &Edges = FA->getEdgeIndex();
 
-	EB.push_back(BB);
-	while (!EB.empty()) {
-
-		BasicBlock *TB = EB.front();
-		EB.pop_front();
-		if (PB.count(TB) != 0)
-			continue;
-		PB.insert(TB);
-		// Iterate on each predecessor basic block.
-		for (BasicBlock *predBB : predecessors(TB)) {
-			Instruction *TI = predBB->getTerminator();	
-			CFGEdge CE = std::make_pair(TI, TB);
-			int NewHandleFlag = Must_Handle_Err;
-			if (edgeErrMap[CE] & NewHandleFlag)
-				continue;
-			updateHandleFlag(edgeErrMap[CE], NewHandleFlag);
+	std::vector<bool> Handled(Edges.getNumEdges(), false);
+	solveEdgeDataflow(Edges, DataflowDirection::Backward, Handled,
+		[&](unsigned B, const std::vector<bool> &Values) {
+			BasicBlock *BB = FA->getBlock(B);
+			auto It = bbErrMap.find(BB);
+			if (It != bbErrMap.end() && (It->second & Must_Handle_Err))
+				return true;
 			// reaches a branch, stop
-			if (TI->getNumSuccessors() > 1)
-				continue;
-			EB.push_back(predBB);
-		}
+			if (BB->getTerminator()->getNumSuccessors() > 1)
+				return false;
+			for (unsigned E : Edges.getOutEdges(B)) {
+				if (Values[E])
+					return true;
+			}
+			return false;
+		});
+
+	int NewHandleFlag = Must_Handle_Err;
+	for (unsigned E = 0; E < Edges.getNumEdges(); ++E) {
+		if (Handled[E])
+			updateHandleFlag(edgeErrMap[Edges.getEdge(E)], NewHandleFlag);
 	}
 }
 
@@ -505,6 +497,10 @@ bool SecurityChecksPass::markAllEdgesErrFlag(Function *F, BBErrMap &bbErrMap,
 	if (bbErrMap.size() == 0)
 		return false;
 
+	// The only marking for error-handling cases, it does not depend on
+	// the return flags
+	markErrHandleEdges(F, bbErrMap, edgeErrMap);
+
 	// Recursively mark flags
 	for (Function::iterator b = F->begin(), e = F->end();
 			b != e; ++b) {
@@ -517,10 +513,6 @@ bool SecurityChecksPass::markAllEdgesErrFlag(Function *F, BBErrMap &bbErrMap,
 
 		// Upon error-related operations, update edges
 		int NewFlag = bbErrMap[BB];
-		// The only marking for error-handling cases
-		if (NewFlag & Must_Handle_Err) {
-			recurMarkEdgesToErrHandle(BB, edgeErrMap);
-		}
 
 		// Marking error-returning cases
 		if ((NewFlag & ERR_RETURN_MASK)) {
@@ -544,88 +536,18 @@ bool SecurityChecksPass::markAllEdgesErrFlag(Function *F, BBErrMap &bbErrMap,
 }
 
 /// Efficiently but inprecisely check if the function may return an
-/// error
+/// error, the walk over its callees is done once by WrapperAnalysis
 bool SecurityChecksPass::mayReturnErr(Function *F) {
 
-	std::set<Function *> PF;
-	std::list<Function *> EF;
-
-	PF.clear();
-	EF.clear();
-	EF.push_back(F);
-
-	while (!EF.empty()) {
-
-		Function *TF = EF.front();
-		EF.pop_front();
-
-		if (PF.count(TF) != 0)
-			continue;
-		PF.insert(TF);
-
-		if (TF->empty())
-			continue;
-
-		for (Function::iterator b = TF->begin(), e = TF->end();
-				b != e; ++b) {
-			BasicBlock *BB = &*b;
-			for (BasicBlock::iterator I = BB->begin(),
-					IE = BB->end(); I != IE; ++I) {
-				StoreInst *SI = dyn_cast<StoreInst>(&*I);
-				if (SI) {
-					Value *SV = SI->getValueOperand();
-					if (isValueErrno(SV, TF)) {
-						return true;
-					}
-					continue;
-				}
-				CallInst *CI = dyn_cast<CallInst>(&*I);
-				if (CI) {
-					Type * Ty= CI->getType();
-					if (Ty->isPointerTy())
-						return true;
-					Function *CF = CI->getCalledFunction();
-					if (!CF)
-						continue;
-					StringRef FName = getCalledFuncName(CI);
-					if (FName == "ERR_PTR" || FName == "PTR_ERR")
-						return true;
-					// Get the actual called function
-					if (Ctx->Callees[CI].size() == 0)
-						continue;
-					CF = *(Ctx->Callees[CI].begin());
-					if (CF) {
-						EF.push_back(CF);
-						continue;
-					}
-
-					continue;
-				}
-				ReturnInst *RI = dyn_cast<ReturnInst>(&*I);
-				if (RI) {
-					Value *RV = RI->getReturnValue();
-					if (!RV)
-						continue;
-					if (CallInst *RCI = dyn_cast<CallInst>(RV)) {
-						if (Ctx->Callees[RCI].size() == 0)
-							continue;
-						Function *RF = *(Ctx->Callees[RCI].begin());
-						if (RF)
-							EF.push_back(RF);
-					}
-					continue;
-				}
-			}
-		}
-	}
-	return false;
+	return Ctx->getFuncSummary(F).MayReturnErr;
 }
 
 /// Check if the returned value must be or may be an errno.
 /// And mark the traversed edges in the CFG.
 void SecurityChecksPass::checkErrReturn(Function *F, 
 		BBErrMap &bbErrMap,
-		std::map<BasicBlock *,Value *> &blockAttributeMap) {
+		std::map<BasicBlock *,Value *> &blockAttributeMap,
+		set<Instruction *> &errSelectInstSet) {
 
 	// Check all return instructions in this function and mark
 	// edges that are sure to return an errno.
@@ -640,8 +562,9 @@ void SecurityChecksPass::checkErrReturn(Function *F,
 			continue;
 
 		// Backtrack returned value
-		//checkErrValueFlow(F, RI, PV, bbErrMap);
-		checkErrValueFlow_new(F, RI, PV, bbErrMap, blockAttributeMap);
+		//checkErrValueFlow(F, RI, PV, bbErrMap, errSelectInstSet);
+		checkErrValueFlow_new(F, RI, PV, bbErrMap, blockAttributeMap,
+				errSelectInstSet);
 	}
 
 	return;
@@ -669,9 +592,8 @@ void SecurityChecksPass::checkErrHandle(Function *F,
 				if (FuncName.endswith("printk")) 
 					funcName = getSourceFuncName(CI);
 
-				auto FIter = Ctx->ErrorHandleFuncs.find(funcName);
 				// The called function handles an error, so mark the edge
-				if (FIter != Ctx->ErrorHandleFuncs.end()) {
+				if (Ctx->ErrorHandleFuncs.count(funcName)) {
 					markBBErr(BB, Must_Handle_Err, bbErrMap);
 					continue;
 				}
@@ -686,9 +608,7 @@ void SecurityChecksPass::checkErrHandle(Function *F,
 				getSourceCodeLine(CI, line);
 
 				if (regex_search(line, match, pattern)) {
-					auto FIter = Ctx->ErrorHandleFuncs.find(match[0].str());
-
-					if (FIter != Ctx->ErrorHandleFuncs.end()) {
+					if (Ctx->ErrorHandleFuncs.count(match[0].str())) {
 						markBBErr(BB, Must_Handle_Err, bbErrMap);
 						continue;
 					}
@@ -838,8 +758,10 @@ void SecurityChecksPass::identifySecurityChecks(Function *F,
 
 	map<BasicBlock *,Value *> blockAttributeMap;
     blockAttributeMap.clear();
+	// SelectInsts of F that take error codes
+	set<Instruction *> errSelectInstSet;
 	// Find and record basic blocks that set error returning code
-	checkErrReturn(F, bbErrMap, blockAttributeMap);
+	checkErrReturn(F, bbErrMap, blockAttributeMap, errSelectInstSet);
 	for(auto i = bbErrMap.begin(); i != bbErrMap.end();i++){
         BasicBlock* bb = i->first;
         int CV = i->second;
@@ -879,7 +801,7 @@ void SecurityChecksPass::identifySecurityChecks(Function *F,
 
 	// Filtering
 	if (edgeErrMap.size() == 0 	&& 
-			ErrSelectInstSet.size() == 0)
+			errSelectInstSet.size() == 0)
 		return;
 
 	//
@@ -958,7 +880,7 @@ void SecurityChecksPass::identifySecurityChecks(Function *F,
 		}
 		// Case 3: select instruction for checks
 		else if (SelectInst *SI = dyn_cast<SelectInst>(Inst)) {
-			if (ErrSelectInstSet.find(SI) == ErrSelectInstSet.end()) {
+			if (errSelectInstSet.find(SI) == errSelectInstSet.end()) {
 				continue;
 			}
 			// A security check
@@ -979,7 +901,8 @@ void SecurityChecksPass::checkErrValueFlow(
 		Function *F,
 		ReturnInst *RI, 
 		std::set<Value *> &PV, 
-		BBErrMap &bbErrMap) {
+		BBErrMap &bbErrMap,
+		set<Instruction *> &errSelectInstSet) {
 
 	Value *RV = RI->getReturnValue();
 	if (!RV)
@@ -1091,7 +1014,7 @@ void SecurityChecksPass::checkErrValueFlow(
 			else if (flag1 || flag2) {
 				markBBErr(SI->getParent(), May_Return_Err, bbErrMap);
 				// Only one branch in this case
-				ErrSelectInstSet.insert(SI);
+				errSelectInstSet.insert(SI);
 			}
 
 			continue;
@@ -1146,9 +1069,10 @@ void SecurityChecksPass::checkErrValueFlow(
 				}
 			}
 			// Get the actual called function
-			if (Ctx->Callees[CaI].size() == 0)
+			auto CIter = Ctx->Callees.find(CaI);
+			if (CIter == Ctx->Callees.end() || CIter->second.empty())
 				continue;
-			CF = *(Ctx->Callees[CaI].begin());
+			CF = *(CIter->second.begin());
 			if (!CF)
 				continue;
 			if (mayReturnErr(CF)) {
@@ -1250,7 +1174,8 @@ void SecurityChecksPass::checkErrValueFlow_new(
 		ReturnInst *RI, 
 		std::set<Value *> &PV, 
 		BBErrMap &bbErrMap,
-		std::map<BasicBlock *,Value *> &blockAttributeMap) {
+		std::map<BasicBlock *,Value *> &blockAttributeMap,
+		set<Instruction *> &errSelectInstSet) {
 
 	Value *RV = RI->getReturnValue();
 	if (!RV)
@@ -1387,7 +1312,7 @@ void SecurityChecksPass::checkErrValueFlow_new(
 				//OP << "Here1\n";
 				markBBErr(SI->getParent(), May_Return_Err, bbErrMap);
 				// Only one branch in this case
-				ErrSelectInstSet.insert(SI);
+				errSelectInstSet.insert(SI);
 				//CFGEdge edge = make_pair(SI->getParent()->getTerminator(),CE.second);
 				//edgeAttributeMap[edge] = May_Return_Err;
 				//blockAttributeMap[edgefirstblock] = V;
@@ -1516,10 +1441,11 @@ void SecurityChecksPass::checkErrValueFlow_new(
 			}
 
 			// Get the actual called function
-			if (Ctx->Callees[CaI].size() == 0)
+			auto CIter = Ctx->Callees.find(CaI);
+			if (CIter == Ctx->Callees.end() || CIter->second.empty())
 				continue;
 
-			CF = *(Ctx->Callees[CaI].begin());
+			CF = *(CIter->second.begin());
 			
 			if (!CF) {
 				//Note: Add this
@@ -1772,51 +1698,72 @@ bool SecurityChecksPass::doFinalization(Module *M) {
   return false;
 }
 
+// Functions are independent: each one gets its own marked CFG and
+// select set, and the results are merged in function order.
 bool SecurityChecksPass::doModulePass(Module *M) {
 
-	for(Module::iterator f = M->begin(), fe = M->end();
-			f != fe; ++f) {
-		Function *F = &*f;
+	vector<Function *> Funcs;
+	for (Function &F : *M)
+		Funcs.push_back(&F);
+	vector<SecurityOperationTable> Results(Funcs.size());
 
-		if (F->empty())
-			continue;
+	#pragma omp parallel for schedule(dynamic)
+	for (int i = 0; i < (int)Funcs.size(); ++i)
+		collectSecurityChecks(Funcs[i], Results[i]);
 
-		if (F->size() > MAX_BLOCKS_SUPPORT)
-			continue;
+	for (unsigned i = 0; i < Funcs.size(); ++i)
+		mergeSecurityChecks(Funcs[i], Results[i]);
 
-		if (Ctx->UnifiedFuncSet.find(F) == Ctx->UnifiedFuncSet.end())
-			continue;
-		
-#ifdef TEST_ONE_CASE
-        if(F->getName()!= TEST_ONE_CASE)
-            continue;
-#endif
+	return false;
+}
 
-		// Marked CFG
-		EdgeErrMap edgeErrMap;
-		// Set of security checks.
-		set<SecurityCheck *> SCSet; 
-		// Traverse the CFG and find security checks for each errno.
-		identifySecurityChecks(F, edgeErrMap, SCSet);
+void SecurityChecksPass::mergeSecurityChecks(Function *F,
+		SecurityOperationTable &SOTable) {
 
-		if (SCSet.empty()) continue;
+	if (SOTable.empty())
+		return;
 
-		Ctx->NumSecurityChecks += SCSet.size();
-		for (auto SC : SCSet) {
-#ifdef SHOW_SECURITY_CHECK
-			OP <<"Checked value: "<<*SC->SCheck<<"\n";
-			OP <<"Check line: "<<*SC->SCBranch<<"\n";
-			printSourceCodeInfo(SC->SCheck);
-			OP<<"\n";
+	Ctx->NumSecurityChecks += SOTable.size();
+	mergeSecurityOperations(Ctx->SecurityOperationSets[F], SOTable);
+}
+
+// Only reads shared state, safe to run on several functions at once
+void SecurityChecksPass::collectSecurityChecks(Function *F,
+		SecurityOperationTable &SOTable) {
+
+	if (F->empty())
+		return;
+
+	if (F->size() > MAX_BLOCKS_SUPPORT)
+		return;
 
+	if (Ctx->UnifiedFuncSet.find(F) == Ctx->UnifiedFuncSet.end())
+		return;
+	
+#ifdef TEST_ONE_CASE
+	if(F->getName()!= TEST_ONE_CASE)
+		return;
 #endif
-			//Ctx->SecurityCheckSets[F].insert(*SC);
-			//Ctx->CheckInstSets[F].insert(SC->getSCheck());
-			SecurityOperation *SO = new SecurityOperation(Securitycheck,SC->SCBranch,SC->SCheck);
-			Ctx->SecurityOperationSets[F].insert(*SO);
-		}
 
-	} // End function iteration
+	// Marked CFG
+	EdgeErrMap edgeErrMap;
+	// Set of security checks.
+	set<SecurityCheck *> SCSet; 
+	// Traverse the CFG and find security checks for each errno.
+	identifySecurityChecks(F, edgeErrMap, SCSet);
 
-	return false;
+	for (auto SC : SCSet) {
+#ifdef SHOW_SECURITY_CHECK
+		#pragma omp critical(SecurityChecksPrint)
+		{
+		OP <<"Checked value: "<<*SC->SCheck<<"\n";
+		OP <<"Check line: "<<*SC->SCBranch<<"\n";
+		printSourceCodeInfo(SC->SCheck);
+		OP<<"\n";
+		}
+#endif
+		//Ctx->SecurityCheckSets[F].insert(*SC);
+		//Ctx->CheckInstSets[F].insert(SC->getSCheck());
+		SOTable.push_back(SecurityOperation(Securitycheck,SC->SCBranch,SC->SCheck));
+	}
 }
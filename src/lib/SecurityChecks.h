@@ -32,20 +32,21 @@ class SecurityChecksPass : public IterativeModulePass {
 	typedef std::map<CFGEdge, int> EdgeErrMap;
 	typedef std::map<BasicBlock *, int> BBErrMap;
 
-	static set<Instruction *>ErrSelectInstSet;
+	// Check if the value is an errno, also used by the function summaries
+	static bool isValueErrno(Value *V, Function *F);
 
 	private:
 
 	// Dump marked edges.
 	void dumpErrEdges(EdgeErrMap &edgeErrMap);
-	bool isValueErrno(Value *V, Function *F);
 
 	///
 	/// Identifying sanity checks
 	///
 	// Find and record blocks with error returning
 	void checkErrReturn(Function *F, BBErrMap &bbErrMap,
-			std::map<BasicBlock *,Value *> &blockAttributeMap);
+			std::map<BasicBlock *,Value *> &blockAttributeMap,
+			set<Instruction *> &errSelectInstSet);
 
 	// Find and record blocks with error handling 
 	void checkErrHandle(Function *F, BBErrMap &bbErrMap);
@@ -61,11 +62,14 @@ class SecurityChecksPass : public IterativeModulePass {
 	bool mayReturnErr(Function *F);
 
 	// Collect all blocks that influence the return value
+	// SelectInsts that take error codes are added to errSelectInstSet
 	void checkErrValueFlow(Function *F, ReturnInst *RI, 
-			std::set<Value *> &PV, BBErrMap &bbErrMap);
+			std::set<Value *> &PV, BBErrMap &bbErrMap,
+			set<Instruction *> &errSelectInstSet);
 	void checkErrValueFlow_new(Function *F, ReturnInst *RI, 
 			std::set<Value *> &PV, BBErrMap &bbErrMap,
-            std::map<BasicBlock *,Value *> &blockAttributeMap);
+            std::map<BasicBlock *,Value *> &blockAttributeMap,
+			set<Instruction *> &errSelectInstSet);
 
 	// Traverse CFG to mark all edges with error flags
 	bool markAllEdgesErrFlag(Function *F, BBErrMap &bbErrMap, EdgeErrMap &edgeErrMap);
@@ -78,9 +82,9 @@ class SecurityChecksPass : public IterativeModulePass {
 	void recurMarkEdgesToBlock(CFGEdge &CE, int flag, 
 			BBErrMap &bbErrMap, EdgeErrMap &edgeErrMap);
 
-	// Recursively mark edges from the error-handling block to the
-	// closest branches
-	void recurMarkEdgesToErrHandle(BasicBlock *BB, EdgeErrMap &edgeErrMap);
+	// Mark edges from the error-handling blocks to the closest branches
+	void markErrHandleEdges(Function *F, BBErrMap &bbErrMap, 
+			EdgeErrMap &edgeErrMap);
 
 	// Recursively mark edges to the error-returning block
 	void recurMarkEdgesToErrReturn(BasicBlock *BB, int flag, EdgeErrMap &edgeErrMap);
@@ -115,6 +119,11 @@ class SecurityChecksPass : public IterativeModulePass {
 	virtual bool doFinalization(llvm::Module *);
 	virtual bool doModulePass(llvm::Module *);
 
+	// Find the checks of F without touching the context, then add them.
+	// The fused pipeline collects a module's checks in parallel too.
+	void collectSecurityChecks(Function *F, SecurityOperationTable &SOTable);
+	void mergeSecurityChecks(Function *F, SecurityOperationTable &SOTable);
+
 	// Identify security checks.
 	void identifySecurityChecks(Function *F, 
 			EdgeErrMap &edgeErrMap, 
@@ -28,125 +28,28 @@ using namespace std;
 //#define PRINT_Init_OPERATION
 //#define PRINT_LOCK_UNLOCK_OPERATION 1
 
-bool SecurityOperationsPass::updateConnectGraph(ConnectGraph &connectGraph,
-    vector<BasicBlock*> globalblockset){
-
-    bool changetag = false;
-
-    if(connectGraph.empty())
-        return changetag;
+void SecurityOperationsPass::identifyRefcountFunc(CallInst *CAI,
+    uint32_t Categories, SecurityOperationTable &SOTable){
     
-    for(auto rit = connectGraph.rbegin(); rit != connectGraph.rend();rit++){
-        Blockpair blockpair = rit->first;
-        BasicBlock* firstbb = blockpair.first;
-        BasicBlock* secondbb = blockpair.second;
-        if(rit->second && firstbb != secondbb){
-            
-            for(auto it = globalblockset.begin(); it != globalblockset.end();it++){
-                //Blockpair blockpair_in = it->first;
-                BasicBlock* firstbb_in = *it;
-                //BasicBlock* secondbb_in = blockpair_in.second;
-                Blockpair blockpair_update(firstbb_in,firstbb);
-                if(connectGraph[blockpair_update]){
-                    Blockpair blockpair_update2(firstbb_in,secondbb);
-                    if(connectGraph[blockpair_update2]==false)
-                        changetag = true;
-                    connectGraph[blockpair_update2]=true;   
-                }
-            }
-        }
-    }
-
-    return changetag;
-}
-
-//Current assume that CFG has no loop
-//ConnectGraph is used to check if a block is reachable for another
-void SecurityOperationsPass::initConnectGraph(Function *F,ConnectGraph &connectGraph,
-    vector<BasicBlock*> globalblockset,
-    EdgeIgnoreMap edgeIgnoreMap){
-
-    connectGraph.clear();
-    if(!F)
+    Function *CF = CAI->getCalledFunction();
+    if (!CF)
         return;
 
-    //init
-    for (Function::iterator b1 = F->begin(), e1 = F->end();
-		b1 != e1; ++b1) {
-            
-		BasicBlock *BB1 = &*b1;
-
-        for(Function::iterator b2 = F->begin(), e2 = F->end(); 
-            b2 != e2; ++b2){
-
-            BasicBlock *BB2 = &*b2;
-            Blockpair blockpair(BB1,BB2);
-            pair<Blockpair, bool> value(blockpair,false);
-            if(BB1==BB2){
-                value.second = true;
-            }
-            
-            connectGraph.insert(value);
-        }
-        
-        //succ check
-        auto TI = BB1->getTerminator();
-        if(TI->getNumSuccessors() == 0)
-            continue;
-        
-        for(BasicBlock *Succ : successors(BB1)){
-            CFGEdge edge = make_pair(TI,Succ);
-            if(edgeIgnoreMap.count(edge)!=0){
-                continue;
-            }
-
-            Blockpair blockpair(BB1,Succ);
-            connectGraph[blockpair] = true;
-        }
-    }
-    
-    while(updateConnectGraph(connectGraph,globalblockset)){
-        //OP << "Round again\n";
-    }
-}
-
-void SecurityOperationsPass::identifyRefcountFuncs(Function *F,
-    set<SecurityOperation *> &SecurityOperationSet){
-    
-    if(!F)
+    if(!(Categories & CC_Refcount))
         return;
-    
-    for(inst_iterator i = inst_begin(F), ei = inst_end(F); i != ei; ++i){
-
-        Instruction *Inst = &*i;
-
-        CallInst *CAI = dyn_cast<CallInst>(&*i);
-        if(CAI){
-            Function *CF = CAI->getCalledFunction();
-			if (!CF){
-                continue;
-            }
-
-            StringRef FName = getCalledFuncName(CAI);
-        
-            if(1 == Ctx->RefcountFuncs.count(FName)){
 
-                unsigned argnum = CAI->getNumArgOperands();
+    unsigned argnum = CAI->getNumArgOperands();
 
-                if(argnum == 0){
-                    //SecurityOperation SO(PairFunc,&*i,NULL);
-                    SecurityOperationSet.insert(new SecurityOperation(RefcountOperation,&*i,NULL));
-                }
+    if(argnum == 0){
+        //SecurityOperation SO(PairFunc,&*i,NULL);
+        SOTable.push_back(SecurityOperation(RefcountOperation,CAI,NULL));
+    }
 
-                for(unsigned j=0;j<argnum;j++){
-                    Value* arg = CAI->getArgOperand(j);
+    for(unsigned j=0;j<argnum;j++){
+        Value* arg = CAI->getArgOperand(j);
 
-                    //SecurityOperation SO(PairFunc,&*i,arg);
-                    SecurityOperationSet.insert(new SecurityOperation(RefcountOperation,&*i,arg));
-                }
-                continue;
-            }
-        }
+        //SecurityOperation SO(PairFunc,&*i,arg);
+        SOTable.push_back(SecurityOperation(RefcountOperation,CAI,arg));
     }
 }
 
@@ -227,14 +130,12 @@ bool SecurityOperationsPass::checkvaliduse(Value *V){
     else{
         unsigned argnum = isCAI->getNumArgOperands();
 
-        StringRef calledFName = getCalledFuncName(isCAI);
-        if(calledFName.contains("err"))
+        uint32_t categories = Ctx->CalleeClasses.get(isCAI);
+        if(categories & CC_Err)
             return false;
 
-        if(!calledFName.contains("free")){
-            if(!calledFName.contains("release"))
-                return false;
-        }
+        if(!(categories & CC_AnyFree))
+            return false;
 
         Value* arg = isCAI->getArgOperand(0);
         Type *argTy = arg->getType();
@@ -245,339 +146,306 @@ bool SecurityOperationsPass::checkvaliduse(Value *V){
     return true;
 }
 
-void SecurityOperationsPass::identifyResourceAcquisition(Function *F,
-    set<SecurityOperation *> &SecurityOperationSet){
+void SecurityOperationsPass::identifyResourceAcquisition(CallInst *CAI,
+    uint32_t Categories, CallTable &Calls, FunctionAnalyses &FA,
+    SecurityOperationTable &SOTable){
 
-    if(!F)
+    Function *CF = CAI->getCalledFunction();
+    Type * Ty= CAI->getType();
+    if(!Ty)
         return;
-    
-    set<Value *>F_argset;
-    F_argset.clear();
-    for(auto it = F->arg_begin(); it != F->arg_end();it++){
-        F_argset.insert(it);
+
+    //Ignore llvm debug functions
+    if(Categories & (CC_Debug | CC_AutoFreed))
+        return;
+
+    //Ignore functions with a const string parameter
+    auto have_const_string = false;
+    unsigned argnum = CAI->getNumArgOperands();
+    for(unsigned j=0;j<argnum;j++){
+        Value* arg = CAI->getArgOperand(j);
+        if(!isa<ConstantExpr>(arg))
+            continue;
+
+        auto ptr = dyn_cast<ConstantExpr>(arg);
+        if(ptr){
+            //OP <<"Found const string\n";
+            have_const_string = true;
+                break;
+        }
     }
 
-    vector<BasicBlock*> globalblockset;
-    initGlobalBlockSet(F,globalblockset);
-    ConnectGraph connectGraph;
-    EdgeIgnoreMap edgeIgnoreMap;
-    edgeIgnoreMap.clear();
-    initConnectGraph(F,connectGraph, globalblockset, edgeIgnoreMap);
+    //An optional setting
+    if(have_const_string){
+        //resource_acq_value = Inst;
+        //resource_acq_value_set.insert(Inst);
+        //continue;
+    }
 
+    set<Value *> resource_acq_value_set;
+    resource_acq_value_set.clear();
 
-    for(inst_iterator i = inst_begin(F), ei = inst_end(F); i != ei; ++i){
+    //The function call returns a pointer
+    if(Ty->isPointerTy()){
+        resource_acq_value_set.insert(CAI);
+    }
 
-        Instruction *Inst = &*i;
-        CallInst *CAI = dyn_cast<CallInst>(&*i);
-		if(CAI){
-            Function *CF = CAI->getCalledFunction();
-            Type * Ty= CAI->getType();
-            if(!Ty)
+    //The return value is a pointer, then this pointer is a resource acquisition
+    //Otherwise, the value need to be a address taken parameter of a function
+    if (!Ty->isPointerTy()){
+
+        //Currently ignore this case
+        return;
+        //OP << "Return value is not a pointer\n";
+        unsigned argnum = CAI->getNumArgOperands();
+        for(unsigned j=0;j<argnum;j++){
+            Value* arg = CAI->getArgOperand(j);
+            Type * argTy= arg->getType();
+
+            //This case need to be resolved specifically
+            AllocaInst *AI = dyn_cast<AllocaInst>(arg);
+            if(AI){
+                argTy = AI->getAllocatedType();
                 continue;
-            
-            //Ignore llvm debug functions
-            StringRef FName = getCalledFuncName(CAI);
-            if(Ctx->DebugFuncs.count(FName) == 1)
+            }
+
+            //The parameter needs to be a pointer, too
+            if(!argTy->isPointerTy()){
+                //OP << "Not a pointer param: "<<*arg<<"\n";
                 continue;
-            if(Ctx->AutoFreedFuncs.count(FName) == 1)
+            }
+
+            //Currently we ignore the paramters of F
+            if(isa<Argument>(arg))
                 continue;
-            
-            //Ignore functions with a const string parameter
-            auto have_const_string = false;
-            unsigned argnum = CAI->getNumArgOperands();
-            for(unsigned j=0;j<argnum;j++){
-                Value* arg = CAI->getArgOperand(j);
-                if(!isa<ConstantExpr>(arg))
-                    continue;
 
-                auto ptr = dyn_cast<ConstantExpr>(arg);
-                if(ptr){
-                    //OP <<"Found const string\n";
-                    have_const_string = true;
-                        break;
-                }
-            }
+            //auto att = CAI->getParamAttr(argnum, llvm::Attribute::AttrKind::None);
+            auto nonnull_attr = CAI->getParamAttr(j, Attribute::NonNull);
+
+            string str = nonnull_attr.getAsString();
+            if(str.length()!=0){
 
-            //An optional setting
-            if(have_const_string){
-                //resource_acq_value = Inst;
-                //resource_acq_value_set.insert(Inst);
-                //continue;
+                //Check from the source file: must contain '&'
+                string CAI_sourcecode = getSourceLine(CAI);
+                if(!checkStringContainSubString(CAI_sourcecode,"&")){
+                    continue;
+                }
+                if(checkStringContainSubString(CAI_sourcecode,"&&")){
+                    continue;
+                }
+                resource_acq_value_set.insert(arg);
             }
+        }
+    }
 
-            set<Value *> resource_acq_value_set;
-            resource_acq_value_set.clear();
+    //Find the last use of the resource
+    if(!resource_acq_value_set.empty()){
+        for(auto it = resource_acq_value_set.begin(); it != resource_acq_value_set.end();it++){
+            Value *resource_acq_value = *it;
+            auto numuse = resource_acq_value->getNumUses();
 
-            //The function call returns a pointer
-            if(Ty->isPointerTy()){
-                resource_acq_value_set.insert(Inst);
-            }
+            //这里应该用连通关系来界定lastuse
+            if(numuse != 0){
 
-            //The return value is a pointer, then this pointer is a resource acquisition
-            //Otherwise, the value need to be a address taken parameter of a function
-			if (!Ty->isPointerTy()){
+                Value * lastuse = NULL;
+                set<Value *> validuserset;
+                validuserset.clear();
+                set<Value *> invaliduserset;
+                invaliduserset.clear();
 
-                //Currently ignore this case
-                continue;
-                //OP << "Return value is not a pointer\n";
-                unsigned argnum = CAI->getNumArgOperands();
-                for(unsigned j=0;j<argnum;j++){
-                    Value* arg = CAI->getArgOperand(j);
-                    Type * argTy= arg->getType();
-
-                    //This case need to be resolved specifically
-                    AllocaInst *AI = dyn_cast<AllocaInst>(arg);
-                    if(AI){
-                        argTy = AI->getAllocatedType();
-                        continue;
-                    }
+                std::set<Value *> PV; //Global value set to avoid loop
+                std::list<Value *> EV; //BFS record list
+                PV.clear();
+                EV.clear();
+                EV.push_back(resource_acq_value);
+                while (!EV.empty()) {
 
-                    //The parameter needs to be a pointer, too
-                    if(!argTy->isPointerTy()){
-                        //OP << "Not a pointer param: "<<*arg<<"\n";
-                        continue;
-                    }
+                    Value *TV = EV.front(); //Current checking value
+                    EV.pop_front();
 
-                    //Currently we ignore the paramters of F
-                    if(F_argset.count(arg) == 1)
+                    if (PV.find(TV) != PV.end())
                         continue;
+                    PV.insert(TV);
 
-                    //auto att = CAI->getParamAttr(argnum, llvm::Attribute::AttrKind::None);
-                    auto nonnull_attr = CAI->getParamAttr(j, Attribute::NonNull);
-                    
-                    string str = nonnull_attr.getAsString();
-                    if(str.length()!=0){
 
-                        //Check from the source file: must contain '&'
-                        string CAI_sourcecode = getSourceLine(CAI);
-                        if(!checkStringContainSubString(CAI_sourcecode,"&")){
+                    for(User *U :TV->users()){
+                        if(U == resource_acq_value)
                             continue;
-                        }
-                        if(checkStringContainSubString(CAI_sourcecode,"&&")){
+
+                        BitCastInst *BCI = dyn_cast<BitCastInst>(U);
+                        if(BCI){
+                            EV.push_back(BCI);
+                            if(invaliduserset.count(TV)){
+                                invaliduserset.insert(U);
+                            }
                             continue;
                         }
-                        resource_acq_value_set.insert(arg);
-                    }
-                }
-            }
-
-            //Find the last use of the resource
-            if(!resource_acq_value_set.empty()){
-                for(auto it = resource_acq_value_set.begin(); it != resource_acq_value_set.end();it++){
-                    Value *resource_acq_value = *it;
-                    auto numuse = resource_acq_value->getNumUses();
 
-                    //这里应该用连通关系来界定lastuse
-                    if(numuse != 0){
+                        StoreInst *STI = dyn_cast<StoreInst>(U);
+                        if(STI){
+                            Value* pop = STI->getPointerOperand();
 
-                        Value * lastuse = NULL;
-                        set<Value *> validuserset;
-                        validuserset.clear();
-                        set<Value *> invaliduserset;
-                        invaliduserset.clear();
+                            EV.push_back(pop);
+                            if(invaliduserset.count(TV)){
+                                invaliduserset.insert(U);
+                            }
+                            continue;
+                        }
 
-                        std::set<Value *> PV; //Global value set to avoid loop
-                        std::list<Value *> EV; //BFS record list
-                        PV.clear();
-                        EV.clear();
-                        EV.push_back(resource_acq_value);
-                        while (!EV.empty()) {
+                        LoadInst* LI = dyn_cast<LoadInst>(U);
+                        if(LI){
+                            EV.push_back(LI);
+                            if(invaliduserset.count(TV))
+                                invaliduserset.insert(U);
+                            continue;
+                        }
 
-                            Value *TV = EV.front(); //Current checking value
-                            EV.pop_front();
+                        GetElementPtrInst *GEP = dyn_cast<GetElementPtrInst>(U);
+                        if(GEP){
+                            EV.push_back(GEP);
+                            invaliduserset.insert(GEP);
+                            continue;
+                        }
 
-                            if (PV.find(TV) != PV.end())
-                                continue;
-                            PV.insert(TV);
+                        PHINode *PN = dyn_cast<PHINode>(U);
+                        if(PN){
+                            EV.push_back(PN);
+                            if(invaliduserset.count(TV))
+                                invaliduserset.insert(U);
+                            continue;
+                        }
 
+                        ReturnInst *RI = dyn_cast<ReturnInst>(U);
+                        if(RI){
+                            continue;
+                        }
 
-                            for(User *U :TV->users()){
-                                if(U == resource_acq_value)
-                                    continue;
-                                
-                                BitCastInst *BCI = dyn_cast<BitCastInst>(U);
-                                if(BCI){
-                                    EV.push_back(BCI);
-                                    if(invaliduserset.count(TV)){
-                                        invaliduserset.insert(U);
-                                    }
-                                    continue;
-                                }
+                        validuserset.insert(U);
 
-                                StoreInst *STI = dyn_cast<StoreInst>(U);
-                                if(STI){
-                                    Value* pop = STI->getPointerOperand();
-                                    
-                                    EV.push_back(pop);
-                                    if(invaliduserset.count(TV)){
-                                        invaliduserset.insert(U);
-                                    }
-                                    continue;
-                                }
+                        if(invaliduserset.count(TV))
+                            invaliduserset.insert(U);
+                    }
+                }
 
-                                LoadInst* LI = dyn_cast<LoadInst>(U);
-                                if(LI){
-                                    EV.push_back(LI);
-                                    if(invaliduserset.count(TV))
-                                        invaliduserset.insert(U);
-                                    continue;
-                                }
+                if(validuserset.empty())
+                    continue;
 
-                                GetElementPtrInst *GEP = dyn_cast<GetElementPtrInst>(U);
-                                if(GEP){
-                                    EV.push_back(GEP);
-                                    invaliduserset.insert(GEP);
-                                    continue;
-                                }
+                set<Value *> checkedlastuseset;
+                checkedlastuseset.clear();
+                if(validuserset.size()>1){
+                    lastuse = NULL;
 
-                                PHINode *PN = dyn_cast<PHINode>(U);
-                                if(PN){
-                                    EV.push_back(PN);
-                                    if(invaliduserset.count(TV))
-                                        invaliduserset.insert(U);
-                                    continue;
-                                }
+                    //There could be more than one valid user
+                    for(auto it = validuserset.begin(); it != validuserset.end();it++){
 
-                                ReturnInst *RI = dyn_cast<ReturnInst>(U);
-                                if(RI){
-                                    continue;
-                                }
+                        Instruction *currentuse = dyn_cast<Instruction>(*it);
+                        if(!currentuse)
+                            continue;
 
-                                validuserset.insert(U);
+                        BasicBlock* currentuseblock = currentuse->getParent();
+                        bool findtag = true;
 
-                                if(invaliduserset.count(TV))
-                                    invaliduserset.insert(U);
-                            }
-                        }
-                        
-                        if(validuserset.empty())
-                            continue;
+                        for(auto j = validuserset.begin(); j != validuserset.end();j++){
 
-                        set<Value *> checkedlastuseset;
-                        checkedlastuseset.clear();
-                        if(validuserset.size()>1){
-                            lastuse = NULL;
+                            Instruction *otheruse = dyn_cast<Instruction>(*j);
+                            if(!otheruse)
+                                continue;
 
-                            //There could be more than one valid user
-                            for(auto it = validuserset.begin(); it != validuserset.end();it++){
+                            //Igonre currentuse itself
+                            if(otheruse == currentuse)
+                                continue;
 
-                                Instruction *currentuse = dyn_cast<Instruction>(*it);
-                                if(!currentuse)
-                                    continue;
+                            BasicBlock* otheruseblock = otheruse->getParent();
 
-                                BasicBlock* currentuseblock = currentuse->getParent();
-                                bool findtag = true;
-
-                                for(auto j = validuserset.begin(); j != validuserset.end();j++){
-
-                                    Instruction *otheruse = dyn_cast<Instruction>(*j);
-                                    if(!otheruse)
-                                        continue;
-                                    
-                                    //Igonre currentuse itself
-                                    if(otheruse == currentuse)
-                                        continue;
-
-                                    BasicBlock* otheruseblock = otheruse->getParent();
-
-                                    //检测同一个block内的先后关系
-                                    if(otheruseblock == currentuseblock){
-                                        DominatorTree DT = DominatorTree();
-                                        DT.recalculate(*F);
-                                        if(DT.dominates(currentuse,otheruse)){
-                                            findtag = false;
-                                            break;
-                                        }
-                                    }
-                                    else{
-                                        //Current use is not the last use
-                                        Blockpair blockpair(currentuseblock,otheruseblock);
-                                        if(connectGraph[blockpair]){
-                                            findtag = false;
-                                            break;
-                                        }
-                                    }
+                            //检测同一个block内的先后关系
+                            if(otheruseblock == currentuseblock){
+                                if(FA.getDomTree().dominates(currentuse,otheruse)){
+                                    findtag = false;
+                                    break;
                                 }
-
-                                //current use cannot reach any other use, this is the last use
-                                if(findtag){
-                                    lastuse = *it;
-                                    if(invaliduserset.count(lastuse)) {
-                                        continue;
-                                    }
-                                    //OP <<"Here\n";
-                                    if(checkvaliduse(lastuse)){
-                                        //Found a valid last use
-                                        if(lastuse == NULL || lastuse == CAI || lastuse == resource_acq_value)
-                                            continue;
-
-                                        BasicBlock* caiblock = CAI->getParent();
-                                        Instruction *useinst = dyn_cast<Instruction>(lastuse);
-                                        BasicBlock* useblock = useinst->getParent();
-                                        Blockpair blockpair(useblock,caiblock);
-                                        if(connectGraph[blockpair]){
-                                            continue;
-                                        }
-
-                                        checkedlastuseset.insert(lastuse);
-                                    }
-                                    else
-                                        lastuse = NULL;
+                            }
+                            else{
+                                //Current use is not the last use
+                                if(FA.isReachable(currentuseblock,otheruseblock)){
+                                    findtag = false;
+                                    break;
                                 }
                             }
                         }
-                        else{
-                            lastuse = *(validuserset.begin());
-                            if(invaliduserset.count(lastuse))
+
+                        //current use cannot reach any other use, this is the last use
+                        if(findtag){
+                            lastuse = *it;
+                            if(invaliduserset.count(lastuse)) {
                                 continue;
-                            if(!checkvaliduse(lastuse)){
-                                lastuse = NULL;
                             }
-                            else{
+                            //OP <<"Here\n";
+                            if(checkvaliduse(lastuse)){
+                                //Found a valid last use
+                                if(lastuse == NULL || lastuse == CAI || lastuse == resource_acq_value)
+                                    continue;
+
+                                BasicBlock* caiblock = CAI->getParent();
+                                Instruction *useinst = dyn_cast<Instruction>(lastuse);
+                                BasicBlock* useblock = useinst->getParent();
+                                if(FA.isReachable(useblock,caiblock)){
+                                    continue;
+                                }
+
                                 checkedlastuseset.insert(lastuse);
                             }
+                            else
+                                lastuse = NULL;
                         }
+                    }
+                }
+                else{
+                    lastuse = *(validuserset.begin());
+                    if(invaliduserset.count(lastuse))
+                        continue;
+                    if(!checkvaliduse(lastuse)){
+                        lastuse = NULL;
+                    }
+                    else{
+                        checkedlastuseset.insert(lastuse);
+                    }
+                }
 
-                        if(checkedlastuseset.empty())
-                            continue;
+                if(checkedlastuseset.empty())
+                    continue;
 
-                        //Use predefined list to correct lead-follow functions
-                        for(auto it = checkedlastuseset.begin(); it != checkedlastuseset.end(); ++it){
-                            CallInst *freeCAI = dyn_cast<CallInst>(*it);
-                            StringRef freeFName = getCalledFuncName(freeCAI);
-                            if(Ctx->PairFuncs.count(freeFName) == 1){
-                                for(inst_iterator it = inst_begin(F), eit = inst_end(F); it != eit; ++it){
-                                    Instruction *Inst = &*it;
-                                    CallInst *CAI = dyn_cast<CallInst>(Inst);
-                                    if(CAI){
-                                        StringRef funcname = getCalledFuncName(CAI);
-                                        
-                                        if(Ctx->PairFuncs[freeFName].count(funcname) == 1){
-                                            SecurityOperationSet.insert(new SecurityOperation(ResourceAcquisition,CAI,resource_acq_value));
-                                            SecurityOperationSet.insert(new SecurityOperation(ResourceRelease,freeCAI,resource_acq_value));
-                                            #ifdef PRINT_RESOURCE_RELATED_OPERATION
-                                            OP << "Resource: "<< *CAI <<"\n";
-                                            OP << "Alloc: "<< *CAI <<"\n";
-                                            OP << "Release: "<< *freeCAI <<"\n\n";
-                                            #endif
-                                        }
-                                    }
-                                }
-                                continue;
+                //Use predefined list to correct lead-follow functions
+                for(auto it = checkedlastuseset.begin(); it != checkedlastuseset.end(); ++it){
+                    CallInst *freeCAI = dyn_cast<CallInst>(*it);
+                    StringRef freeFName = getCalledFuncName(freeCAI);
+                    if(Ctx->CalleeClasses.get(freeCAI) & CC_PairFree){
+                        for(auto &Call : Calls){
+                            CallInst *AcqCAI = Call.first;
+                            StringRef funcname = getCalledFuncName(AcqCAI);
+
+                            if(getPeerFuncNames(Ctx->PairFuncs, freeFName).count(funcname) == 1){
+                                SOTable.push_back(SecurityOperation(ResourceAcquisition,AcqCAI,resource_acq_value));
+                                SOTable.push_back(SecurityOperation(ResourceRelease,freeCAI,resource_acq_value));
+                                #ifdef PRINT_RESOURCE_RELATED_OPERATION
+                                OP << "Resource: "<< *AcqCAI <<"\n";
+                                OP << "Alloc: "<< *AcqCAI <<"\n";
+                                OP << "Release: "<< *freeCAI <<"\n\n";
+                                #endif
                             }
                         }
+                        continue;
+                    }
+                }
 
-                        SecurityOperationSet.insert(new SecurityOperation(ResourceAcquisition,&*i,resource_acq_value));
+                SOTable.push_back(SecurityOperation(ResourceAcquisition,CAI,resource_acq_value));
 #ifdef PRINT_RESOURCE_RELATED_OPERATION
-                        OP << "resource_acq_value: "<< *resource_acq_value <<"\n";
+                OP << "resource_acq_value: "<< *resource_acq_value <<"\n";
 #endif
-                        for(auto it = checkedlastuseset.begin(); it != checkedlastuseset.end(); ++it){
+                for(auto it = checkedlastuseset.begin(); it != checkedlastuseset.end(); ++it){
 #ifdef PRINT_RESOURCE_RELATED_OPERATION
-                            OP<<"Valid use: "<< *(*it)<<"\n";
+                    OP<<"Valid use: "<< *(*it)<<"\n";
 #endif
-                            SecurityOperationSet.insert(new SecurityOperation(ResourceRelease,*it,resource_acq_value));
-                        }
-                    }
+                    SOTable.push_back(SecurityOperation(ResourceRelease,*it,resource_acq_value));
                 }
             }
         }
@@ -586,7 +454,7 @@ void SecurityOperationsPass::identifyResourceAcquisition(Function *F,
 
 
 void SecurityOperationsPass::identifyInitialization(Function *F, 
-    set<SecurityOperation *> &SecurityOperationSet){
+    SecurityOperationTable &SOTable){
     
     if(!F)
         return;
@@ -601,8 +469,8 @@ void SecurityOperationsPass::identifyInitialization(Function *F,
     map<Value*,set<Value *>> initMap;
     initMap.clear();
 
-    DominatorTree DT = DominatorTree();
-    DT.recalculate(*F);
+    std::shared_ptr<FunctionAnalyses> FA = Ctx->FuncAnalyses.get(F);
+    DominatorTree &DT = FA->getDomTree();
 
     for(inst_iterator i = inst_begin(F), ei = inst_end(F); i != ei; ++i){
 
@@ -703,7 +571,7 @@ void SecurityOperationsPass::identifyInitialization(Function *F,
                 }
 
                 if(validinit){
-                    SecurityOperationSet.insert(new SecurityOperation(Initialization,&*i,pop));
+                    SOTable.push_back(SecurityOperation(Initialization,&*i,pop));
                     initMap[pop].insert(&*i);
                     #ifdef PRINT_Init_OPERATION
                     OP << "init: "<< *Inst <<"\n";
@@ -731,7 +599,7 @@ void SecurityOperationsPass::identifyInitialization(Function *F,
                 if(isConstant(fillvar)){
                     //auto fillvar_const = dyn_cast<Constant>(fillvar);
                     //if(fillvar_const->isNullValue()){
-                    SecurityOperationSet.insert(new SecurityOperation(Initialization,&*i,criticalvar));
+                    SOTable.push_back(SecurityOperation(Initialization,&*i,criticalvar));
                     #ifdef PRINT_Init_OPERATION
                     OP << "init: "<< *Inst <<"\n";
                     OP << "CV: "<< *criticalvar <<"\n";
@@ -747,7 +615,7 @@ void SecurityOperationsPass::identifyInitialization(Function *F,
             if(FName == "llvm.memcpy.p0i8.i64" || FName == "llvm.memcpy.p0i8.i32"
                 || FName == "__memcpy"){
                 Value * criticalvar = CAI->getArgOperand(0);
-                SecurityOperationSet.insert(new SecurityOperation(Initialization_memcpy,&*i,criticalvar));
+                SOTable.push_back(SecurityOperation(Initialization_memcpy,&*i,criticalvar));
                 continue;
             }
         }
@@ -756,115 +624,158 @@ void SecurityOperationsPass::identifyInitialization(Function *F,
 
 //Find lock & unlock function
 //Todo: need to further improve this algorithm
-void SecurityOperationsPass::identifyLockUnlock(Function *F, 
-    set<SecurityOperation *> &SecurityOperationSet){
+void SecurityOperationsPass::identifyLockUnlock(CallInst *CAI,
+    uint32_t Categories, SecurityOperationTable &SOTable){
 
-    if(!F)
-        return;
-    
-    if(F->getName().contains("lock"))
-        return;
+    //Find lock function
+    if(Categories & CC_AnyLock){
+        
+        Value * criticalvar_lock;
+        unsigned argnum = CAI->getNumArgOperands();
+        if(argnum == 0){
+            criticalvar_lock = NULL;
+        }
+        else{
+            criticalvar_lock = CAI->getArgOperand(0);
+            CallInst *CAI_arg = dyn_cast<CallInst>(criticalvar_lock);
+            if(CAI_arg && CAI_arg->getNumOperands()!=0){
+                if(Ctx->CalleeClasses.get(CAI_arg) & CC_LockName)
+                    criticalvar_lock = CAI_arg->getOperand(0);
+            }
+        }
 
-    for(inst_iterator i = inst_begin(F), ei = inst_end(F); i != ei; ++i){
+        SOTable.push_back(SecurityOperation(Lock,CAI,criticalvar_lock));
+        #ifdef PRINT_LOCK_UNLOCK_OPERATION
+        OP<<"Lock: "<<*CAI <<"\n";
+        if(criticalvar_lock == NULL) 
+            OP<<"--target_var: NULL \n";
+        else
+            OP<<"--target_var: "<<*criticalvar_lock <<"\n";
+        #endif
+    }
 
-        Instruction *Inst = &*i;
+    //Find unlock function
+    if(Categories & CC_Unlock){
 
-        CallInst *CAI = dyn_cast<CallInst>(&*i);
-        if(CAI){
-            StringRef FName = getCalledFuncName(CAI);
+        //Ignore "_unlocked" function
+        if(Categories & CC_Unlocked)
+            return;
+        
+        Type * Ty= CAI->getType();
+        if(!Ty)
+            return;
+        if(!Ty->isVoidTy())
+            return;
+
+        Value * criticalvar_unlock;
+        unsigned argnum = CAI->getNumArgOperands();
+        if(argnum == 0){
+            criticalvar_unlock = NULL;
+        }
+        else
+            criticalvar_unlock = CAI->getArgOperand(0);
+
+        SOTable.push_back(SecurityOperation(Unlock,CAI,criticalvar_unlock));
+        #ifdef PRINT_LOCK_UNLOCK_OPERATION
+            OP<<"Unlock: "<<*CAI <<"\n";
+        if(criticalvar_unlock == NULL)
+            OP<<"--target_var: NULL \n";
+        else
+            OP<<"--target_var: "<<*criticalvar_unlock <<"\n";
+        #endif
+    }
+}
 
-            //Find lock function
-            if(FName.contains("_lock") || FName.contains("_trylock") || FName.contains("_spinlock")){
-                
-                Value * criticalvar_lock;
-                unsigned argnum = CAI->getNumArgOperands();
-                if(argnum == 0){
-                    criticalvar_lock = NULL;
-                }
-                else{
-                    criticalvar_lock = CAI->getArgOperand(0);
-                    CallInst *CAI_arg = dyn_cast<CallInst>(criticalvar_lock);
-                    if(CAI_arg && CAI_arg->getNumOperands()!=0){
-                        StringRef arg_FName = getCalledFuncName(CAI_arg);
-                        if(arg_FName.contains("lock"))
-                            criticalvar_lock = CAI_arg->getOperand(0);
-                    }
-                }
+//Find calls of functions that only lock or only unlock one of their
+//arguments, from the function summaries. Functions matched by name are
+//left to identifyLockUnlock.
+void SecurityOperationsPass::identifyLockWrappers(CallInst *CAI,
+    uint32_t Categories, SecurityOperationTable &SOTable){
 
-                SecurityOperationSet.insert(new SecurityOperation(Lock,&*i,criticalvar_lock));
-                #ifdef PRINT_LOCK_UNLOCK_OPERATION
-                OP<<"Lock: "<<*CAI <<"\n";
-                if(criticalvar_lock == NULL) 
-                    OP<<"--target_var: NULL \n";
-                else
-                    OP<<"--target_var: "<<*criticalvar_lock <<"\n";
-                #endif
-            }
+    if(Categories & (CC_AnyLock | CC_Unlock))
+        return;
 
-            //Find unlock function
-            if(FName.contains("_unlock")){
+    if(!CAI->getCalledFunction())
+        return;
 
-                //Ignore "_unlocked" function
-                if(FName.contains("_unlocked"))
-                    continue;
-                
-                Type * Ty= CAI->getType();
-                if(!Ty)
-                    continue;
-                if(!Ty->isVoidTy())
-                    continue;
+    auto it = Ctx->Callees.find(CAI);
+    if(it == Ctx->Callees.end())
+        return;
 
-                Value * criticalvar_unlock;
-                unsigned argnum = CAI->getNumArgOperands();
-                if(argnum == 0){
-                    criticalvar_unlock = NULL;
-                }
-                else
-                    criticalvar_unlock = CAI->getArgOperand(0);
-
-                SecurityOperationSet.insert(new SecurityOperation(Unlock,&*i,criticalvar_unlock));
-                #ifdef PRINT_LOCK_UNLOCK_OPERATION
-                    OP<<"Unlock: "<<*CAI <<"\n";
-                if(criticalvar_unlock == NULL)
-                    OP<<"--target_var: NULL \n";
-                else
-                    OP<<"--target_var: "<<*criticalvar_unlock <<"\n";
-                #endif
-            }
-        }
+    uint64_t locks = 0, unlocks = 0;
+    for(Function *Callee : it->second){
+        if(!Callee)
+            continue;
+        const FuncEffectSummary &S = Ctx->getFuncSummary(Callee);
+        locks |= S.Locks;
+        unlocks |= S.Unlocks;
     }
-}
 
+    //A function that takes and drops the same lock is no wrapper
+    uint64_t lockonly = locks & ~unlocks;
+    uint64_t unlockonly = unlocks & ~locks;
+    if(!lockonly && !unlockonly)
+        return;
+
+    unsigned argnum = CAI->getNumArgOperands();
+    for(unsigned j = 0; j < argnum && j < 64; j++){
+        if((lockonly >> j) & 1)
+            SOTable.push_back(SecurityOperation(Lock,CAI,CAI->getArgOperand(j)));
+        if((unlockonly >> j) & 1)
+            SOTable.push_back(SecurityOperation(Unlock,CAI,CAI->getArgOperand(j)));
+        #ifdef PRINT_LOCK_UNLOCK_OPERATION
+        if(((lockonly | unlockonly) >> j) & 1)
+            OP<<"Lock wrapper: "<<*CAI <<"\n--target_var: "<<*CAI->getArgOperand(j)<<"\n";
+        #endif
+    }
+}
 
+//All detectors share one walk over the calls of F
 void SecurityOperationsPass::identifySecurityOperations(Function *F){
 
     if(!F)
         return;
     
-    set<SecurityOperation *> SecurityOperationSet;
-    SecurityOperationSet.clear();
+    CallTable Calls;
+    for(inst_iterator i = inst_begin(F), ei = inst_end(F); i != ei; ++i){
+        if(CallInst *CAI = dyn_cast<CallInst>(&*i))
+            Calls.push_back(make_pair(CAI, Ctx->CalleeClasses.get(CAI)));
+    }
+
+    if(Calls.empty())
+        return;
+
+    std::shared_ptr<FunctionAnalyses> FA = Ctx->FuncAnalyses.get(F);
+
+    //Lock functions themselves are not checked for lock operations
+    bool findLocks = !(Ctx->CalleeClasses.get(F) & CC_LockName);
+
+    SecurityOperationTable SOTable;
 
     //Identify Security Operations
-    identifyRefcountFuncs(F,SecurityOperationSet);
+    for(auto &Call : Calls){
+        identifyRefcountFunc(Call.first, Call.second, SOTable);
 
-    identifyResourceAcquisition(F,SecurityOperationSet);
+        identifyResourceAcquisition(Call.first, Call.second, Calls, *FA, SOTable);
 
-    //This function is under test
-    //identifyInitialization(F,SecurityOperationSet);
+        //This function is under test
+        if(findLocks){
+            identifyLockUnlock(Call.first, Call.second, SOTable);
+            identifyLockWrappers(Call.first, Call.second, SOTable);
+        }
+    }
 
     //This function is under test
-    identifyLockUnlock(F,SecurityOperationSet);
+    //identifyInitialization(F,SOTable);
 
     ///Todo: add other security operations
 
-    if(SecurityOperationSet.empty())
+    if(SOTable.empty())
         return;
 
     //Update global counter
-    for(auto it = SecurityOperationSet.begin(); it != SecurityOperationSet.end();it++){
-
-        SecurityOperation *SO = *it;
-        switch(SO->operationType){
+    for(auto &SO : SOTable){
+        switch(SO.operationType){
             case ResourceAcquisition:
                 Ctx->NumResourceAcq += 1;
                 break;
@@ -880,9 +791,7 @@ void SecurityOperationsPass::identifySecurityOperations(Function *F){
         }
     }
 
-    for (auto SO : SecurityOperationSet) {
-		Ctx->SecurityOperationSets[F].insert(*SO);
-	}
+    mergeSecurityOperations(Ctx->SecurityOperationSets[F], SOTable);
 }
 
 bool SecurityOperationsPass::doInitialization(Module *M) {
@@ -898,25 +807,32 @@ bool SecurityOperationsPass::doModulePass(Module *M) {
     //Find security operations for each function
 	for(Module::iterator f = M->begin(), fe = M->end();
 			f != fe; ++f) {
-		Function *F = &*f;
+		analyzeFunction(&*f);
+	}
 
-		if (F->empty())
-			continue;
+	return false;
+}
 
-		if (F->size() > MAX_BLOCKS_SUPPORT)
-			continue;
+void SecurityOperationsPass::analyzeFunction(Function *F) {
+
+    if (F->empty())
+        return;
+
+    if (F->size() > MAX_BLOCKS_SUPPORT)
+        return;
 
-        //Test for one function
+    //Only the representative of identical bodies is analyzed
+    if (Ctx->DuplicateFuncs.count(F))
+        return;
+
+    //Test for one function
 #ifdef TEST_ONE_CASE
-        if(F->getName()!= TEST_ONE_CASE)
-            continue;
+    if(F->getName()!= TEST_ONE_CASE)
+        return;
 #endif
 
-        //F is not empty
-        Ctx->NumFunctions++;
+    //F is not empty
+    Ctx->NumFunctions++;
 
-        identifySecurityOperations(F);
-	}
-
-	return false;
+    identifySecurityOperations(F);
 }
\ No newline at end of file
@@ -7,31 +7,27 @@
 
 class SecurityOperationsPass : public IterativeModulePass {
 
-    typedef std::pair<BasicBlock*, BasicBlock*> Blockpair;
-    typedef std::map<Blockpair, bool> ConnectGraph;
-    typedef std::pair<Instruction *, BasicBlock *> CFGEdge;
-    typedef std::map<CFGEdge, int> EdgeIgnoreMap;
-
     private:
 
-    bool updateConnectGraph(ConnectGraph &connectGraph, 
-        std::vector<BasicBlock*> globalblockset);
+    //Calls of the function with the categories of their callees,
+    //collected by a single walk and shared by the detectors
+    typedef std::vector<std::pair<CallInst *, uint32_t>> CallTable;
 
-    void initConnectGraph(Function *F,ConnectGraph &connectGraph,
-        std::vector<BasicBlock*> globalblockset,
-        EdgeIgnoreMap edgeIgnoreMap);
-    
-    void identifyRefcountFuncs(Function *F,
-        set<SecurityOperation *> &SecurityOperationSet);
+    void identifyRefcountFunc(CallInst *CAI, uint32_t Categories,
+        SecurityOperationTable &SOTable);
     
-    void identifyResourceAcquisition(Function *F,
-        set<SecurityOperation *> &SecurityOperationSet);
+    void identifyResourceAcquisition(CallInst *CAI, uint32_t Categories,
+        CallTable &Calls, FunctionAnalyses &FA,
+        SecurityOperationTable &SOTable);
     
     void identifyInitialization(Function *F,
-        set<SecurityOperation *> &SecurityOperationSet);
+        SecurityOperationTable &SOTable);
     
-    void identifyLockUnlock(Function *F,
-        set<SecurityOperation *> &SecurityOperationSet);
+    void identifyLockUnlock(CallInst *CAI, uint32_t Categories,
+        SecurityOperationTable &SOTable);
+
+    void identifyLockWrappers(CallInst *CAI, uint32_t Categories,
+        SecurityOperationTable &SOTable);
     
     Value *findlastuse(Function *F, Value *V);
     bool checkvaliduse(Value *V);
@@ -43,6 +39,9 @@ class SecurityOperationsPass : public IterativeModulePass {
         virtual bool doFinalization(llvm::Module *);
         virtual bool doModulePass(llvm::Module *);
 
+        // Run the pass on one function, for the fused pipeline
+        void analyzeFunction(Function *F);
+
         // Identify security checks.
 	    void identifySecurityOperations(Function *F);
 
@@ -250,42 +250,12 @@ int checkBlockInstLocation(BasicBlock *bb){
 }
 
 //Check if there exits common element of two sets
-bool findCommonOfSet(set<Value *> setA, set<Value *> setB){
-    if(setA.empty() || setB.empty())
-        return false;
-    
-    bool foundtag = false;
-    for(auto i = setA.begin(); i != setA.end(); i++){
-        Value * vi = *i;
-        for(auto j = setB.begin(); j != setB.end(); j++){
-            Value * vj = *j;
-            if(vi == vj){
-                foundtag = true;
-                return foundtag;
-            }
-        }
-    }
-
-    return foundtag;
+bool findCommonOfSet(const set<Value *> &setA, const set<Value *> &setB){
+    return hasCommonElement(setA, setB);
 }
 
-bool findCommonOfSet(set<std::string> setA, set<std::string> setB){
-    if(setA.empty() || setB.empty())
-        return false;
-    
-    bool foundtag = false;
-    for(auto i = setA.begin(); i != setA.end(); i++){
-        string vi = *i;
-        for(auto j = setB.begin(); j != setB.end(); j++){
-            string vj = *j;
-            if(vi == vj){
-                foundtag = true;
-                return foundtag;
-            }
-        }
-    }
-
-    return foundtag;
+bool findCommonOfSet(const set<std::string> &setA, const set<std::string> &setB){
+    return hasCommonElement(setA, setB);
 }
 
 
@@ -363,14 +333,65 @@ bool checkBlockPairConnectivity(
     return false;
 }
 
-//The CallerF needs to pass its arguments to cai, or it's invalid
-bool checkValidCaller(Function *CallerF, CallInst *cai){
-    if(!CallerF || !cai)
-        return false;
-    
-    if(CallerF->arg_size() == 0)
-        return false;
-    
+//Call sites reached by forward flow from the arguments or from a value,
+//as bitsets over the call sites of one function. Queries on the same
+//function reuse the flows computed so far, so each flow is walked once.
+struct CallFlowSummary {
+    Function *F = NULL;
+    DenseMap<CallInst *, unsigned> CallIndex;
+    bool ArgFlowDone = false;
+    BitVector ArgFlow;
+    DenseMap<Value *, BitVector> ValueFlows;
+};
+
+static const CalleeClassifier *ToolsCalleeClasses = NULL;
+
+void setToolsCalleeClassifier(const CalleeClassifier *CC){
+    ToolsCalleeClasses = CC;
+}
+
+static bool isGetDrvdataCall(CallInst *CAI){
+
+    if(ToolsCalleeClasses)
+        return ToolsCalleeClasses->get(CAI) & CC_GetDrvdata;
+    return getCalledFuncName(CAI).contains("_get_drvdata");
+}
+
+static CallFlowSummary &getCallFlowSummary(Function *F){
+
+    static thread_local CallFlowSummary Summary;
+    if(Summary.F == F)
+        return Summary;
+
+    Summary.F = F;
+    Summary.CallIndex.clear();
+    Summary.ArgFlowDone = false;
+    Summary.ValueFlows.clear();
+    for(inst_iterator i = inst_begin(F), e = inst_end(F); i != e; ++i){
+        if(CallInst *CAI = dyn_cast<CallInst>(&*i)){
+            unsigned idx = Summary.CallIndex.size();
+            Summary.CallIndex[CAI] = idx;
+        }
+    }
+    return Summary;
+}
+
+static void markReachedCall(CallFlowSummary &Summary, CallInst *CAI,
+    BitVector &Reached){
+
+    auto it = Summary.CallIndex.find(CAI);
+    if(it != Summary.CallIndex.end())
+        Reached.set(it->second);
+}
+
+//Call sites reached by the arguments of Summary.F
+static void computeArgFlow(CallFlowSummary &Summary){
+
+    Function *CallerF = Summary.F;
+    BitVector &Reached = Summary.ArgFlow;
+    Reached.resize(Summary.CallIndex.size());
+    Summary.ArgFlowDone = true;
+
     std::list<Value *> EV; //BFS record list
     std::set<Value *> PV; //Global value set to avoid loop
     EV.clear();
@@ -426,26 +447,23 @@ bool checkValidCaller(Function *CallerF, CallInst *cai){
             //Find release funcs
             CallInst *CAI = dyn_cast<CallInst>(U);
             if(CAI){
-                if(CAI == cai)
-                    return true;
+                markReachedCall(Summary, CAI, Reached);
 
-                StringRef FName = getCalledFuncName(CAI);
-                if(checkStringContainSubString(FName,"_get_drvdata")){
+                if(isGetDrvdataCall(CAI)){
                     EV.push_back(U);
                     continue;
                 }
             }
         }
     }
-
-    return false;
 }
 
-//Check if V is a arg of cai
-bool checkValidCaller(Value *V, CallInst *cai){
-    if(!V || !cai)
-        return false;
-    
+//Call sites of Summary.F reached by V
+static void computeValueFlow(CallFlowSummary &Summary, Value *V,
+    BitVector &Reached){
+
+    Reached.resize(Summary.CallIndex.size());
+
     std::list<Value *> EV; //BFS record list
     std::set<Value *> PV; //Global value set to avoid loop
     EV.clear();
@@ -479,17 +497,10 @@ bool checkValidCaller(Value *V, CallInst *cai){
             StoreInst *STI = dyn_cast<StoreInst>(U);
             if(STI){
                 Value* pop = STI->getPointerOperand();
+                //Look through a constant bitcast of the destination
                 if(auto CaI = dyn_cast<ConstantExpr>(pop)){
-                    if(CaI->isCast()){
-                        Instruction *inst = CaI->getAsInstruction();
-                        if(inst){
-                            auto BCI = dyn_cast<BitCastInst>(inst);
-                            if(BCI){
-                                Value *op = BCI->getOperand(0);
-                                EV.push_back(op);
-                            }
-                        }
-                    }
+                    if(CaI->getOpcode() == Instruction::BitCast)
+                        EV.push_back(CaI->getOperand(0));
                 }
                 EV.push_back(pop);
                 continue;
@@ -521,12 +532,45 @@ bool checkValidCaller(Value *V, CallInst *cai){
             
             //Find release funcs
             CallInst *CAI = dyn_cast<CallInst>(U);
-            if(CAI){
-                if(CAI == cai)
-                    return true;
-            }
+            if(CAI)
+                markReachedCall(Summary, CAI, Reached);
         }
     }
+}
 
-    return false;
+//The CallerF needs to pass its arguments to cai, or it's invalid
+bool checkValidCaller(Function *CallerF, CallInst *cai){
+    if(!CallerF || !cai)
+        return false;
+    
+    if(CallerF->arg_size() == 0)
+        return false;
+
+    CallFlowSummary &Summary = getCallFlowSummary(CallerF);
+    auto it = Summary.CallIndex.find(cai);
+    if(it == Summary.CallIndex.end())
+        return false;
+
+    if(!Summary.ArgFlowDone)
+        computeArgFlow(Summary);
+    return Summary.ArgFlow.test(it->second);
+}
+
+//Check if V is a arg of cai
+bool checkValidCaller(Value *V, CallInst *cai){
+    if(!V || !cai)
+        return false;
+
+    CallFlowSummary &Summary = getCallFlowSummary(cai->getFunction());
+    auto idx = Summary.CallIndex.find(cai);
+    if(idx == Summary.CallIndex.end())
+        return false;
+
+    auto it = Summary.ValueFlows.find(V);
+    if(it == Summary.ValueFlows.end()){
+        BitVector Reached;
+        computeValueFlow(Summary, V, Reached);
+        it = Summary.ValueFlows.insert(std::make_pair(V, std::move(Reached))).first;
+    }
+    return it->second.test(idx->second);
 }
\ No newline at end of file
@@ -1,3 +1,6 @@
+#ifndef _TOOLS_H
+#define _TOOLS_H
+
 #include <llvm/IR/DebugInfo.h>
 #include <llvm/Pass.h>
 #include <llvm/IR/Instructions.h>
@@ -11,6 +14,7 @@
 #include <llvm/IR/LegacyPassManager.h>
 #include <llvm/IR/InlineAsm.h>
 #include <llvm/ADT/StringExtras.h>
+#include <llvm/ADT/BitVector.h>
 #include <llvm/Analysis/CallGraph.h>
 #include <llvm/IR/Dominators.h>
 #include <llvm/Analysis/BasicAliasAnalysis.h>
@@ -61,9 +65,26 @@ void initGlobalBlockSet(Function *F, std::vector<BasicBlock*> &globalblockset);
 //If all insts are at the same line, return the line number, else return -1
 int checkBlockInstLocation(BasicBlock *bb);
 
+//Check if two sorted ranges (std::set, sorted vectors) share an element
+//Analysis sets are small, one merge walk beats a lookup per element
+template <typename SetA, typename SetB>
+bool hasCommonElement(const SetA &setA, const SetB &setB){
+    auto i = setA.begin(), ie = setA.end();
+    auto j = setB.begin(), je = setB.end();
+    while(i != ie && j != je){
+        if(*i < *j)
+            ++i;
+        else if(*j < *i)
+            ++j;
+        else
+            return true;
+    }
+    return false;
+}
+
 //Check if there exits common element of two sets
-bool findCommonOfSet(std::set<Value *> setA, std::set<Value *> setB);
-bool findCommonOfSet(std::set<std::string> setA, std::set<std::string> setB);
+bool findCommonOfSet(const std::set<Value *> &setA, const std::set<Value *> &setB);
+bool findCommonOfSet(const std::set<std::string> &setA, const std::set<std::string> &setB);
 
 // Check alias result of two values.
 bool checkAlias(Value *, Value *, PointerAnalysisMap &);
@@ -73,5 +94,10 @@ bool checkStringContainSubString(string origstr, string targetsubstr);
 //Check if there is a path from fromBB to toBB 
 bool checkBlockPairConnectivity(BasicBlock* fromBB, BasicBlock* toBB);
 
+//Callee categories for checkValidCaller, set once the classifier is built
+void setToolsCalleeClassifier(const CalleeClassifier *CC);
+
 bool checkValidCaller(Function *CallerF, CallInst *cai);
-bool checkValidCaller(Value *V, CallInst *cai);
\ No newline at end of file
+bool checkValidCaller(Value *V, CallInst *cai);
+
+#endif
\ No newline at end of file
@@ -17,6 +17,8 @@
 #include <unistd.h>
 
 #include "WrapperAnalysis.h"
+#include "SecurityChecks.h"
+#include "PairAnalysis/PairAnalysis.h"
 #include "Config.h"
 #include "Common.h"
 
@@ -25,157 +27,193 @@ using namespace std;
 
 //#define TEST_ONE_CASE "vc4_validate_shader"
 
-void WrapperAnalysisPass::findAllValidCallers(
-    Function *F, 
-    CallInst *CAI, 
-    set<Function *> &validcallers){
-    if(!F)
+//Add the effects the callees of CAI apply to the arguments V is passed
+//as to the arguments in mask
+void WrapperAnalysisPass::addCalleeEffects(CallInst *CAI, Value *V,
+    uint64_t mask, FuncEffectSummary &summary){
+
+    auto it = Ctx->Callees.find(CAI);
+    if(it == Ctx->Callees.end())
         return;
-    
-    std::list<Function *> EF; //BFS record list
-    std::set<Function *> PF; //Global value set to avoid loop
-    EF.clear();
-    PF.clear();
-    
-    CallInstSet callers = Ctx->Callers[F];
-    for(auto it = callers.begin(); it != callers.end();it++){
-        CallInst *caller = *it;
-        Function *f = caller->getFunction();
-        if(Ctx->ReleaseFuncSet.count(f->getName()) == 1)
-            continue;
-        if(Ctx->DebugFuncs.count(f->getName()))
+
+    CallerGraph &CG = Ctx->CallerCSR;
+    for(unsigned i = 0; i < CAI->getNumArgOperands() && i < 64; i++){
+        if(CAI->getArgOperand(i) != V)
             continue;
-        if(checkValidCaller(f, caller))
-            EF.push_back(f);
-    }
 
-    while (!EF.empty()) {
-        Function *TF = EF.front(); //Current checking value
-		EF.pop_front();
-            
-        if (PF.find(TF) != PF.end())
-			continue;
-        PF.insert(TF);
-
-        validcallers.insert(TF);
-        for(auto it = Ctx->Callers[TF].begin(); it != Ctx->Callers[TF].end();it++){
-            CallInst *caller = *it;
-            Function *f = caller->getFunction();
-            if(Ctx->ReleaseFuncSet.count(f->getName()) == 1)
+        for(Function *Callee : it->second){
+            if(!Callee)
                 continue;
-            if(Ctx->DebugFuncs.count(f->getName()))
+            unsigned id = CG.getID(Callee);
+            if(id == CallerGraph::InvalidID)
                 continue;
-            if(checkValidCaller(f, caller))
-                EF.push_back(f);
+
+            const FuncEffectSummary &S = Ctx->FuncSummaries[id];
+            if((S.Releases >> i) & 1)
+                summary.Releases |= mask;
+            if((S.Locks >> i) & 1)
+                summary.Locks |= mask;
+            if((S.Unlocks >> i) & 1)
+                summary.Unlocks |= mask;
         }
     }
 }
 
-void WrapperAnalysisPass::identifyResourceFuncs(Function *F){
-    if(!F)
+//Add the effects of a call to the arguments in mask when V is passed as
+//its first argument: lock and unlock functions take the lock first
+void WrapperAnalysisPass::addDirectEffects(CallInst *CAI, Value *V,
+    uint64_t mask, uint32_t categories, FuncEffectSummary &summary){
+
+    unsigned argnum = CAI->getNumArgOperands();
+    if(argnum == 0)
         return;
-    
-    //First collect all F arguments related values
-    if(F->arg_size() == 0)
+
+    if(CAI->getArgOperand(0) == V){
+        if(categories & CC_AnyLock)
+            summary.Locks |= mask;
+
+        //Ignore "_unlocked" function
+        if((categories & CC_Unlock) && !(categories & CC_Unlocked)
+            && CAI->getType()->isVoidTy())
+            summary.Unlocks |= mask;
+    }
+}
+
+//Bit i of a mask is set if argument i (or a value derived from it) is
+//passed to a function with the effect, either directly or to a callee
+//whose summary has the effect on that argument. Names of the directly
+//called release functions are collected in releasefuncs.
+void WrapperAnalysisPass::computeArgEffects(Function *F,
+    set<string> &releasefuncs, FuncEffectSummary &summary){
+
+    if(F->empty() || F->arg_size() == 0)
         return;
 
+    //Skipped and oversized functions only inherit from their callees
+    bool direct = !Ctx->SkipFuncs.count(F->getName())
+        && F->size() <= MAX_BLOCKS_SUPPORT;
+
+    //Test for one function
+#ifdef TEST_ONE_CASE
+    if(F->getName()!= TEST_ONE_CASE)
+        direct = false;
+#endif
+
     std::list<Value *> EV; //BFS record list
-    std::set<Value *> PV; //Global value set to avoid loop
-    EV.clear();
-    PV.clear();
+    DenseMap<Value *, uint64_t> ArgMasks; //Arguments each value derives from
+
+    auto propagate = [&](Value *V, uint64_t mask){
+        uint64_t &m = ArgMasks[V];
+        if((m | mask) != m){
+            m |= mask;
+            EV.push_back(V);
+        }
+    };
 
-    for(auto it = F->arg_begin(); it != F->arg_end();it++){
+    unsigned argno = 0;
+    for(auto it = F->arg_begin(); it != F->arg_end() && argno < 64; it++, argno++){
 
         Type *arg_type = it->getType();
-        if(arg_type->isPointerTy() || arg_type->isStructTy()){
-            EV.push_back(it);
-        }
+        if(arg_type->isPointerTy() || arg_type->isStructTy())
+            propagate(&*it, 1ULL << argno);
     }
 
-    int validargnum = EV.size();
-
-    //Find all arg origin values
     while (!EV.empty()) {
         Value *TV = EV.front(); //Current checking value
-		EV.pop_front();
-            
-        if (PV.find(TV) != PV.end())
-			continue;
-        PV.insert(TV);
+        EV.pop_front();
+        uint64_t mask = ArgMasks[TV];
 
         for(User *U : TV->users()){
             if(U == TV)
                 continue;
 
             Type *U_type = U->getType();
-            
-            GetElementPtrInst *GEP = dyn_cast<GetElementPtrInst>(U);
-            if(GEP){
-                if(!U_type->isPointerTy() && !U_type->isStructTy())
-                    continue;
-                EV.push_back(U);
-                continue;
-            }
 
-            LoadInst* LI = dyn_cast<LoadInst>(U);
-            if(LI){
+            if(isa<GetElementPtrInst>(U) || isa<LoadInst>(U)
+                || isa<BitCastInst>(U) || isa<PHINode>(U)){
                 if(!U_type->isPointerTy() && !U_type->isStructTy())
                     continue;
-                EV.push_back(U);
+                propagate(U, mask);
                 continue;
             }
 
-            BitCastInst *BCI = dyn_cast<BitCastInst>(U);
-            if(BCI){
-                if(!U_type->isPointerTy() && !U_type->isStructTy())
-                    continue;
-                EV.push_back(U);
+            //Find release funcs
+            CallInst *CAI = dyn_cast<CallInst>(U);
+            if(!CAI)
                 continue;
-            }
 
-            PHINode *PN = dyn_cast<PHINode>(U);
-            if(PN){
-                if(!U_type->isPointerTy() && !U_type->isStructTy())
-                    continue;
-                EV.push_back(U);
-                continue;
+            uint32_t categories = Ctx->CalleeClasses.get(CAI);
+            if(direct && (categories & CC_AnyFree)){
+                releasefuncs.insert(getCalledFuncName(CAI));
+                summary.Releases |= mask;
             }
-            
-            //Find release funcs
-            CallInst *CAI = dyn_cast<CallInst>(U);
-            if(CAI){
+            if(direct)
+                addDirectEffects(CAI, TV, mask, categories, summary);
+            addCalleeEffects(CAI, TV, mask, summary);
 
-                StringRef BB_FName = getCalledFuncName(CAI);
-                if(BB_FName.contains("free") || BB_FName.contains("release")){
+            if(categories & CC_GetDrvdata)
+                propagate(U, mask);
+        }
+    }
 
-                    Ctx->ReleaseFuncSet.insert(BB_FName);
+    if(Ctx->CalleeClasses.get(F) & CC_Debug)
+        summary = FuncEffectSummary();
+}
 
-                    if(Ctx->ReleaseFuncSet.count(F->getName()) == 1)
-                        continue;
-                    if(Ctx->DebugFuncs.count(F->getName()))
-                        continue;
+bool WrapperAnalysisPass::firstCalleeMayReturnErr(CallInst *CI, bool pairErrno){
 
-                    //if(validargnum >=2)
-                    //    continue;
+    auto it = Ctx->Callees.find(CI);
+    if(it == Ctx->Callees.end() || it->second.empty())
+        return false;
 
-                    Ctx->ReleaseFuncSet.insert(F->getName());
-                    set<Function *> validcallers;
-                    findAllValidCallers(F,CAI,validcallers);
-                    for(auto it = validcallers.begin();it != validcallers.end();it++){
-                        Function *f = *it;
-                        //OP<<"F: "<<f->getName()<<"\n";
-                        Ctx->ReleaseFuncSet.insert(f->getName());
-                    }
-                }
-                
-                if(BB_FName.contains("_get_drvdata")){
-                    EV.push_back(U);
-                    continue;
-                }
-                
-            }
+    Function *CF = *(it->second.begin());
+    if(!CF)
+        return false;
+    const FuncEffectSummary &S = Ctx->getFuncSummary(CF);
+    return pairErrno ? S.MayReturnPairErr : S.MayReturnErr;
+}
+
+//F may return an error if it or a function it reaches through direct
+//calls and returned calls stores an errno, calls ERR_PTR/PTR_ERR or gets
+//a pointer from a call. Only the first callee of a call is followed.
+//pairErrno selects the errno predicate of PairAnalysisPass instead of
+//the one of SecurityChecksPass.
+bool WrapperAnalysisPass::computeMayReturnErr(Function *F, bool pairErrno){
+
+    for(inst_iterator i = inst_begin(F), ei = inst_end(F); i != ei; ++i){
+        Instruction *I = &*i;
+
+        StoreInst *SI = dyn_cast<StoreInst>(I);
+        if(SI){
+            Value *SV = SI->getValueOperand();
+            if(pairErrno ? PairAnalysisPass::isValueErrno(SV, F)
+                : SecurityChecksPass::isValueErrno(SV, F))
+                return true;
+            continue;
+        }
+
+        CallInst *CI = dyn_cast<CallInst>(I);
+        if(CI){
+            if(CI->getType()->isPointerTy())
+                return true;
+            if(!CI->getCalledFunction())
+                continue;
+            StringRef FName = getCalledFuncName(CI);
+            if(FName == "ERR_PTR" || FName == "PTR_ERR")
+                return true;
+            if(firstCalleeMayReturnErr(CI, pairErrno))
+                return true;
+            continue;
+        }
+
+        ReturnInst *RI = dyn_cast<ReturnInst>(I);
+        if(RI){
+            CallInst *RCI = dyn_cast_or_null<CallInst>(RI->getReturnValue());
+            if(RCI && firstCalleeMayReturnErr(RCI, pairErrno))
+                return true;
         }
     }
+    return false;
 }
 
 bool WrapperAnalysisPass::doInitialization(Module *M) {
@@ -187,32 +225,85 @@ bool WrapperAnalysisPass::doFinalization(Module *M) {
 }
 
 bool WrapperAnalysisPass::doModulePass(Module *M) {
+    return false;
+}
 
-    //Find function wrappers for each function
-	for(Module::iterator f = M->begin(), fe = M->end();
-			f != fe; ++f) {
-		Function *F = &*f;
-
-		if (F->empty())
-			continue;
-        
-        //OP << F->getName() <<"\n";
-        
-        //Skip functions in skipfunc list
-        if(1 == Ctx->SkipFuncs.count(F->getName()))
-            continue;
+//Summaries are computed once per function, callees before callers, so the
+//result does not depend on the module order. Release wrappers are the
+//functions whose summary releases an argument. Copies in DuplicateFuncs
+//are summarized as well: callers in their module reach the copy, and its
+//callees (e.g. static functions of that module) may differ from those of
+//the analyzed body.
+void WrapperAnalysisPass::run(ModuleList &modules) {
 
-		if (F->size() > MAX_BLOCKS_SUPPORT)
-			continue;
+    CallerGraph &CG = Ctx->CallerCSR;
+    vector<vector<unsigned>> SCCs;
+    vector<unsigned> SCCOf;
+    CG.computeSCCs(SCCs, SCCOf);
 
-        //Test for one function
-#ifdef TEST_ONE_CASE
-        if(F->getName()!= TEST_ONE_CASE){
-            continue;
+    //SCCs on the same level never call each other: the level of an SCC
+    //is one above the highest level of its callees
+    vector<unsigned> levels(SCCs.size(), 0);
+    vector<vector<unsigned>> levelSCCs;
+    vector<bool> recursive(SCCs.size(), false);
+    for(unsigned s = 0; s < SCCs.size(); s++){
+        if(levels[s] >= levelSCCs.size())
+            levelSCCs.resize(levels[s] + 1);
+        levelSCCs[levels[s]].push_back(s);
+
+        for(unsigned m : SCCs[s]){
+            for(unsigned e = CG.edgeBegin(m); e != CG.edgeEnd(m); e++){
+                unsigned caller = SCCOf[CG.getCallerID(e)];
+                if(caller == s)
+                    recursive[s] = true;
+                else
+                    levels[caller] = max(levels[caller], levels[s] + 1);
+            }
         }
-#endif
+    }
+
+    OP << "[" << ID << "] " << CG.size() << " functions, " << SCCs.size()
+        << " SCCs, " << levelSCCs.size() << " levels\n";
+
+    Ctx->FuncSummaries.assign(CG.size(), FuncEffectSummary());
+    for(unsigned l = 0; l < levelSCCs.size(); l++){
+        vector<unsigned> &scclist = levelSCCs[l];
+
+        #pragma omp parallel for schedule(dynamic)
+        for(int k = 0; k < (int)scclist.size(); k++){
+            vector<unsigned> &members = SCCs[scclist[k]];
+            set<string> releasefuncs;
+
+            //Summaries only grow, iterate recursive SCCs to a fixpoint
+            bool changed = true;
+            while(changed){
+                changed = false;
+                for(unsigned m : members){
+                    Function *F = CG.getFunc(m);
+                    FuncEffectSummary summary;
+                    computeArgEffects(F, releasefuncs, summary);
+                    summary.MayReturnErr = computeMayReturnErr(F, false);
+                    summary.MayReturnPairErr = computeMayReturnErr(F, true);
+                    if(summary != Ctx->FuncSummaries[m]){
+                        Ctx->FuncSummaries[m] = summary;
+                        changed = true;
+                    }
+                }
+                changed &= recursive[scclist[k]];
+            }
 
-        identifyResourceFuncs(F);
-	}
-	return false;
-}
\ No newline at end of file
+            for(unsigned m : members){
+                if(Ctx->FuncSummaries[m].Releases)
+                    releasefuncs.insert(CG.getFunc(m)->getName());
+            }
+
+            #pragma omp critical(ReleaseFuncSet)
+            Ctx->ReleaseFuncSet.insert(releasefuncs.begin(), releasefuncs.end());
+        }
+    }
+
+    Ctx->CalleeClasses.refresh(CC_ReleaseFunc);
+
+    OP << "[" << ID << "] Found " << Ctx->ReleaseFuncSet.size() << " release functions\n";
+    OP << "[" << ID << "] Done!\n\n";
+}
@@ -9,11 +9,15 @@ class WrapperAnalysisPass : public IterativeModulePass {
 
     private:
 
-        //Find release function wrappers
-        void identifyResourceFuncs(Function *F);
-        void findAllValidCallers(Function *F, CallInst *CAI, 
-        set<Function *> &validcallers);
-    
+        //Compute function summaries bottom-up over the call graph SCCs
+        void computeArgEffects(Function *F, set<string> &releasefuncs,
+            FuncEffectSummary &summary);
+        void addDirectEffects(CallInst *CAI, Value *V, uint64_t mask,
+            uint32_t categories, FuncEffectSummary &summary);
+        void addCalleeEffects(CallInst *CAI, Value *V, uint64_t mask,
+            FuncEffectSummary &summary);
+        bool computeMayReturnErr(Function *F, bool pairErrno);
+        bool firstCalleeMayReturnErr(CallInst *CI, bool pairErrno);
 
     public:
         WrapperAnalysisPass(GlobalContext *Ctx_)
@@ -21,6 +25,7 @@ class WrapperAnalysisPass : public IterativeModulePass {
         virtual bool doInitialization(llvm::Module *);
         virtual bool doFinalization(llvm::Module *);
         virtual bool doModulePass(llvm::Module *);
+        virtual void run(ModuleList &modules);
 
 };
 
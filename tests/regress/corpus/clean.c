@@ -0,0 +1,27 @@
+#include "regress.h"
+
+/* Every error path releases what it acquired: no reports expected */
+int dev_update(struct dev *d, int val)
+{
+	char *buf;
+	int ret;
+
+	mutex_lock(&d->lock);
+	buf = kmalloc(FW_SIZE, GFP_KERNEL);
+	if (!buf) {
+		ret = -ENOMEM;
+		goto out_unlock;
+	}
+	ret = hw_read(d, buf);
+	if (ret < 0)
+		goto out_free;
+	ret = hw_write(d, val);
+	if (ret < 0)
+		goto out_free;
+	d->state = val;
+out_free:
+	kfree(buf);
+out_unlock:
+	mutex_unlock(&d->lock);
+	return ret;
+}
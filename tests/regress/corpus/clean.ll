@@ -0,0 +1,78 @@
+; ModuleID = 'clean.c'
+source_filename = "clean.c"
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+%struct.dev = type { %struct.mutex, i32, i8*, [2 x i32], %struct.device* }
+%struct.mutex = type { i64 }
+%struct.device = type opaque
+
+define dso_local i32 @dev_update(%struct.dev* %d, i32 %val) !dbg !7 {
+entry:
+  %lock = getelementptr inbounds %struct.dev, %struct.dev* %d, i64 0, i32 0, !dbg !10
+  call void @mutex_lock(%struct.mutex* %lock), !dbg !11
+  %call = call i8* @kmalloc(i64 4096, i32 3264), !dbg !12
+  %tobool = icmp eq i8* %call, null, !dbg !13
+  br i1 %tobool, label %out_unlock, label %if.end, !dbg !14
+
+if.end:
+  %call1 = call i32 @hw_read(%struct.dev* %d, i8* %call), !dbg !15
+  %cmp = icmp slt i32 %call1, 0, !dbg !16
+  br i1 %cmp, label %out_free, label %if.end4, !dbg !17
+
+if.end4:
+  %call5 = call i32 @hw_write(%struct.dev* %d, i32 %val), !dbg !18
+  %cmp6 = icmp slt i32 %call5, 0, !dbg !19
+  br i1 %cmp6, label %out_free, label %if.end8, !dbg !20
+
+if.end8:
+  %state = getelementptr inbounds %struct.dev, %struct.dev* %d, i64 0, i32 1, !dbg !21
+  store i32 %val, i32* %state, align 8, !dbg !22
+  br label %out_free, !dbg !22
+
+out_free:
+  %ret.0 = phi i32 [ %call1, %if.end ], [ %call5, %if.end4 ], [ %call5, %if.end8 ]
+  call void @kfree(i8* %call), !dbg !23
+  br label %out_unlock, !dbg !23
+
+out_unlock:
+  %ret.1 = phi i32 [ -12, %entry ], [ %ret.0, %out_free ]
+  call void @mutex_unlock(%struct.mutex* %lock), !dbg !24
+  ret i32 %ret.1, !dbg !25
+}
+
+declare dso_local i8* @kmalloc(i64, i32)
+declare dso_local void @kfree(i8*)
+declare dso_local void @mutex_lock(%struct.mutex*)
+declare dso_local void @mutex_unlock(%struct.mutex*)
+declare dso_local i32 @hw_read(%struct.dev*, i8*)
+declare dso_local i32 @hw_write(%struct.dev*, i32)
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3, !4}
+!llvm.ident = !{!5}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "clang version 9.0.0", isOptimized: true, runtimeVersion: 0, emissionKind: FullDebug, enums: !2)
+!1 = !DIFile(filename: "clean.c", directory: "tests/regress/corpus")
+!2 = !{}
+!3 = !{i32 2, !"Dwarf Version", i32 4}
+!4 = !{i32 2, !"Debug Info Version", i32 3}
+!5 = !{!"clang version 9.0.0"}
+!7 = distinct !DISubprogram(name: "dev_update", scope: !1, file: !1, line: 4, type: !8, scopeLine: 5, flags: DIFlagPrototyped, spFlags: DISPFlagDefinition | DISPFlagOptimized, unit: !0, retainedNodes: !2)
+!8 = !DISubroutineType(types: !2)
+!10 = !DILocation(line: 9, column: 15, scope: !7)
+!11 = !DILocation(line: 9, column: 2, scope: !7)
+!12 = !DILocation(line: 10, column: 8, scope: !7)
+!13 = !DILocation(line: 11, column: 7, scope: !7)
+!14 = !DILocation(line: 11, column: 6, scope: !7)
+!15 = !DILocation(line: 15, column: 8, scope: !7)
+!16 = !DILocation(line: 16, column: 10, scope: !7)
+!17 = !DILocation(line: 16, column: 6, scope: !7)
+!18 = !DILocation(line: 18, column: 8, scope: !7)
+!19 = !DILocation(line: 19, column: 10, scope: !7)
+!20 = !DILocation(line: 19, column: 6, scope: !7)
+!21 = !DILocation(line: 21, column: 5, scope: !7)
+!22 = !DILocation(line: 21, column: 11, scope: !7)
+!23 = !DILocation(line: 23, column: 2, scope: !7)
+!24 = !DILocation(line: 25, column: 2, scope: !7)
+!25 = !DILocation(line: 26, column: 2, scope: !7)
@@ -0,0 +1,19 @@
+#include "regress.h"
+
+/* Only one of the two slots checks the new ID */
+int dev_add_id(struct dev *d, int slot)
+{
+	int id;
+
+	if (slot) {
+		id = ida_alloc(d);
+		if (id < 0)
+			return -ENOSPC;
+		d->ids[1] = id;
+	} else {
+		id = ida_alloc(d);	/* BUG: id is not checked */
+		d->ids[0] = id;
+	}
+	hw_write(d, id);
+	return 0;
+}
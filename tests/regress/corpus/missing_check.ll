@@ -0,0 +1,68 @@
+; ModuleID = 'missing_check.c'
+source_filename = "missing_check.c"
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+%struct.dev = type { %struct.mutex, i32, i8*, [2 x i32], %struct.device* }
+%struct.mutex = type { i64 }
+%struct.device = type opaque
+
+define dso_local i32 @dev_add_id(%struct.dev* %d, i32 %slot) !dbg !7 {
+entry:
+  %tobool = icmp eq i32 %slot, 0, !dbg !10
+  br i1 %tobool, label %if.else, label %if.then, !dbg !10
+
+if.then:
+  %call = call i32 @ida_alloc(%struct.dev* %d), !dbg !11
+  %cmp = icmp slt i32 %call, 0, !dbg !12
+  br i1 %cmp, label %return, label %if.end, !dbg !13
+
+if.end:
+  %arrayidx = getelementptr inbounds %struct.dev, %struct.dev* %d, i64 0, i32 3, i64 1, !dbg !14
+  store i32 %call, i32* %arrayidx, align 4, !dbg !15
+  br label %if.end6, !dbg !16
+
+if.else:
+  %call3 = call i32 @ida_alloc(%struct.dev* %d), !dbg !17
+  %arrayidx5 = getelementptr inbounds %struct.dev, %struct.dev* %d, i64 0, i32 3, i64 0, !dbg !18
+  store i32 %call3, i32* %arrayidx5, align 8, !dbg !19
+  br label %if.end6
+
+if.end6:
+  %id.0 = phi i32 [ %call, %if.end ], [ %call3, %if.else ]
+  %call7 = call i32 @hw_write(%struct.dev* %d, i32 %id.0), !dbg !20
+  br label %return, !dbg !22
+
+return:
+  %retval.0 = phi i32 [ -28, %if.then ], [ 0, %if.end6 ]
+  ret i32 %retval.0, !dbg !21
+}
+
+declare dso_local i32 @ida_alloc(%struct.dev*)
+declare dso_local i32 @hw_write(%struct.dev*, i32)
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3, !4}
+!llvm.ident = !{!5}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "clang version 9.0.0", isOptimized: true, runtimeVersion: 0, emissionKind: FullDebug, enums: !2)
+!1 = !DIFile(filename: "missing_check.c", directory: "tests/regress/corpus")
+!2 = !{}
+!3 = !{i32 2, !"Dwarf Version", i32 4}
+!4 = !{i32 2, !"Debug Info Version", i32 3}
+!5 = !{!"clang version 9.0.0"}
+!7 = distinct !DISubprogram(name: "dev_add_id", scope: !1, file: !1, line: 4, type: !8, scopeLine: 5, flags: DIFlagPrototyped, spFlags: DISPFlagDefinition | DISPFlagOptimized, unit: !0, retainedNodes: !2)
+!8 = !DISubroutineType(types: !2)
+!10 = !DILocation(line: 8, column: 6, scope: !7)
+!11 = !DILocation(line: 9, column: 8, scope: !7)
+!12 = !DILocation(line: 10, column: 10, scope: !7)
+!13 = !DILocation(line: 10, column: 7, scope: !7)
+!14 = !DILocation(line: 12, column: 3, scope: !7)
+!15 = !DILocation(line: 12, column: 13, scope: !7)
+!16 = !DILocation(line: 13, column: 2, scope: !7)
+!17 = !DILocation(line: 14, column: 8, scope: !7)
+!18 = !DILocation(line: 15, column: 3, scope: !7)
+!19 = !DILocation(line: 15, column: 13, scope: !7)
+!20 = !DILocation(line: 17, column: 2, scope: !7)
+!21 = !DILocation(line: 19, column: 1, scope: !7)
+!22 = !DILocation(line: 18, column: 2, scope: !7)
@@ -0,0 +1,22 @@
+#include "regress.h"
+
+int dev_load_fw(struct dev *d)
+{
+	char *buf;
+	int ret;
+
+	buf = kmalloc(FW_SIZE, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+	ret = hw_read(d, buf);
+	if (ret < 0)
+		goto out_free;
+	ret = hw_verify(d, buf);
+	if (ret < 0)
+		return ret;	/* BUG: buf is leaked */
+	d->fw = buf;
+	return 0;
+out_free:
+	kfree(buf);
+	return ret;
+}
@@ -0,0 +1,71 @@
+; ModuleID = 'missing_release.c'
+source_filename = "missing_release.c"
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+%struct.dev = type { %struct.mutex, i32, i8*, [2 x i32], %struct.device* }
+%struct.mutex = type { i64 }
+%struct.device = type opaque
+
+define dso_local i32 @dev_load_fw(%struct.dev* %d) !dbg !7 {
+entry:
+  %call = call i8* @kmalloc(i64 4096, i32 3264), !dbg !10
+  %tobool = icmp eq i8* %call, null, !dbg !11
+  br i1 %tobool, label %return, label %if.end, !dbg !12
+
+if.end:
+  %call1 = call i32 @hw_read(%struct.dev* %d, i8* %call), !dbg !13
+  %cmp = icmp slt i32 %call1, 0, !dbg !14
+  br i1 %cmp, label %out_free, label %if.end3, !dbg !15
+
+if.end3:
+  %call4 = call i32 @hw_verify(%struct.dev* %d, i8* %call), !dbg !16
+  %cmp5 = icmp slt i32 %call4, 0, !dbg !17
+  br i1 %cmp5, label %return, label %if.end7, !dbg !18
+
+if.end7:
+  %fw = getelementptr inbounds %struct.dev, %struct.dev* %d, i64 0, i32 2, !dbg !19
+  store i8* %call, i8** %fw, align 8, !dbg !20
+  br label %return, !dbg !21
+
+out_free:
+  call void @kfree(i8* %call), !dbg !22
+  br label %return, !dbg !23
+
+return:
+  %retval.0 = phi i32 [ -12, %entry ], [ %call4, %if.end3 ], [ 0, %if.end7 ], [ %call1, %out_free ]
+  ret i32 %retval.0, !dbg !24
+}
+
+declare dso_local i8* @kmalloc(i64, i32)
+declare dso_local void @kfree(i8*)
+declare dso_local i32 @hw_read(%struct.dev*, i8*)
+declare dso_local i32 @hw_verify(%struct.dev*, i8*)
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3, !4}
+!llvm.ident = !{!5}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "clang version 9.0.0", isOptimized: true, runtimeVersion: 0, emissionKind: FullDebug, enums: !2)
+!1 = !DIFile(filename: "missing_release.c", directory: "tests/regress/corpus")
+!2 = !{}
+!3 = !{i32 2, !"Dwarf Version", i32 4}
+!4 = !{i32 2, !"Debug Info Version", i32 3}
+!5 = !{!"clang version 9.0.0"}
+!7 = distinct !DISubprogram(name: "dev_load_fw", scope: !1, file: !1, line: 3, type: !8, scopeLine: 4, flags: DIFlagPrototyped, spFlags: DISPFlagDefinition | DISPFlagOptimized, unit: !0, retainedNodes: !2)
+!8 = !DISubroutineType(types: !2)
+!10 = !DILocation(line: 8, column: 8, scope: !7)
+!11 = !DILocation(line: 9, column: 7, scope: !7)
+!12 = !DILocation(line: 9, column: 6, scope: !7)
+!13 = !DILocation(line: 11, column: 8, scope: !7)
+!14 = !DILocation(line: 12, column: 10, scope: !7)
+!15 = !DILocation(line: 12, column: 6, scope: !7)
+!16 = !DILocation(line: 14, column: 8, scope: !7)
+!17 = !DILocation(line: 15, column: 10, scope: !7)
+!18 = !DILocation(line: 15, column: 6, scope: !7)
+!19 = !DILocation(line: 17, column: 5, scope: !7)
+!20 = !DILocation(line: 17, column: 8, scope: !7)
+!21 = !DILocation(line: 18, column: 2, scope: !7)
+!22 = !DILocation(line: 20, column: 2, scope: !7)
+!23 = !DILocation(line: 21, column: 2, scope: !7)
+!24 = !DILocation(line: 22, column: 1, scope: !7)
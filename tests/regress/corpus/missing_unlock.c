@@ -0,0 +1,18 @@
+#include "regress.h"
+
+int dev_set_state(struct dev *d, int state)
+{
+	int ret;
+
+	mutex_lock(&d->lock);
+	ret = hw_prepare(d);
+	if (ret < 0)
+		goto out_unlock;
+	ret = hw_write(d, state);
+	if (ret < 0)
+		return ret;	/* BUG: d->lock is still held */
+	d->state = state;
+out_unlock:
+	mutex_unlock(&d->lock);
+	return ret;
+}
@@ -0,0 +1,67 @@
+; ModuleID = 'missing_unlock.c'
+source_filename = "missing_unlock.c"
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+%struct.dev = type { %struct.mutex, i32, i8*, [2 x i32], %struct.device* }
+%struct.mutex = type { i64 }
+%struct.device = type opaque
+
+define dso_local i32 @dev_set_state(%struct.dev* %d, i32 %state) !dbg !7 {
+entry:
+  %lock = getelementptr inbounds %struct.dev, %struct.dev* %d, i64 0, i32 0, !dbg !10
+  call void @mutex_lock(%struct.mutex* %lock), !dbg !11
+  %call = call i32 @hw_prepare(%struct.dev* %d), !dbg !12
+  %cmp = icmp slt i32 %call, 0, !dbg !13
+  br i1 %cmp, label %out_unlock, label %if.end, !dbg !14
+
+if.end:
+  %call1 = call i32 @hw_write(%struct.dev* %d, i32 %state), !dbg !15
+  %cmp2 = icmp slt i32 %call1, 0, !dbg !16
+  br i1 %cmp2, label %return, label %if.end4, !dbg !17
+
+if.end4:
+  %state5 = getelementptr inbounds %struct.dev, %struct.dev* %d, i64 0, i32 1, !dbg !18
+  store i32 %state, i32* %state5, align 8, !dbg !19
+  br label %out_unlock, !dbg !19
+
+out_unlock:
+  %ret.0 = phi i32 [ %call, %entry ], [ %call1, %if.end4 ]
+  call void @mutex_unlock(%struct.mutex* %lock), !dbg !20
+  br label %return, !dbg !21
+
+return:
+  %retval.0 = phi i32 [ %call1, %if.end ], [ %ret.0, %out_unlock ]
+  ret i32 %retval.0, !dbg !22
+}
+
+declare dso_local void @mutex_lock(%struct.mutex*)
+declare dso_local void @mutex_unlock(%struct.mutex*)
+declare dso_local i32 @hw_prepare(%struct.dev*)
+declare dso_local i32 @hw_write(%struct.dev*, i32)
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3, !4}
+!llvm.ident = !{!5}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "clang version 9.0.0", isOptimized: true, runtimeVersion: 0, emissionKind: FullDebug, enums: !2)
+!1 = !DIFile(filename: "missing_unlock.c", directory: "tests/regress/corpus")
+!2 = !{}
+!3 = !{i32 2, !"Dwarf Version", i32 4}
+!4 = !{i32 2, !"Debug Info Version", i32 3}
+!5 = !{!"clang version 9.0.0"}
+!7 = distinct !DISubprogram(name: "dev_set_state", scope: !1, file: !1, line: 3, type: !8, scopeLine: 4, flags: DIFlagPrototyped, spFlags: DISPFlagDefinition | DISPFlagOptimized, unit: !0, retainedNodes: !2)
+!8 = !DISubroutineType(types: !2)
+!10 = !DILocation(line: 7, column: 16, scope: !7)
+!11 = !DILocation(line: 7, column: 2, scope: !7)
+!12 = !DILocation(line: 8, column: 8, scope: !7)
+!13 = !DILocation(line: 9, column: 10, scope: !7)
+!14 = !DILocation(line: 9, column: 6, scope: !7)
+!15 = !DILocation(line: 11, column: 8, scope: !7)
+!16 = !DILocation(line: 12, column: 10, scope: !7)
+!17 = !DILocation(line: 12, column: 6, scope: !7)
+!18 = !DILocation(line: 14, column: 5, scope: !7)
+!19 = !DILocation(line: 14, column: 11, scope: !7)
+!20 = !DILocation(line: 16, column: 2, scope: !7)
+!21 = !DILocation(line: 17, column: 2, scope: !7)
+!22 = !DILocation(line: 18, column: 1, scope: !7)
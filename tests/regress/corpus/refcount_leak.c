@@ -0,0 +1,17 @@
+#include "regress.h"
+
+int dev_runtime_op(struct device *dev, int op)
+{
+	int ret;
+
+	ret = pm_runtime_get_sync(dev);
+	if (ret < 0)
+		return ret;	/* BUG: the usage count is not dropped */
+	ret = hw_op(dev, op);
+	if (ret < 0) {
+		pm_runtime_put_noidle(dev);
+		return ret;
+	}
+	pm_runtime_put(dev);
+	return 0;
+}
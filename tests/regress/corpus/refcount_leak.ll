@@ -0,0 +1,59 @@
+; ModuleID = 'refcount_leak.c'
+source_filename = "refcount_leak.c"
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+%struct.device = type opaque
+
+define dso_local i32 @dev_runtime_op(%struct.device* %dev, i32 %op) !dbg !7 {
+entry:
+  %call = call i32 @pm_runtime_get_sync(%struct.device* %dev), !dbg !10
+  %cmp = icmp slt i32 %call, 0, !dbg !11
+  br i1 %cmp, label %return, label %if.end, !dbg !12
+
+if.end:
+  %call1 = call i32 @hw_op(%struct.device* %dev, i32 %op), !dbg !13
+  %cmp2 = icmp slt i32 %call1, 0, !dbg !14
+  br i1 %cmp2, label %if.then3, label %if.end4, !dbg !15
+
+if.then3:
+  call void @pm_runtime_put_noidle(%struct.device* %dev), !dbg !16
+  br label %return, !dbg !17
+
+if.end4:
+  %call5 = call i32 @pm_runtime_put(%struct.device* %dev), !dbg !18
+  br label %return, !dbg !19
+
+return:
+  %retval.0 = phi i32 [ %call, %entry ], [ %call1, %if.then3 ], [ 0, %if.end4 ]
+  ret i32 %retval.0, !dbg !20
+}
+
+declare dso_local i32 @pm_runtime_get_sync(%struct.device*)
+declare dso_local i32 @pm_runtime_put(%struct.device*)
+declare dso_local void @pm_runtime_put_noidle(%struct.device*)
+declare dso_local i32 @hw_op(%struct.device*, i32)
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3, !4}
+!llvm.ident = !{!5}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "clang version 9.0.0", isOptimized: true, runtimeVersion: 0, emissionKind: FullDebug, enums: !2)
+!1 = !DIFile(filename: "refcount_leak.c", directory: "tests/regress/corpus")
+!2 = !{}
+!3 = !{i32 2, !"Dwarf Version", i32 4}
+!4 = !{i32 2, !"Debug Info Version", i32 3}
+!5 = !{!"clang version 9.0.0"}
+!7 = distinct !DISubprogram(name: "dev_runtime_op", scope: !1, file: !1, line: 3, type: !8, scopeLine: 4, flags: DIFlagPrototyped, spFlags: DISPFlagDefinition | DISPFlagOptimized, unit: !0, retainedNodes: !2)
+!8 = !DISubroutineType(types: !2)
+!10 = !DILocation(line: 7, column: 8, scope: !7)
+!11 = !DILocation(line: 8, column: 10, scope: !7)
+!12 = !DILocation(line: 8, column: 6, scope: !7)
+!13 = !DILocation(line: 10, column: 8, scope: !7)
+!14 = !DILocation(line: 11, column: 10, scope: !7)
+!15 = !DILocation(line: 11, column: 6, scope: !7)
+!16 = !DILocation(line: 12, column: 3, scope: !7)
+!17 = !DILocation(line: 13, column: 3, scope: !7)
+!18 = !DILocation(line: 15, column: 2, scope: !7)
+!19 = !DILocation(line: 16, column: 2, scope: !7)
+!20 = !DILocation(line: 17, column: 1, scope: !7)
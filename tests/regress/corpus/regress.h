@@ -0,0 +1,37 @@
+/* Kernel declarations shared by the regression corpus */
+#ifndef _REGRESS_H
+#define _REGRESS_H
+
+#define ENOMEM		12
+#define ENOSPC		28
+#define GFP_KERNEL	0xcc0
+#define FW_SIZE		4096
+
+struct mutex { long owner; };
+struct device;
+
+struct dev {
+	struct mutex lock;
+	int state;
+	char *fw;
+	int ids[2];
+	struct device *parent;
+};
+
+void mutex_lock(struct mutex *lock);
+void mutex_unlock(struct mutex *lock);
+void *kmalloc(unsigned long size, unsigned int flags);
+void kfree(const void *p);
+int pm_runtime_get_sync(struct device *dev);
+int pm_runtime_put(struct device *dev);
+void pm_runtime_put_noidle(struct device *dev);
+int ida_alloc(struct dev *d);
+void pr_err(const char *fmt, ...);
+
+int hw_prepare(struct dev *d);
+int hw_write(struct dev *d, int val);
+int hw_read(struct dev *d, char *buf);
+int hw_verify(struct dev *d, char *buf);
+int hw_op(struct device *dev, int op);
+
+#endif
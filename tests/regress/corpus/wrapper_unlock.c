@@ -0,0 +1,29 @@
+#include "regress.h"
+
+/* Compiled with -fno-inline, so the wrappers stay calls */
+static void dev_lock(struct dev *d)
+{
+	mutex_lock(&d->lock);
+}
+
+static void dev_unlock(struct dev *d)
+{
+	mutex_unlock(&d->lock);
+}
+
+int dev_reset(struct dev *d, int mode)
+{
+	int ret;
+
+	dev_lock(d);
+	ret = hw_prepare(d);
+	if (ret < 0) {
+		dev_unlock(d);
+		return ret;
+	}
+	ret = hw_write(d, mode);
+	if (ret < 0)
+		return ret;	/* BUG: dev_unlock() is missing */
+	dev_unlock(d);
+	return 0;
+}
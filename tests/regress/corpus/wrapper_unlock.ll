@@ -0,0 +1,87 @@
+; ModuleID = 'wrapper_unlock.c'
+source_filename = "wrapper_unlock.c"
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+%struct.dev = type { %struct.mutex, i32, i8*, [2 x i32], %struct.device* }
+%struct.mutex = type { i64 }
+%struct.device = type opaque
+
+define internal void @dev_lock(%struct.dev* %d) #0 !dbg !7 {
+entry:
+  %lock = getelementptr inbounds %struct.dev, %struct.dev* %d, i64 0, i32 0, !dbg !10
+  call void @mutex_lock(%struct.mutex* %lock), !dbg !11
+  ret void, !dbg !12
+}
+
+define internal void @dev_unlock(%struct.dev* %d) #0 !dbg !13 {
+entry:
+  %lock = getelementptr inbounds %struct.dev, %struct.dev* %d, i64 0, i32 0, !dbg !14
+  call void @mutex_unlock(%struct.mutex* %lock), !dbg !15
+  ret void, !dbg !16
+}
+
+define dso_local i32 @dev_reset(%struct.dev* %d, i32 %mode) !dbg !17 {
+entry:
+  call void @dev_lock(%struct.dev* %d), !dbg !18
+  %call = call i32 @hw_prepare(%struct.dev* %d), !dbg !19
+  %cmp = icmp slt i32 %call, 0, !dbg !20
+  br i1 %cmp, label %if.then, label %if.end, !dbg !21
+
+if.then:
+  call void @dev_unlock(%struct.dev* %d), !dbg !22
+  br label %return, !dbg !23
+
+if.end:
+  %call1 = call i32 @hw_write(%struct.dev* %d, i32 %mode), !dbg !24
+  %cmp2 = icmp slt i32 %call1, 0, !dbg !25
+  br i1 %cmp2, label %return, label %if.end4, !dbg !26
+
+if.end4:
+  call void @dev_unlock(%struct.dev* %d), !dbg !27
+  br label %return, !dbg !28
+
+return:
+  %retval.0 = phi i32 [ %call, %if.then ], [ %call1, %if.end ], [ 0, %if.end4 ]
+  ret i32 %retval.0, !dbg !29
+}
+
+declare dso_local void @mutex_lock(%struct.mutex*)
+declare dso_local void @mutex_unlock(%struct.mutex*)
+declare dso_local i32 @hw_prepare(%struct.dev*)
+declare dso_local i32 @hw_write(%struct.dev*, i32)
+
+attributes #0 = { noinline nounwind }
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3, !4}
+!llvm.ident = !{!5}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "clang version 9.0.0", isOptimized: true, runtimeVersion: 0, emissionKind: FullDebug, enums: !2)
+!1 = !DIFile(filename: "wrapper_unlock.c", directory: "tests/regress/corpus")
+!2 = !{}
+!3 = !{i32 2, !"Dwarf Version", i32 4}
+!4 = !{i32 2, !"Debug Info Version", i32 3}
+!5 = !{!"clang version 9.0.0"}
+!7 = distinct !DISubprogram(name: "dev_lock", scope: !1, file: !1, line: 4, type: !8, scopeLine: 5, flags: DIFlagPrototyped, spFlags: DISPFlagLocalToUnit | DISPFlagDefinition | DISPFlagOptimized, unit: !0, retainedNodes: !2)
+!8 = !DISubroutineType(types: !2)
+!10 = !DILocation(line: 6, column: 16, scope: !7)
+!11 = !DILocation(line: 6, column: 2, scope: !7)
+!12 = !DILocation(line: 7, column: 1, scope: !7)
+!13 = distinct !DISubprogram(name: "dev_unlock", scope: !1, file: !1, line: 9, type: !8, scopeLine: 10, flags: DIFlagPrototyped, spFlags: DISPFlagLocalToUnit | DISPFlagDefinition | DISPFlagOptimized, unit: !0, retainedNodes: !2)
+!14 = !DILocation(line: 11, column: 18, scope: !13)
+!15 = !DILocation(line: 11, column: 2, scope: !13)
+!16 = !DILocation(line: 12, column: 1, scope: !13)
+!17 = distinct !DISubprogram(name: "dev_reset", scope: !1, file: !1, line: 14, type: !8, scopeLine: 15, flags: DIFlagPrototyped, spFlags: DISPFlagDefinition | DISPFlagOptimized, unit: !0, retainedNodes: !2)
+!18 = !DILocation(line: 18, column: 2, scope: !17)
+!19 = !DILocation(line: 19, column: 8, scope: !17)
+!20 = !DILocation(line: 20, column: 10, scope: !17)
+!21 = !DILocation(line: 20, column: 6, scope: !17)
+!22 = !DILocation(line: 21, column: 3, scope: !17)
+!23 = !DILocation(line: 22, column: 3, scope: !17)
+!24 = !DILocation(line: 24, column: 8, scope: !17)
+!25 = !DILocation(line: 25, column: 10, scope: !17)
+!26 = !DILocation(line: 25, column: 6, scope: !17)
+!27 = !DILocation(line: 27, column: 2, scope: !17)
+!28 = !DILocation(line: 28, column: 2, scope: !17)
+!29 = !DILocation(line: 29, column: 1, scope: !17)
@@ -0,0 +1,113 @@
+#!/bin/sh
+#
+# Run the analyzer on the regression corpus and diff its bug reports
+# against the golden reports. The corpus is analyzed single-threaded,
+# multi-threaded, with unfused passes and with alias queries; all four
+# must agree. The alias pointers found are diffed against golden too.
+#
+# usage: run.sh [-u] <analyzer>
+#   -u  rewrite the golden files from the single-threaded runs
+#
+
+UPDATE=0
+if [ "$1" = "-u" ]; then
+	UPDATE=1
+	shift
+fi
+
+ANALYZER=$1
+if [ -z "$ANALYZER" ] || [ ! -x "$ANALYZER" ]; then
+	echo "usage: $0 [-u] <analyzer>" >&2
+	exit 2
+fi
+ANALYZER=$(cd "$(dirname "$ANALYZER")" && pwd)/$(basename "$ANALYZER")
+
+# Module paths end up in the reports, so run from the repository root
+# with relative paths
+cd "$(dirname "$0")/../.." || exit 2
+CORPUS=$(ls tests/regress/corpus/*.ll | LC_ALL=C sort)
+GOLDEN=tests/regress/golden/reports.txt
+GOLDEN_ALIASES=tests/regress/golden/aliases.txt
+
+THREADS=$(nproc 2>/dev/null || echo 4)
+if [ "$THREADS" -lt 4 ]; then
+	THREADS=4
+fi
+
+OUT=$(mktemp -d)
+trap 'rm -rf "$OUT"' EXIT
+
+# Keep the bug report blocks of the log. Bug numbers and the warning
+# line follow the order reports are emitted in, which depends on the
+# schedule; drop them and sort the blocks. Path numbers follow the order
+# paths are kept in, which is by address; the path with the operation is
+# always printed first, so drop the numbers too.
+normalize() {
+	sed -e 's/\x1b\[[0-9;]*m//g' \
+		-e "s/ in path '[0-9]*'/ in path 'N'/g" \
+		-e 's/^--Path [0-9]*:/--Path N:/' "$1" | awk '
+		/^=============================$/ {
+			if (inbug)
+				print block
+			inbug = !inbug
+			block = ""
+			next
+		}
+		!inbug || /^(Global Bug num:|Warning: find a potential bug:)/ { next }
+		{ block = block $0 "\001" }' | LC_ALL=C sort | tr '\001' '\n'
+}
+
+run() {
+	NAME=$1
+	shift
+	if ! "$ANALYZER" -krc "$@" $CORPUS >"$OUT/$NAME.log" 2>&1; then
+		echo "FAIL: analyzer exited with an error ($NAME), see below" >&2
+		cat "$OUT/$NAME.log" >&2
+		exit 1
+	fi
+	normalize "$OUT/$NAME.log" >"$OUT/$NAME.txt"
+}
+
+run serial -threads=1
+run aliases -threads=1 -alias-queries -verbose-level=2
+grep '^\[Alias\]' "$OUT/aliases.log" >"$OUT/aliases-found.txt"
+if [ $UPDATE -eq 1 ]; then
+	mkdir -p "$(dirname "$GOLDEN")"
+	cp "$OUT/serial.txt" "$GOLDEN"
+	echo "Wrote $(grep -c '^Bug Type:' "$GOLDEN") reports to $GOLDEN"
+	cp "$OUT/aliases-found.txt" "$GOLDEN_ALIASES"
+	echo "Wrote $(wc -l <"$GOLDEN_ALIASES") alias lines to $GOLDEN_ALIASES"
+	exit 0
+fi
+
+run parallel -threads=$THREADS
+run unfused -threads=1 -fuse-passes=false
+
+STATUS=0
+compare() {
+	if diff -u "$1" "$2" >"$OUT/diff"; then
+		echo "PASS: $3"
+	else
+		echo "FAIL: $3"
+		cat "$OUT/diff"
+		STATUS=1
+	fi
+}
+
+if [ -f "$GOLDEN" ]; then
+	compare "$GOLDEN" "$OUT/serial.txt" "golden reports"
+else
+	echo "FAIL: $GOLDEN is missing, create it with 'make regress-update'"
+	STATUS=1
+fi
+compare "$OUT/serial.txt" "$OUT/parallel.txt" "-threads=1 vs -threads=$THREADS"
+compare "$OUT/serial.txt" "$OUT/unfused.txt" "fused vs unfused passes"
+compare "$OUT/serial.txt" "$OUT/aliases.txt" "without vs with alias queries"
+if [ -f "$GOLDEN_ALIASES" ]; then
+	compare "$GOLDEN_ALIASES" "$OUT/aliases-found.txt" "golden alias pointers"
+else
+	echo "FAIL: $GOLDEN_ALIASES is missing, create it with 'make regress-update'"
+	STATUS=1
+fi
+
+exit $STATUS
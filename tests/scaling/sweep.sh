@@ -0,0 +1,105 @@
+#!/bin/sh
+#
+# Run the analyzer over growing prefixes of a bitcode list at several
+# thread counts and tabulate the per-pass rows of its stats file.
+#
+# usage: sweep.sh [-o DIR] [-n STEPS] [-t THREADS] <analyzer> <bc.list> [analyzer options]
+#   -o  directory for the logs, stats file and table (default: sweep-out)
+#   -n  number of corpus sizes: the first 1/STEPS, 2/STEPS, ... of the
+#       list (default: 4)
+#   -t  thread counts, e.g. "1 2 4 8" (default: 1 and the number of CPUs)
+#
+# bc.list holds one bitcode path per line, as for 'analyzer @bc.list'.
+# The remaining options are passed to every run, e.g. -krc.
+#
+
+OUT=sweep-out
+STEPS=4
+THREADS=
+while getopts o:n:t: OPT; do
+	case $OPT in
+	o) OUT=$OPTARG ;;
+	n) STEPS=$OPTARG ;;
+	t) THREADS=$OPTARG ;;
+	*) exit 2 ;;
+	esac
+done
+shift $((OPTIND - 1))
+
+ANALYZER=$1
+LIST=$2
+if [ -z "$ANALYZER" ] || [ ! -x "$ANALYZER" ] || [ ! -f "$LIST" ]; then
+	echo "usage: $0 [-o DIR] [-n STEPS] [-t THREADS] <analyzer> <bc.list> [analyzer options]" >&2
+	exit 2
+fi
+shift 2
+
+if [ -z "$THREADS" ]; then
+	NPROC=$(nproc 2>/dev/null || echo 1)
+	THREADS=1
+	if [ "$NPROC" -gt 1 ]; then
+		THREADS="1 $NPROC"
+	fi
+fi
+
+TOTAL=$(grep -c . "$LIST")
+if [ "$TOTAL" -eq 0 ]; then
+	echo "$LIST is empty" >&2
+	exit 2
+fi
+if [ "$STEPS" -gt "$TOTAL" ]; then
+	STEPS=$TOTAL
+fi
+
+mkdir -p "$OUT" || exit 2
+STATS=$OUT/stats.tsv
+rm -f "$STATS"
+
+# Smallest corpus first, so that the analyzer can flag super-linear
+# passes against the runs already recorded in the stats file
+STEP=1
+while [ $STEP -le $STEPS ]; do
+	N=$((TOTAL * STEP / STEPS))
+	grep . "$LIST" | head -n $N >"$OUT/bc-$N.list"
+	for T in $THREADS; do
+		echo "$N modules, $T threads"
+		if ! "$ANALYZER" -threads=$T -stats-file="$STATS" "$@" @"$OUT/bc-$N.list" \
+			>"$OUT/run-$N-$T.log" 2>&1; then
+			echo "analyzer failed, see $OUT/run-$N-$T.log" >&2
+			exit 1
+		fi
+	done
+	STEP=$((STEP + 1))
+done
+
+# One row per pass, corpus size and thread count. Speedup is against the
+# smallest thread count of the same size; the growth exponent is against
+# the previous size at the same thread count (1 is linear).
+awk -F '\t' '
+	{
+		key = $1 SUBSEP $3 SUBSEP $4
+		if (!(key in wall))
+			order[n++] = key
+		pass[key] = $1; mods[key] = $2; funcs[key] = $3; thr[key] = $4
+		wall[key] = $5; cpu[key] = $6; rss[key] = $7
+		if (!(($1, $3) in minthr) || $4 < minthr[$1, $3])
+			minthr[$1, $3] = $4
+	}
+	END {
+		printf "%-20s %8s %10s %8s %10s %10s %12s %8s %8s\n", "Pass", "Modules",
+			"Funcs", "Threads", "Wall(s)", "CPU(s)", "PeakRSS(MB)", "Speedup", "Growth"
+		for (i = 0; i < n; i++) {
+			k = order[i]
+			base = pass[k] SUBSEP funcs[k] SUBSEP minthr[pass[k], funcs[k]]
+			speedup = wall[k] > 0 ? sprintf("%.2f", wall[base] / wall[k]) : "-"
+			growth = "-"
+			p = prev[pass[k], thr[k]]
+			if (p != "" && funcs[p] > 0 && funcs[k] > funcs[p] && wall[p] > 0 && wall[k] > 0)
+				growth = sprintf("%.2f", log(wall[k] / wall[p]) / log(funcs[k] / funcs[p]))
+			prev[pass[k], thr[k]] = k
+			printf "%-20s %8d %10d %8d %10.3f %10.3f %12.1f %8s %8s\n", pass[k], mods[k],
+				funcs[k], thr[k], wall[k], cpu[k], rss[k] / 1024, speedup, growth
+		}
+	}' "$STATS" >"$OUT/table.txt"
+
+cat "$OUT/table.txt"